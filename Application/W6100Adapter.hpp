@@ -21,6 +21,18 @@
 
 namespace WizNet {
 
+/**
+ * @struct W6100XferDesc
+ * @brief Descriptor of one asynchronous transfer. addr and data are kept until the transfer is completed.
+ */
+struct W6100XferDesc {
+    uint8_t*   addr;        ///< address phase
+    datasize_t alen;
+    uint8_t*   data;        ///< data to write or buffer to read
+    datasize_t dlen;
+    bool       write;       ///< direction of data
+};
+
 class W6100AdapterOp {
  public:
     virtual ~W6100AdapterOp() {};
@@ -35,6 +47,14 @@ class W6100AdapterOp {
     virtual void    writeBytes(uint8_t* pBuf, datasize_t len) { }
     virtual void    readBytes(uint8_t* pBuf, datasize_t len) { }
     virtual void    vdmXfer(uint8_t* addr, datasize_t alen, uint8_t* data, datasize_t dlen) { }
+
+    /**
+     * Asynchronous transport such as SPI DMA. When asyncCapable() returns true, bulk socket buffer
+     * transfers are submitted to vdmXferAsync(), which should return at once and call
+     * W6100Adapter::xferDone() after the transfer is completed and chip is deselected.
+     */
+    virtual bool    asyncCapable() { return false; }
+    virtual void    vdmXferAsync(const W6100XferDesc& desc) { }
 };
 
 /**
@@ -83,6 +103,14 @@ public:
         };
         this->W6100SpiVDMXfer = vdmWriteRead;
 
+        static auto vdmXferAsync = [](uint8_t* addr, datasize_t alen, uint8_t* data, datasize_t dlen) {
+            if(W6100AdapterOp* op = W6100Adapter::getOp()) {
+                W6100XferDesc desc = { addr, alen, data, dlen, (addr[2] & _W6100_SPI_WRITE_) != 0 };
+                op->vdmXferAsync(desc);
+            }
+        };
+        this->W6100SpiVDMXferAsync = vdmXferAsync;
+
         static auto csEnable = []() {
             if(W6100AdapterOp* op = W6100Adapter::getOp()) {
                 op->csEnable();
@@ -139,6 +167,7 @@ public:
 				W6100SpiReadBurst, W6100SpiWriteBurst,
 				W6100SpiVDMXfer);
 		reg_wizchip_cs_cbfunc(W6100CsEnable, W6100CsDisable);
+		reg_wizchip_spi_async_cbfunc((m_op && m_op->asyncCapable()) ? W6100SpiVDMXferAsync : nullptr);
 
 		if(m_op)
         {
@@ -260,6 +289,15 @@ public:
 		return true;
 	}
 
+	/**
+	 * @fn void xferDone()
+	 * @brief Complete the transfer submitted to W6100AdapterOp::vdmXferAsync().
+	 */
+	static void xferDone()
+	{
+		wizchip_xfer_done();
+	}
+
 	wiz_NetInfo gWIZNETINFO;			/// Current w6100 information.
 private:
 	static W6100AdapterOp* m_op;
@@ -271,6 +309,7 @@ private:
 	void (*W6100SpiReadBurst)(uint8_t* , datasize_t);
 	void (*W6100SpiWriteBurst)(uint8_t* , datasize_t);
 	void (*W6100SpiVDMXfer)(uint8_t* addr, datasize_t alen, uint8_t* data, datasize_t dlen);
+	void (*W6100SpiVDMXferAsync)(uint8_t* addr, datasize_t alen, uint8_t* data, datasize_t dlen);
 
 	void (*W6100CsEnable)();
 	void (*W6100CsDisable)();
@@ -0,0 +1,105 @@
+/*
+ * W6100ThreadXfer.hpp
+ *
+ *  Thread-backed asynchronous transport for host test.
+ */
+
+#ifndef IO6LIBRARY_APPLICATION_W6100THREADXFER_HPP_
+#define IO6LIBRARY_APPLICATION_W6100THREADXFER_HPP_
+
+#if defined(__linux__)
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+#include "W6100Adapter.hpp"
+
+namespace WizNet {
+
+/**
+ * @class W6100ThreadXferOp
+ * @brief Wrap a synchronous W6100AdapterOp, and run its vdmXfer() for vdmXferAsync() in a worker thread.
+ * 			The transfer is completed with W6100Adapter::xferDone() after latency_us.
+ */
+class W6100ThreadXferOp : public W6100AdapterOp {
+public:
+	W6100ThreadXferOp(W6100AdapterOp* op, uint32_t latency_us = 0)
+	{
+		m_op = op;
+		m_latency_us = latency_us;
+		m_pending = false;
+		m_exit = false;
+		m_worker = std::thread([this]() { this->run(); });
+	}
+
+	virtual ~W6100ThreadXferOp()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_exit = true;
+		}
+		m_cond.notify_one();
+		m_worker.join();
+	}
+
+	void reset() override { m_op->reset(); }
+	void csEnable() override { m_op->csEnable(); }
+	void csDisable() override { m_op->csDisable(); }
+	uint8_t readByte() override { return m_op->readByte(); }
+	void writeByte(uint8_t byte) override { m_op->writeByte(byte); }
+	void writeBytes(uint8_t* pBuf, datasize_t len) override { m_op->writeBytes(pBuf, len); }
+	void readBytes(uint8_t* pBuf, datasize_t len) override { m_op->readBytes(pBuf, len); }
+	void vdmXfer(uint8_t* addr, datasize_t alen, uint8_t* data, datasize_t dlen) override
+	{
+		m_op->vdmXfer(addr, alen, data, dlen);
+	}
+
+	bool asyncCapable() override { return true; }
+
+	void vdmXferAsync(const W6100XferDesc& desc) override
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_desc = desc;
+			m_pending = true;
+		}
+		m_cond.notify_one();
+	}
+
+private:
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while(true)
+		{
+			m_cond.wait(lock, [this]() { return m_pending || m_exit; });
+			if(m_exit) break;
+			W6100XferDesc desc = m_desc;
+			lock.unlock();
+			if(m_latency_us)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(m_latency_us));
+			}
+			m_op->vdmXfer(desc.addr, desc.alen, desc.data, desc.dlen);
+			lock.lock();
+			m_pending = false;
+			lock.unlock();
+			W6100Adapter::xferDone();
+			lock.lock();
+		}
+	}
+
+	W6100AdapterOp* m_op;
+	uint32_t m_latency_us;
+	W6100XferDesc m_desc;
+	bool m_pending;
+	bool m_exit;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::thread m_worker;
+};
+
+} /* namespace WizNet */
+
+#endif
+#endif /* IO6LIBRARY_APPLICATION_W6100THREADXFER_HPP_ */
@@ -9,6 +9,8 @@
 #define IO6LIBRARY_ETHERNET_TCPCLIENT_H_
 
 #include <Client.h>
+#include <cstring>
+#include <functional>
 #include "socket.h"
 
 #ifdef  LOG_TAG
@@ -21,64 +23,283 @@ namespace WizNet {
 
 class TCPClient  : public Client {
 public:
+	/// Handler of connection result, 1 if connected or a negative SOCKERR_ code.
+	typedef std::function<void(int result)> ConnectHandler;
+
 	TCPClient()
 	{
 		m_socket_fd = -1;
 		_connected = false;
+		m_connecting = false;
+		m_conn_start = 0;
+		m_conn_timeout = -1;
+		m_conn_latency = 0;
+		m_alt_fd = -1;
+		m_alt_len = 0;
+		m_alt_port = 0;
+		m_alt_delay = 0;
+		m_rx_buf = nullptr;
+		m_rx_size = 0;
+		rxReset();
+		m_tx_buf = nullptr;
+		m_tx_size = 0;
+		m_tx_len = 0;
+		m_tx_delay = 0;
+		m_tx_start = 0;
+		m_tx_cork = false;
+		m_tx_error = SOCK_OK;
 	}
 
 	virtual ~TCPClient()
 	{
 		// Disconnect socket
 		if(m_socket_fd != -1)
-			wiz_close(m_socket_fd);
+			this->closeSocket(m_socket_fd);
 		m_socket_fd = -1;
 	}
 
+	/**
+	 * @fn void setRxBuffer(uint8_t*, size_t)
+	 * @brief Attach host buffer for receive.
+	 * 			When attached, data is prefetched from socket RX buffer with one burst read and one RECV command,
+	 * 			and byte-wise read(), peek() and available() are served from it.
+	 *
+	 * @param buf buffer memory, nullptr to detach.
+	 * @param size buffer size, up to 32767 bytes.
+	 */
+	void setRxBuffer(uint8_t *buf, size_t size)
+	{
+		if(size > 0x7FFF) size = 0x7FFF;
+		m_rx_buf = size ? buf : nullptr;
+		m_rx_size = buf ? size : 0;
+		rxReset();
+	}
+
+	/**
+	 * @fn void setTxBuffer(uint8_t*, size_t, uint32_t)
+	 * @brief Attach host buffer to combine small writes into one send.
+	 * 			Buffered data is sent when the buffer is full, when delay ms is passed after the first buffered byte,
+	 * 			on flush() and on uncork().
+	 *
+	 * @param buf buffer memory, nullptr to detach.
+	 * @param size buffer size, up to 32767 bytes.
+	 * @param delay ms to keep data in buffer. 0 keeps it until the buffer is full or flush().
+	 */
+	void setTxBuffer(uint8_t *buf, size_t size, uint32_t delay = 0)
+	{
+		if(m_tx_len) flush();
+		if(size > 0x7FFF) size = 0x7FFF;
+		m_tx_buf = size ? buf : nullptr;
+		m_tx_size = buf ? size : 0;
+		m_tx_delay = delay;
+	}
+
+	/**
+	 * @fn void cork()
+	 * @brief Keep written data in tx buffer until uncork() or the buffer is full.
+	 */
+	void cork()
+	{
+		m_tx_cork = true;
+	}
+
+	/**
+	 * @fn void uncork()
+	 * @brief Send data kept by cork() at once.
+	 */
+	void uncork()
+	{
+		m_tx_cork = false;
+		flush();
+	}
+
+	/**
+	 * @fn int txError()
+	 * @brief Result of the last send, SOCK_OK, SOCK_BUSY or a negative SOCKERR_ code of wiz_send().
+	 * 			When flush() fails, the unsent data is kept at the front of the tx buffer and sent by the next flush().
+	 *
+	 * @return SOCK_OK if all data is sent by the last flush() or write().
+	 */
+	int txError() const
+	{
+		return m_tx_error;
+	}
+
+	/**
+	 * @fn int beginConnect(const uint8_t*, uint8_t, uint16_t, int32_t)
+	 * @brief Start connection to the server and return at once.
+	 * 			Sn_CR_CONNECT is issued in non-block io mode, and the result is collected by pollConnect().
+	 * 			Each TCPClient takes its own socket, so many clients can connect in parallel.
+	 *
+	 * @param addr server address, 4 bytes for IPv4 or 16 bytes for IPv6.
+	 * @param addrlen length of addr.
+	 * @param port server port.
+	 * @param timeout ms to give up, negative to wait Sn_IR_TIMEOUT by RTR and RCR.
+	 * @return socket number, or negative error.
+	 */
+	int beginConnect(const uint8_t *addr, uint8_t addrlen, uint16_t port, int32_t timeout = 5000)
+	{
+		this->stop();
+		int ret = this->openConnect(addr, addrlen, port);
+		if(ret < 0)
+		{
+			return ret;
+		}
+		m_socket_fd = ret;
+		m_connecting = true;
+		m_conn_start = fe_get_ticks();
+		m_conn_timeout = timeout;
+		return m_socket_fd;
+	}
+
+	int beginConnectV4(uint32_t ip, uint16_t port, int32_t timeout = 5000)
+	{
+		return this->beginConnect((const uint8_t *)&ip, 4, port, timeout);
+	}
+
+	/**
+	 * @fn int beginConnectDual(uint32_t, const uint8_t*, uint16_t, int32_t, uint32_t)
+	 * @brief Start Happy Eyeballs connection to a dual-stack server.
+	 * 			IPv6 is tried first, and IPv4 is tried on another socket after delay ms, or at once when IPv6 fails.
+	 * 			pollConnect() keeps the first one established and closes the other.
+	 *
+	 * @param ip server IPv4 address.
+	 * @param ip6 server IPv6 address, 16 bytes.
+	 * @param port server port.
+	 * @param timeout ms to give up both, negative to wait Sn_IR_TIMEOUT by RTR and RCR.
+	 * @param delay ms given to IPv6 before IPv4 starts. 0 races them from the start.
+	 * @return socket number of a started attempt, or negative error.
+	 */
+	int beginConnectDual(uint32_t ip, const uint8_t *ip6, uint16_t port, int32_t timeout = 5000, uint32_t delay = 0)
+	{
+		this->stop();
+		memcpy(m_alt_addr, &ip, 4);
+		m_alt_len = 4;
+		m_alt_port = port;
+		m_alt_delay = delay;
+		m_conn_start = fe_get_ticks();
+		m_conn_timeout = timeout;
+
+		int ret = this->openConnect(ip6, 16, port);
+		m_socket_fd = (ret < 0) ? -1 : ret;
+		if(ret < 0 || delay == 0)
+		{
+			int alt = this->startAlt();
+			if(ret < 0) ret = alt;
+		}
+		m_connecting = (m_socket_fd != -1) || (m_alt_fd != -1);
+		return ret;
+	}
+
+	/**
+	 * @fn int pollConnect()
+	 * @brief Check the connection started by beginConnect() or beginConnectDual() with one read of Sn_IR per attempt.
+	 * 			When it is completed, the handler of onConnect() is called, and the socket is closed on error.
+	 *
+	 * @return 1 if connected, 0 if in progress, or negative error such as SOCKERR_TIMEOUT.
+	 */
+	int pollConnect()
+	{
+		int ret = 0, alt = 0;
+		if(!m_connecting)
+		{
+			return (m_socket_fd != -1) ? 1 : SOCKERR_SOCKCLOSED;
+		}
+		if(m_alt_len && (m_socket_fd == -1 || fe_ticks_istimeout(m_conn_start, m_alt_delay)))
+		{
+			this->startAlt();
+		}
+		if(m_socket_fd != -1 && (ret = this->checkConnect(m_socket_fd)) < 0) m_socket_fd = -1;
+		if(m_alt_fd != -1 && (alt = this->checkConnect(m_alt_fd)) < 0) m_alt_fd = -1;
+		if(ret != 1 && alt == 1)
+		{
+			if(m_socket_fd != -1) this->closeSocket(m_socket_fd);
+			m_socket_fd = m_alt_fd;
+			m_alt_fd = -1;
+			ret = 1;
+		}
+
+		if(ret == 1)
+		{
+			if(m_alt_fd != -1) this->closeSocket(m_alt_fd);
+			m_alt_fd = -1;
+			m_alt_len = 0;
+			m_conn_latency = fe_get_ticks() - m_conn_start;
+			log_d("socket:%d connected in %u ms.", m_socket_fd, (unsigned)m_conn_latency);
+		}
+		else if(m_socket_fd == -1 && m_alt_fd == -1 && m_alt_len == 0)
+		{
+			ret = (ret < 0) ? ret : ((alt < 0) ? alt : SOCKERR_SOCKCLOSED);
+		}
+		else if(m_conn_timeout >= 0 && fe_ticks_istimeout(m_conn_start, (FE_TICKS_TYPE)m_conn_timeout))
+		{
+			this->stop();
+			ret = SOCKERR_TIMEOUT;
+		}
+		else
+		{
+			return 0;
+		}
+
+		m_connecting = false;
+		if(ret != 1) log_w("connect error:%d", ret);
+		if(m_on_connect) m_on_connect(ret);
+		return ret;
+	}
+
+	/**
+	 * @fn void onConnect(ConnectHandler)
+	 * @brief Set handler called by pollConnect() when the connection is completed.
+	 */
+	void onConnect(ConnectHandler handler)
+	{
+		m_on_connect = handler;
+	}
+
+	bool connecting()
+	{
+		return m_connecting;
+	}
+
+	/**
+	 * @fn uint32_t connectLatency()
+	 * @brief ms from beginConnect() to the last successful connection.
+	 */
+	uint32_t connectLatency()
+	{
+		return m_conn_latency;
+	}
+
 	int connectV4(uint32_t ip, uint16_t port, int32_t timeout = 5000)
 	{
-		uint8_t status;
-		FE_TICKS_TYPE start = fe_get_ticks();
-		for(int i = 0; i< 8; i++)
+		rxReset();
+		if(this->beginConnectV4(ip, port, timeout) < 0)
 		{
-			if(getsockopt(i, SO_STATUS, &status) == SOCK_OK)
-			{
-				int8_t ret = 0;
-				if(status == SOCK_CLOSED)
-				{
-					m_socket_fd = i;
-					if((ret = wiz_socket(m_socket_fd, Sn_MR_TCPD, port, 0x0)) != m_socket_fd)
-					{
-						log_w("socket:%d init error:%d", m_socket_fd, ret);
-						wiz_close(m_socket_fd);
-						m_socket_fd = -1;
-					}
-					else
-					{
-						// Wait timeout until connected
-						do {
-							if((getsockopt(i, SO_STATUS, &status) == SOCK_OK))
-							{
-								switch(status)
-								{
-								case SOCK_INIT:
-									ret = ::wiz_connect((uint8_t)i, (uint8_t *)&ip, port, (uint8_t)4);
-									break;
-								case SOCK_ESTABLISHED:
-									log_d("socket:%d connected.", i);
-									return m_socket_fd;
-								case SOCK_CLOSED:
-									m_socket_fd = -1;
-									break;
-								default:;
-								}
-							}
-						} while(fe_ticks_istimeout(start, _timeout) == 0);
-					}
-					break;
-				}
-			}
+			return -1;
+		}
+		while(this->pollConnect() == 0);
+		return m_socket_fd;
+	}
+
+	int connectV6(const uint8_t *ip6, uint16_t port, int32_t timeout = 5000)
+	{
+		rxReset();
+		if(this->beginConnect(ip6, 16, port, timeout) < 0)
+		{
+			return -1;
+		}
+		while(this->pollConnect() == 0);
+		return m_socket_fd;
+	}
+
+	int connectDual(uint32_t ip, const uint8_t *ip6, uint16_t port, int32_t timeout = 5000, uint32_t delay = 0)
+	{
+		rxReset();
+		if(this->beginConnectDual(ip, ip6, port, timeout, delay) < 0)
+		{
+			return -1;
 		}
+		while(this->pollConnect() == 0);
 		return m_socket_fd;
 	}
 
@@ -92,9 +313,7 @@ public:
 		}
 		else
 		{
-			log_w("Current wrap can not support ipv6");
-			wiz_close(m_socket_fd);
-			m_socket_fd = -1;
+			this->connectV6((const uint8_t *)ip.raw6(), port, this->_timeout);
 		}
 		return m_socket_fd;
 	}
@@ -120,6 +339,10 @@ public:
 
 	size_t write(uint8_t byte) override
 	{
+		if(m_tx_buf)
+		{
+			return this->write(&byte, 1);
+		}
 		if(m_socket_fd != -1)
 		{
 			wiz_send(m_socket_fd, &byte, 1);
@@ -130,6 +353,27 @@ public:
 	size_t write(const uint8_t *buf, size_t size) override
 	{
 		uint16_t ret = 0;
+		if(m_tx_buf)
+		{
+			if(m_socket_fd == -1) return 0;
+			if(m_tx_len + size > m_tx_size)
+			{
+				flush();
+				if(m_tx_len == 0 && size >= m_tx_size)
+				{
+					return sendAll(buf, size);
+				}
+				// the data unsent by flush() stays ahead, take only what fits after it.
+				if(m_tx_len + size > m_tx_size) size = m_tx_size - m_tx_len;
+				if(size == 0) return 0;
+			}
+			if(m_tx_len == 0) m_tx_start = fe_get_ticks();
+			memcpy(m_tx_buf + m_tx_len, buf, size);
+			m_tx_len += size;
+			if(m_tx_len == m_tx_size) flush();
+			else txCheckDelay();
+			return size;
+		}
 		if(m_socket_fd != -1)
 		{
 			ret = wiz_send((uint8_t)m_socket_fd, (uint8_t *)buf, (uint16_t)size);
@@ -139,6 +383,11 @@ public:
 
 	int available() override
 	{
+		txCheckDelay();
+		if(m_rx_buf)
+		{
+			return (int) rxFill();
+		}
 		if(m_socket_fd != -1)
 		{
 			return getSn_RX_RSR(m_socket_fd);
@@ -149,6 +398,12 @@ public:
 	int read() override
 	{
 		uint8_t byte;
+		if(m_rx_buf)
+		{
+			if(rxFill() == 0) return -1;
+			m_rx_count--;
+			return m_rx_buf[m_rx_pos++];
+		}
 		if(m_socket_fd != -1)
 		{
 			wiz_recv(m_socket_fd, &byte, 1);
@@ -158,6 +413,15 @@ public:
 
 	int read(uint8_t *buf, size_t size) override
 	{
+		if(m_rx_buf)
+		{
+			if(rxFill() == 0) return -1;
+			if(size > m_rx_count) size = m_rx_count;
+			memcpy(buf, m_rx_buf + m_rx_pos, size);
+			m_rx_pos += size;
+			m_rx_count -= size;
+			return (int) size;
+		}
 		if(m_socket_fd != -1)
 		{
 			return wiz_recv((uint8_t)m_socket_fd, buf, size);
@@ -167,26 +431,61 @@ public:
 
 	int peek() override
 	{
+		if(m_rx_buf)
+		{
+			if(rxFill() == 0) return -1;
+			return m_rx_buf[m_rx_pos];
+		}
 		return 0;
 	}
 
+	/**
+	 * @fn void flush()
+	 * @brief Send the data kept in tx buffer. The data unsent by an error is kept for the next flush(), see txError().
+	 */
 	void flush() override
 	{
-		// Do nothing for flush operate.
+		if(m_tx_len == 0) return;
+		if(m_socket_fd != -1)
+		{
+			size_t sent = sendAll(m_tx_buf, m_tx_len);
+			if(sent < m_tx_len)
+			{
+				memmove(m_tx_buf, m_tx_buf + sent, m_tx_len - sent);
+				m_tx_len -= sent;
+				return;
+			}
+		}
+		m_tx_len = 0;
 	}
 
 	void stop() override
 	{
 		if(m_socket_fd != -1)
 		{
-			wiz_close(m_socket_fd);
+			if(!m_connecting) flush();
+			this->closeSocket(m_socket_fd);
+		}
+		if(m_alt_fd != -1)
+		{
+			this->closeSocket(m_alt_fd);
 		}
 		m_socket_fd = -1;
+		m_alt_fd = -1;
+		m_alt_len = 0;
+		m_connecting = false;
+		m_tx_len = 0;
+		rxReset();
 	}
 
 	uint8_t connected() override
 	{
 		uint8_t status;
+		if(m_connecting && this->pollConnect() != 1)
+		{
+			return 0;
+		}
+		txCheckDelay();
 		if(m_socket_fd != -1)
 		{
 			if((getsockopt(m_socket_fd, SO_STATUS, &status) == SOCK_OK))
@@ -206,6 +505,200 @@ public:
 	int8_t m_socket_fd;
 	timeval m_so_timeout;
 	bool _connected;
+
+private:
+	void rxReset()
+	{
+		m_rx_pos = 0;
+		m_rx_count = 0;
+	}
+
+	/**
+	 * @fn size_t rxFill()
+	 * @brief Prefetch received data into empty host buffer with one burst read and one RECV command.
+	 *
+	 * @return bytes in host buffer.
+	 */
+	size_t rxFill()
+	{
+		wiz_SockSnapshot snap;
+		if((m_socket_fd == -1) || (m_rx_count > 0))
+		{
+			return m_rx_count;
+		}
+		// Never block in wiz_recv() when nothing is received.
+		if((wiz_sock_snapshot(m_socket_fd, &snap) != SOCK_OK) || (snap.rx_rsr == 0))
+		{
+			return 0;
+		}
+		datasize_t ret = wiz_recv((uint8_t)m_socket_fd, m_rx_buf, (datasize_t)m_rx_size);
+		m_rx_pos = 0;
+		m_rx_count = (ret > 0) ? (size_t)ret : 0;
+		return m_rx_count;
+	}
+
+	/**
+	 * @fn int openConnect(const uint8_t*, uint8_t, uint16_t)
+	 * @brief Take a socket from the socket pool, open it for the address family and issue Sn_CR_CONNECT without waiting.
+	 *
+	 * @return socket number, or negative error.
+	 */
+	int openConnect(const uint8_t *addr, uint8_t addrlen, uint16_t port)
+	{
+		int8_t i = this->allocSocket();
+		if(i < 0)
+		{
+			log_w("No free socket to connect.");
+			return -1;
+		}
+		int8_t ret = wiz_socket(i, (addrlen == 16) ? Sn_MR_TCP6 : Sn_MR_TCP4, 0, 0x0);
+		if(ret != i)
+		{
+			log_w("socket:%d init error:%d", i, ret);
+			this->closeSocket(i);
+			return ret;
+		}
+		uint8_t mode = SOCK_IO_NONBLOCK;
+		ctlsocket(i, CS_SET_IOMODE, &mode);
+		ret = ::wiz_connect((uint8_t)i, (uint8_t *)addr, port, addrlen);
+		mode = SOCK_IO_BLOCK;
+		ctlsocket(i, CS_SET_IOMODE, &mode);
+		if(ret != SOCK_BUSY && ret != SOCK_OK)
+		{
+			log_w("socket:%d connect error:%d", i, ret);
+			this->closeSocket(i);
+			return ret;
+		}
+		return i;
+	}
+
+	/**
+	 * @fn int8_t allocSocket()
+	 * @brief Take a closed socket from the socket pool.
+	 * 			A socket opened without the pool, such as by a fixed number, is skipped by its SO_STATUS.
+	 *
+	 * @return socket number, or negative error.
+	 */
+	int8_t allocSocket()
+	{
+		uint8_t status, skipped = 0;
+		int8_t sn;
+		while((sn = wiz_sock_alloc(SOCK_OWN_TCP_CLIENT)) >= 0)
+		{
+			if(getsockopt(sn, SO_STATUS, &status) == SOCK_OK && status == SOCK_CLOSED)
+				break;
+			skipped |= (1 << sn);
+		}
+		for(int i = 0; i < _WIZCHIP_SOCK_NUM_; i++)
+		{
+			if(skipped & (1 << i)) wiz_sock_free(i);
+		}
+		return sn;
+	}
+
+	/**
+	 * @fn void closeSocket(int8_t)
+	 * @brief Close a socket and give it back to the socket pool.
+	 */
+	void closeSocket(int8_t sn)
+	{
+		wiz_close(sn);
+		wiz_sock_free(sn);
+	}
+
+	/**
+	 * @fn int startAlt()
+	 * @brief Start the IPv4 attempt kept by beginConnectDual().
+	 */
+	int startAlt()
+	{
+		int ret = this->openConnect(m_alt_addr, m_alt_len, m_alt_port);
+		m_alt_fd = (ret < 0) ? -1 : ret;
+		m_alt_len = 0;
+		return ret;
+	}
+
+	/**
+	 * @fn int checkConnect(int8_t)
+	 * @brief Read Sn_IR of a connecting socket, and close it on error.
+	 *
+	 * @return 1 if connected, 0 if in progress, or negative error.
+	 */
+	int checkConnect(int8_t sn)
+	{
+		uint8_t ir = 0;
+		ctlsocket(sn, CS_GET_INTERRUPT, &ir);
+		if(ir & Sn_IR_CON)
+		{
+			ir = Sn_IR_CON;
+			ctlsocket(sn, CS_CLR_INTERRUPT, &ir);
+			return 1;
+		}
+		int ret = (ir & Sn_IR_TIMEOUT) ? SOCKERR_TIMEOUT : ((ir & Sn_IR_DISCON) ? SOCKERR_SOCKCLOSED : 0);
+		if(ret < 0)
+		{
+			log_d("socket:%d connect error:%d", sn, ret);
+			this->closeSocket(sn);
+		}
+		return ret;
+	}
+
+	/**
+	 * @fn void txCheckDelay()
+	 * @brief Send buffered data if it is kept longer than the delay of setTxBuffer().
+	 */
+	void txCheckDelay()
+	{
+		if(m_tx_len && m_tx_delay && !m_tx_cork && fe_ticks_istimeout(m_tx_start, m_tx_delay))
+		{
+			flush();
+		}
+	}
+
+	size_t sendAll(const uint8_t *buf, size_t size)
+	{
+		size_t pos = 0;
+		m_tx_error = SOCK_OK;
+		while(pos < size)
+		{
+			size_t len = size - pos;
+			if(len > 0x7FFF) len = 0x7FFF;
+			datasize_t ret = wiz_send((uint8_t)m_socket_fd, (uint8_t *)buf + pos, (datasize_t)len);
+			if(ret <= 0)
+			{
+				log_w("socket:%d send error:%d", m_socket_fd, ret);
+				m_tx_error = ret;
+				break;
+			}
+			pos += ret;
+		}
+		return pos;
+	}
+
+	uint8_t *m_tx_buf;
+	size_t m_tx_size;
+	size_t m_tx_len;
+	uint32_t m_tx_delay;
+	FE_TICKS_TYPE m_tx_start;
+	bool m_tx_cork;
+	int m_tx_error;					///< result of the last sendAll()
+
+	bool m_connecting;
+	FE_TICKS_TYPE m_conn_start;
+	int32_t m_conn_timeout;
+	uint32_t m_conn_latency;
+	ConnectHandler m_on_connect;
+
+	int8_t m_alt_fd;				///< IPv4 attempt of beginConnectDual()
+	uint8_t m_alt_addr[16];
+	uint8_t m_alt_len;				///< not 0 while the IPv4 attempt is not started
+	uint16_t m_alt_port;
+	uint32_t m_alt_delay;
+
+	uint8_t *m_rx_buf;
+	size_t m_rx_size;
+	size_t m_rx_pos;
+	size_t m_rx_count;
 };
 
 } /* namespace WizNet */
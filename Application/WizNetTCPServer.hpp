@@ -8,6 +8,7 @@
 #ifndef IO6LIBRARY_APPLICATION_TCPSERVER_HPP_
 #define IO6LIBRARY_APPLICATION_TCPSERVER_HPP_
 
+#include <functional>
 #include "socket.h"
 #include "w6100.h"
 #include "WizNetTCPClient.hpp"
@@ -21,17 +22,29 @@
 
 namespace WizNet {
 
+/**
+ * @brief TCP server on up to W6100_TCP_SERVER_CONN_NUM sub-connections.
+ *
+ * @tparam MAX_TCP_NUM the server takes only sockets below it from the socket pool,
+ * 			so the sockets from MAX_TCP_NUM to _WIZCHIP_SOCK_NUM_ - 1 stay free for other services.
+ * 			_WIZCHIP_SOCK_NUM_ lets it take any socket.
+ */
 template<int MAX_TCP_NUM>
 class TCPServer {
 public:
+	/// Handler of event-driven mode, called with the sub-connection index.
+	typedef std::function<void(int index)> ConnHandler;
+
 	TCPServer(uint8_t max = W6100_TCP_SERVER_CONN_NUM)
 	{
 		m_max_conn = max;
 		for(int i = 0; i< m_max_conn; i++)
 		{
 			m_socket_fd[i] = -1;
+			m_listen_fd[i] = -1;
 		}
 		m_port = 0;
+		m_backlog = 0;
 	}
 
 	virtual ~TCPServer()
@@ -39,8 +52,11 @@ public:
 		for(int j = 0; j < m_max_conn; j++)
 		{
 			if(m_socket_fd[j] != -1)
-				wiz_close(m_socket_fd[j]);
+				this->closeSocket(m_socket_fd[j]);
 			m_socket_fd[j] = -1;
+			if(m_listen_fd[j] != -1)
+				this->closeSocket(m_listen_fd[j]);
+			m_listen_fd[j] = -1;
 		}
 	}
 
@@ -77,40 +93,8 @@ public:
 	 */
 	uint8_t isAvailable(int index)
 	{
-		uint8_t status;
-		if(index < 0 || index > m_max_conn)
-			return 0;
-
-		if(m_socket_fd[index] == -1)
-		{
-			log_d("try to establish %d.", index);
-			if(!this->establish(m_port, index))
-			{
-				log_w("Server sub-conn %d have no valid sockets.", index);
-				// 所有端口都无法建立连接，又无法close，那么就reset硬件
-				m_need_reset = true;
-			}
-		}
-
-		if(getsockopt(m_socket_fd[index], SO_STATUS, &status) == SOCK_OK)
-		{
-			switch(status)
-			{
-			case SOCK_ESTABLISHED:
-			{
-				if(getSn_IR(m_socket_fd[index]) & Sn_IR_CON)
-				{
-					setSn_IRCLR(m_socket_fd[index], Sn_IR_CON);
-				}
-				break;
-			}
-			case SOCK_CLOSED:
-				m_socket_fd[index] = -1;
-				break;
-			default:;
-			}
-		}
-		return status;
+		wiz_SockSnapshot snap;
+		return this->isAvailable(index, &snap);
 	}
 
 	/**
@@ -122,11 +106,12 @@ public:
 	 */
 	int available(int index)
 	{
-		if(uint8_t status = this->isAvailable(index))
+		wiz_SockSnapshot snap;
+		if(uint8_t status = this->isAvailable(index, &snap))
 		{
 			if((SOCK_ESTABLISHED == status) || SOCK_CLOSE_WAIT == status)
 			{
-				datasize_t ret = getSn_RX_RSR(m_socket_fd[index]);
+				datasize_t ret = snap.rx_rsr;
 				if((ret == 0) && (SOCK_CLOSE_WAIT == status))
 				{
 					wiz_disconnect(m_socket_fd[index]);
@@ -142,7 +127,7 @@ public:
 
 		if(m_socket_fd[index] != -1)
 		{
-			wiz_close(m_socket_fd[index]);
+			this->closeSocket(m_socket_fd[index]);
 		}
 		m_socket_fd[index] = -1;
 		return -1;
@@ -172,7 +157,277 @@ public:
 		return m_need_reset;
 	}
 
+	void onAccept(ConnHandler handler) { m_on_accept = handler; }
+	void onData(ConnHandler handler) { m_on_data = handler; }
+	void onClose(ConnHandler handler) { m_on_close = handler; }
+
+	/**
+	 * @fn bool begin(uint16_t, uint8_t)
+	 * @brief Start event-driven mode. backlog sockets are kept listening on port, and service()
+	 * 			moves each connected one to a sub-connection and re-arms a new listener at once.
+	 * 			Don't call establish(), isAvailable() and available() in this mode.
+	 *
+	 * @param port	port used for bind.
+	 * @param backlog number of sockets kept listening, up to the max connections.
+	 * @return true if at least one socket is listening.
+	 */
+	bool begin(uint16_t port, uint8_t backlog = 1)
+	{
+		for(int j = 0; j < m_max_conn; j++)
+		{
+			this->stop(j);
+			if(m_listen_fd[j] != -1)
+				this->closeSocket(m_listen_fd[j]);
+			m_listen_fd[j] = -1;
+		}
+		m_port = port;
+		m_backlog = (backlog > m_max_conn) ? m_max_conn : backlog;
+		m_need_reset = false;
+		this->arm();
+		for(int j = 0; j < m_backlog; j++)
+		{
+			if(m_listen_fd[j] != -1) return true;
+		}
+		return false;
+	}
+
+	/**
+	 * @fn int service(uint32_t)
+	 * @brief One tick of event-driven mode. Readiness of all sockets is checked with one wiz_select(),
+	 * 			and onAccept, onData and onClose are called for the sub-connections.
+	 * 			onData is called again on the next tick while received data is left.
+	 *
+	 * @param timeout ms to wait INTn when no socket is ready, 0 returns at once.
+	 * @return number of called handlers.
+	 */
+	int service(uint32_t timeout = 0)
+	{
+		wiz_SockSnapshot snap;
+		uint8_t rd = 0, ex = 0;
+		int events = 0;
+
+		for(int j = 0; j < m_max_conn; j++)
+		{
+			if(m_listen_fd[j] != -1) rd |= (1 << m_listen_fd[j]);
+			if(m_socket_fd[j] != -1) rd |= (1 << m_socket_fd[j]);
+		}
+		ex = rd;
+		if(rd == 0 || wiz_select(&rd, nullptr, &ex, timeout) <= 0)
+		{
+			this->arm();
+			return 0;
+		}
+
+		// Accept first, so a connection with data gets onAccept and onData in the same tick.
+		for(int j = 0; j < m_backlog; j++)
+		{
+			int8_t sn = m_listen_fd[j];
+			if(sn == -1 || !((rd | ex) & (1 << sn))) continue;
+			if(wiz_sock_snapshot(sn, &snap) != SOCK_OK) continue;
+			if(snap.sr == SOCK_LISTEN || snap.sr == SOCK_SYNRECV) continue;
+
+			uint8_t ir = Sn_IR_CON;
+			ctlsocket(sn, CS_CLR_INTERRUPT, &ir);
+			m_listen_fd[j] = -1;
+			int index = this->freeSlot();
+			if(index < 0 || (snap.sr != SOCK_ESTABLISHED && snap.sr != SOCK_CLOSE_WAIT))
+			{
+				this->release(sn);
+				continue;
+			}
+			m_socket_fd[index] = sn;
+			log_d("socket:%d accepted at %d.", sn, index);
+			this->arm();
+			if(m_on_accept) m_on_accept(index);
+			events++;
+		}
+
+		for(int index = 0; index < m_max_conn; index++)
+		{
+			int8_t sn = m_socket_fd[index];
+			if(sn == -1 || !((rd | ex) & (1 << sn))) continue;
+			if(wiz_sock_snapshot(sn, &snap) != SOCK_OK) continue;
+			if(snap.rx_rsr > 0)
+			{
+				if(m_on_data)
+				{
+					m_on_data(index);
+					events++;
+				}
+				continue;
+			}
+			if(snap.sr == SOCK_CLOSED || snap.sr == SOCK_CLOSE_WAIT || (ex & (1 << sn)))
+			{
+				m_socket_fd[index] = -1;
+				if(m_on_close) m_on_close(index);
+				events++;
+				this->release(sn);
+			}
+		}
+		this->arm();
+		return events;
+	}
+
+	/**
+	 * @fn void stop(int)
+	 * @brief Close sub-connection of event-driven mode without onClose.
+	 */
+	void stop(int index)
+	{
+		if(index < 0 || index >= m_max_conn || m_socket_fd[index] == -1)
+			return;
+		int8_t sn = m_socket_fd[index];
+		m_socket_fd[index] = -1;
+		this->release(sn);
+	}
+
 private:
+	/**
+	 * @fn void arm()
+	 * @brief Open listeners on sockets of the socket pool up to backlog, without waiting.
+	 * 			The listeners never take more sub-connections than are left.
+	 */
+	void arm()
+	{
+		int used = 0;
+		for(int j = 0; j < m_max_conn; j++)
+		{
+			if(m_socket_fd[j] != -1) used++;
+			if(j < m_backlog && m_listen_fd[j] != -1) used++;
+		}
+		for(int j = 0; j < m_backlog && used < m_max_conn; j++)
+		{
+			if(m_listen_fd[j] != -1) continue;
+			int8_t i = this->allocSocket();
+			if(i < 0) break;
+			if(wiz_socket(i, Sn_MR_TCPD, m_port, 0x0) != i || wiz_listen(i) != SOCK_OK)
+			{
+				log_w("socket:%d listen error.", i);
+				this->closeSocket(i);
+				break;
+			}
+			m_listen_fd[j] = i;
+			used++;
+		}
+	}
+
+	/**
+	 * @fn void release(uint8_t)
+	 * @brief Give back a socket to the socket pool. A connected one is disconnected without waiting,
+	 * 			and the pool takes it last while W6100 closes it.
+	 */
+	void release(uint8_t sn)
+	{
+		wiz_sock_free(sn);
+		uint8_t ir = SIK_ALL;
+		ctlsocket(sn, CS_CLR_INTERRUPT, &ir);
+		uint8_t status = SOCK_CLOSED;
+		getsockopt(sn, SO_STATUS, &status);
+		if(status == SOCK_ESTABLISHED || status == SOCK_CLOSE_WAIT)
+		{
+			uint8_t mode = SOCK_IO_NONBLOCK;
+			ctlsocket(sn, CS_SET_IOMODE, &mode);
+			wiz_disconnect(sn);
+		}
+		else
+		{
+			wiz_close(sn);
+		}
+	}
+
+	/**
+	 * @fn int8_t allocSocket()
+	 * @brief Take a closed socket below MAX_TCP_NUM from the socket pool.
+	 * 			A socket opened without the pool, such as by a fixed number, is skipped by its SO_STATUS.
+	 * 			Sockets from MAX_TCP_NUM up are kept for other services, see the class template.
+	 *
+	 * @return socket number, or negative error.
+	 */
+	int8_t allocSocket()
+	{
+		uint8_t status, skipped = 0;
+		int8_t sn;
+		while((sn = wiz_sock_alloc(SOCK_OWN_TCP_SERVER)) >= 0)
+		{
+			if(sn < MAX_TCP_NUM && getsockopt(sn, SO_STATUS, &status) == SOCK_OK && status == SOCK_CLOSED)
+				break;
+			skipped |= (1 << sn);
+		}
+		for(int i = 0; i < _WIZCHIP_SOCK_NUM_; i++)
+		{
+			if(skipped & (1 << i)) wiz_sock_free(i);
+		}
+		return sn;
+	}
+
+	/**
+	 * @fn void closeSocket(int8_t)
+	 * @brief Close a socket and give it back to the socket pool.
+	 */
+	void closeSocket(int8_t sn)
+	{
+		wiz_close(sn);
+		wiz_sock_free(sn);
+	}
+
+	int freeSlot()
+	{
+		for(int j = 0; j < m_max_conn; j++)
+		{
+			if(m_socket_fd[j] == -1) return j;
+		}
+		return -1;
+	}
+
+	/**
+	 * @fn uint8_t isAvailable(int, wiz_SockSnapshot*)
+	 * @brief Check sub-connection with one snapshot of its socket registers.
+	 *
+	 * @param index which sub-connection need check.
+	 * @param snap filled with the socket registers, valid when the return is not SOCK_CLOSED.
+	 * @return socket status.
+	 */
+	uint8_t isAvailable(int index, wiz_SockSnapshot *snap)
+	{
+		uint8_t status = SOCK_CLOSED;
+		if(index < 0 || index > m_max_conn)
+			return 0;
+
+		if(m_socket_fd[index] == -1)
+		{
+			log_d("try to establish %d.", index);
+			if(!this->establish(m_port, index))
+			{
+				log_w("Server sub-conn %d have no valid sockets.", index);
+				// 所有端口都无法建立连接，又无法close，那么就reset硬件
+				m_need_reset = true;
+			}
+		}
+
+		if(wiz_sock_snapshot(m_socket_fd[index], snap) == SOCK_OK)
+		{
+			status = snap->sr;
+			switch(status)
+			{
+			case SOCK_ESTABLISHED:
+			{
+				if(snap->ir & Sn_IR_CON)
+				{
+					uint8_t ir = Sn_IR_CON;
+					ctlsocket(m_socket_fd[index], CS_CLR_INTERRUPT, &ir);
+				}
+				break;
+			}
+			case SOCK_CLOSED:
+				wiz_sock_free(m_socket_fd[index]);
+				m_socket_fd[index] = -1;
+				break;
+			default:;
+			}
+		}
+		return status;
+	}
+
 	bool establish(uint16_t port, int index)
 	{
 		uint8_t status;
@@ -184,63 +439,54 @@ private:
 
 		if(m_socket_fd[index] != -1)
 		{
-			wiz_close(m_socket_fd[index]);
+			this->closeSocket(m_socket_fd[index]);
 			m_socket_fd[index] = -1;
 		}
 
-		for(int i = 0; i< MAX_TCP_NUM; i++)
+		int8_t i = this->allocSocket();
+		if(i < 0) return false;
+		m_socket_fd[index] = i;
+		int8_t ret = wiz_socket(m_socket_fd[index], Sn_MR_TCPD, port, 0x0);
+		if(ret != m_socket_fd[index])
 		{
-			if(getsockopt(i, SO_STATUS, &status) == SOCK_OK)
+			log_w("socket:%d init error:%d", m_socket_fd[index], ret);
+			this->closeSocket(m_socket_fd[index]);
+			m_socket_fd[index] = -1;
+			// 需要reset 外设了
+			m_need_reset = true;
+			return false;
+		}
+		// Wait timeout until listen
+		do {
+			if((getsockopt(i, SO_STATUS, &status) == SOCK_OK))
 			{
-				int8_t ret = 0;
-				bool setup = false;
-				if(status == SOCK_CLOSED)
+				switch(status)
 				{
-					m_socket_fd[index] = i;
-					ret = wiz_socket(m_socket_fd[index], Sn_MR_TCPD, port, 0x0);
-					if(ret != m_socket_fd[index])
-					{
-						log_w("socket:%d init error:%d", m_socket_fd[index], ret);
-						wiz_close(m_socket_fd[index]);
-						m_socket_fd[index] = -1;
-						// 需要reset 外设了
-						m_need_reset = true;
-					}
-					else
-					{
-						// Wait timeout until listen
-						do {
-							if((getsockopt(i, SO_STATUS, &status) == SOCK_OK))
-							{
-								switch(status)
-								{
-								case SOCK_INIT:
-									ret = wiz_listen((uint8_t)i);
-									break;
-								case SOCK_LISTEN:
-								case SOCK_ESTABLISHED:
-									log_d("socket:%d listening at %d.", i, m_socket_fd[index]);
-									setup = true;
-									break;
-								case SOCK_CLOSED:
-									m_socket_fd[index] = -1;
-									break;
-								default:;
-								}
-							}
-							if(setup) break;
-						} while(fe_ticks_istimeout(start, timeout) == 0);
-					}
-					if(setup) break;
+				case SOCK_INIT:
+					ret = wiz_listen((uint8_t)i);
+					break;
+				case SOCK_LISTEN:
+				case SOCK_ESTABLISHED:
+					log_d("socket:%d listening at %d.", i, index);
+					return true;
+				default:;
 				}
 			}
-		}
-		return m_socket_fd[index] != -1;
+		} while(fe_ticks_istimeout(start, timeout) == 0);
+		this->closeSocket(i);
+		m_socket_fd[index] = -1;
+		return false;
 	}
 
 	int8_t m_socket_fd[W6100_TCP_SERVER_CONN_NUM];
+	int8_t m_listen_fd[W6100_TCP_SERVER_CONN_NUM];		///< listeners of event-driven mode
 	uint8_t m_max_conn;
+	uint8_t m_backlog;
 	uint16_t m_port;
+
+	ConnHandler m_on_accept;
+	ConnHandler m_on_data;
+	ConnHandler m_on_close;
 };
 
 } /* namespace WizNet */
@@ -23,6 +23,7 @@ int32_t loopback_tcps(uint8_t sn, uint8_t* buf, uint16_t port, uint8_t loopback_
     datasize_t received_size;
     uint8_t arg_tmp8;
     uint8_t* mode_msg;
+    wiz_SockSnapshot snap;
 
     if(loopback_mode == AS_IPV4)
     {
@@ -38,11 +39,12 @@ int32_t loopback_tcps(uint8_t sn, uint8_t* buf, uint16_t port, uint8_t loopback_
         uint8_t dst_ip[16], ext_status;
         uint16_t dst_port;
     #endif
-        getsockopt(sn, SO_STATUS, &status);
+        if(wiz_sock_snapshot(sn, &snap) != SOCK_OK) return SOCKERR_SOCKNUM;
+        status = snap.sr;
         switch(status)
         {
         case SOCK_ESTABLISHED :
-            ctlsocket(sn,CS_GET_INTERRUPT,&inter);
+            inter = snap.ir;
             if(inter & Sn_IR_CON)
             {
             #ifdef _LOOPBACK_DEBUG_
@@ -71,7 +73,7 @@ int32_t loopback_tcps(uint8_t sn, uint8_t* buf, uint16_t port, uint8_t loopback_
                 arg_tmp8 = Sn_IR_CON;
                 ctlsocket(sn,CS_CLR_INTERRUPT,&arg_tmp8);
             }
-            getsockopt(sn,SO_RECVBUF,&received_size);
+            received_size = snap.rx_rsr;
 
             if(received_size > 0){
                 if(received_size > DATA_BUF_SIZE) received_size = DATA_BUF_SIZE;
@@ -97,7 +99,7 @@ int32_t loopback_tcps(uint8_t sn, uint8_t* buf, uint16_t port, uint8_t loopback_
             #ifdef _LOOPBACK_DEBUG_
                 printf("%d:CloseWait\r\n",sn);
             #endif
-            getsockopt(sn, SO_RECVBUF, &received_size);
+            received_size = snap.rx_rsr;
             if(received_size > 0) // Don't need to check SOCKERR_BUSY because it doesn't not occur.
             {
                 if(received_size > DATA_BUF_SIZE) received_size = DATA_BUF_SIZE;
@@ -0,0 +1,185 @@
+/**
+ * @file dhcp4_server.c
+ * @brief Cold, warm and moved boots of the DHCPv4 client against a simulated server.
+ * @details The server stands in for a DHCPv4 server on loopback UDP 67 (+ port offset). It offers one address,
+ *          ACKs REQUEST for it and NAKs an INIT-REBOOT REQUEST for any other one.
+ *          The lease is kept by the handlers of @ref reg_dhcpv4_lease_cbfunc(), so the second boot starts at INIT-REBOOT.
+ *          The address conflict check finds the address free through @ref w6100sim_set_unreachable().\n
+ *          The client runs with a simulated clock of 10 ms steps, and DHCPv4_time_handler() is called every 1 s of it.
+ *          The server answers within a step, so the time counts the steps the client waits for its replies.
+ *          Every boot reports the messages seen by the server, the SPI transfers and the simulated time
+ *          from DHCPv4_init() until SIPR is set, for DHCPv4_poll() and for the legacy DHCPv4_run().\n
+ *          usage: dhcp4_server [port_offset]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wizchip_conf.h"
+#include "socket.h"
+#include "dhcpv4.h"
+#include "w6100sim.h"
+#include "sim_peer.h"
+
+#define SRV_STEP_MS     10
+#define SRV_LIMIT_MS    20000
+
+static int      srv_sock;
+static uint8_t  srv_ip[4] = {192, 168, 0, 50};   // address of the client
+static uint32_t srv_msgs;
+static uint8_t  srv_intn;
+static uint32_t srv_ms;
+
+static wiz_DHCPv4Lease srv_store;
+static uint8_t srv_stored = 0;
+
+static uint8_t srv_intn_wait(uint32_t timeout)
+{
+   uint8_t ret = srv_intn;
+   (void)timeout;
+   srv_intn = 0;
+   return ret;
+}
+
+static void srv_lease_save(const wiz_DHCPv4Lease* lease)
+{
+   srv_store = *lease;
+   srv_stored = 1;
+}
+
+static uint8_t srv_lease_load(wiz_DHCPv4Lease* lease)
+{
+   if(!srv_stored) return 0;
+   *lease = srv_store;
+   return 1;
+}
+
+/* Answer every message of the client: OFFER to DISCOVER, ACK or NAK to REQUEST */
+static void srv_serve(void)
+{
+   uint8_t msg[600], *o, type, sid, req[4];
+   uint8_t reply;
+   int len, k;
+
+   while(peer_readable(srv_sock, 0))
+   {
+      if((len = peer_recvfrom(srv_sock, msg, sizeof(msg), 0)) < 241) continue;
+      srv_msgs++;
+      type = sid = 0;
+      memset(req, 0, sizeof(req));
+      o = msg + 240;
+      while((o < msg + len) && (*o != 255))
+      {
+         if(*o == 0)
+         {
+            o++;
+            continue;
+         }
+         if((o + 2 > msg + len) || (o + 2 + o[1] > msg + len)) break;
+         if(*o == 53) type = o[2];
+         if(*o == 54) sid = 1;
+         if(*o == 50 && o[1] == 4) memcpy(req, o + 2, 4);
+         o += 2 + o[1];
+      }
+      if(type == 1) reply = 2;                                     // DISCOVER -> OFFER
+      else if(type == 3)                                           // REQUEST
+      {
+         // INIT-REBOOT has neither server identifier nor ciaddr
+         if(!sid && !msg[12] && memcmp(req, srv_ip, 4)) reply = 6; // NAK
+         else reply = 5;                                           // ACK
+      }
+      else continue;
+
+      msg[0] = 2;
+      if(reply == 6) memset(msg + 16, 0, 4);
+      else memcpy(msg + 16, srv_ip, 4);
+      k = 240;
+      msg[k++] = 53; msg[k++] = 1; msg[k++] = reply;
+      msg[k++] = 54; msg[k++] = 4; msg[k++] = 192; msg[k++] = 168; msg[k++] = 0; msg[k++] = 1;
+      if(reply != 6)
+      {
+         msg[k++] = 51; msg[k++] = 4; msg[k++] = 0;   msg[k++] = 0;   msg[k++] = 0x0e; msg[k++] = 0x10;
+         msg[k++] = 1;  msg[k++] = 4; msg[k++] = 255; msg[k++] = 255; msg[k++] = 255;  msg[k++] = 0;
+         msg[k++] = 3;  msg[k++] = 4; msg[k++] = 192; msg[k++] = 168; msg[k++] = 0;    msg[k++] = 1;
+      }
+      msg[k++] = 255;
+      while(k < 300) msg[k++] = 0;
+      peer_reply(srv_sock, msg, k);
+      srv_msgs++;
+      srv_intn = 1;
+   }
+}
+
+/* Boot the client until SIPR is set, by DHCPv4_poll() or by DHCPv4_run() if legacy */
+static int srv_boot(const char* what, uint8_t legacy)
+{
+   static uint8_t buf[1024];
+   uint8_t mac[6] = {0x00, 0x08, 0xdc, 0x01, 0x02, 0x03}, ip[4] = {0,};
+   uint32_t x0, x1;
+   uint64_t b0, b1;
+   uint8_t ev;
+
+   w6100sim_reset();
+   NETUNLOCK();
+   setSHAR(mac);
+   w6100sim_set_unreachable(srv_ip, 4);
+   srv_msgs = 0;
+   srv_intn = 0;
+   srv_ms = 0;
+   w6100sim_get_count(&x0, &b0);
+   DHCPv4_init(0, buf);
+   wiz_event_init(0x01, 0);
+   while(srv_ms < SRV_LIMIT_MS)
+   {
+      srv_serve();
+      if(legacy) DHCPv4_run();
+      else
+      {
+         ev = wiz_wait_events(0x01, 0) ? SIK_RECEIVED : 0;
+         if(ev || DHCPv4_next_deadline() == 0) DHCPv4_poll(ev);
+      }
+      getSIPR(ip);
+      if(!memcmp(ip, srv_ip, 4)) break;
+      srv_ms += SRV_STEP_MS;
+      if(srv_ms % 1000 == 0) DHCPv4_time_handler();
+   }
+   w6100sim_get_count(&x1, &b1);
+   DHCPv4_stop();
+
+   printf("%-28s: ", what);
+   if(srv_ms >= SRV_LIMIT_MS)
+   {
+      printf("no lease in %u ms\n", (unsigned)SRV_LIMIT_MS);
+      return 1;
+   }
+   printf("%u messages, %u SPI transfers, %llu SPI bytes, %u ms from DHCPv4_init()\n",
+          srv_msgs, x1 - x0, (unsigned long long)(b1 - b0), srv_ms);
+   return 0;
+}
+
+int main(int argc, char* argv[])
+{
+   uint16_t offset = (argc > 1) ? (uint16_t)atoi(argv[1]) : 20000;
+   int err = 0;
+   uint8_t legacy;
+
+   w6100sim_init(offset);
+   reg_wizchip_intn_cbfunc(srv_intn_wait);
+   if((srv_sock = peer_listen(offset + 67, PEER_UDP)) < 0)
+   {
+      perror("server");
+      return 1;
+   }
+   reg_dhcpv4_lease_cbfunc(srv_lease_save, srv_lease_load);
+   for(legacy = 0; legacy < 2; legacy++)
+   {
+      srv_stored = 0;
+      srv_ip[3] = 50;
+      err |= srv_boot(legacy ? "DHCPv4_run()  cold"  : "DHCPv4_poll() cold", legacy);
+      err |= srv_boot(legacy ? "DHCPv4_run()  warm"  : "DHCPv4_poll() warm", legacy);
+      srv_ip[3] = 77;
+      err |= srv_boot(legacy ? "DHCPv4_run()  moved (NAK)" : "DHCPv4_poll() moved (NAK)", legacy);
+   }
+   peer_close(srv_sock);
+   return err;
+}
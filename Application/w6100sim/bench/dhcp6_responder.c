@@ -0,0 +1,168 @@
+/**
+ * @file dhcp6_responder.c
+ * @brief DHCP_poll() of DHCPv6 against a local responder, with and without Rapid Commit.
+ * @details The responder stands in for a DHCPv6 server on loopback UDP 547 (+ port offset). It answers SOLICIT with
+ *          REPLY when both sides want Rapid Commit, or with ADVERTISE otherwise, and answers REQUEST with REPLY.
+ *          The client runs on the w6100sim model with a simulated clock of 10 ms steps, and is polled on the
+ *          events of its socket or when @ref DHCP_next_deadline() expires.\n
+ *          Both runs report the messages exchanged, SPI transfers and simulated time from the first SOLICIT
+ *          to @ref DHCP_IP_ASSIGN.\n
+ *          usage: dhcp6_responder [port_offset]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wizchip_conf.h"
+#include "socket.h"
+#include "dhcpv6.h"
+#include "w6100sim.h"
+#include "sim_peer.h"
+
+#define RESP_STEP_MS     10
+#define RESP_LIMIT_MS    20000
+
+static int      resp_sock;
+static uint8_t  resp_rapid;      // responder commits on SOLICIT with Rapid Commit
+static uint32_t resp_msgs;       // messages received and sent by the responder
+static uint8_t  resp_intn;       // a reply is waiting for the client
+static uint32_t resp_ms;
+
+static const uint8_t resp_duid[10] = {0x00, 0x03, 0x00, 0x01, 0x00, 0x08, 0xdc, 0xaa, 0xbb, 0xcc};
+
+static uint8_t resp_intn_wait(uint32_t timeout)
+{
+   uint8_t ret = resp_intn;
+   (void)timeout;
+   resp_intn = 0;
+   return ret;
+}
+
+static uint32_t resp_clock(void)
+{
+   return resp_ms;
+}
+
+static void resp_put16(uint8_t* p, uint16_t v)
+{
+   p[0] = (uint8_t)(v >> 8);
+   p[1] = (uint8_t)v;
+}
+
+static uint16_t resp_get16(const uint8_t* p)
+{
+   return ((uint16_t)p[0] << 8) | p[1];
+}
+
+static uint16_t resp_opt(uint8_t* p, uint16_t code, const uint8_t* val, uint16_t len)
+{
+   resp_put16(p, code);
+   resp_put16(p + 2, len);
+   if(len) memcpy(p + 4, val, len);
+   return 4 + len;
+}
+
+/* Answer every message of the client waiting on the responder socket */
+static void resp_serve(void)
+{
+   uint8_t msg[512], out[512], ia[40];
+   uint8_t *cid = 0, *iaid = 0, rapid = 0;
+   uint16_t code, olen, k;
+   int len, i;
+
+   while(peer_readable(resp_sock, 0))
+   {
+      if((len = peer_recvfrom(resp_sock, msg, sizeof(msg), 0)) < 4) continue;
+      resp_msgs++;
+      cid = iaid = 0;
+      rapid = 0;
+      for(i = 4; i + 4 <= len; i += 4 + olen)
+      {
+         code = resp_get16(msg + i);
+         olen = resp_get16(msg + i + 2);
+         if(i + 4 + olen > len) break;
+         if(code == 1 && olen == 10) cid = msg + i + 4;
+         if(code == 3 && olen >= 12) iaid = msg + i + 4;
+         if(code == 14) rapid = 1;
+      }
+      if(cid == 0 || iaid == 0 || (msg[0] != 1 && msg[0] != 3)) continue;
+
+      // ADVERTISE (2) to SOLICIT (1), unless both commit. REPLY (7) otherwise
+      out[0] = (msg[0] == 1 && !(rapid && resp_rapid)) ? 2 : 7;
+      memcpy(out + 1, msg + 1, 3);
+      k = 4;
+      k += resp_opt(out + k, 1, cid, 10);
+      k += resp_opt(out + k, 2, resp_duid, sizeof(resp_duid));
+      if(out[0] == 7 && msg[0] == 1) k += resp_opt(out + k, 14, 0, 0);
+      // IA_NA with IAID, T1 0, T2 0 and IA Address 2001:db8::10, preferred 3600 s and valid 7200 s
+      memset(ia, 0, sizeof(ia));
+      memcpy(ia, iaid, 4);
+      resp_put16(ia + 12, 5);
+      resp_put16(ia + 14, 24);
+      ia[16] = 0x20; ia[17] = 0x01; ia[18] = 0x0d; ia[19] = 0xb8; ia[31] = 0x10;
+      resp_put16(ia + 34, 3600);
+      resp_put16(ia + 38, 7200);
+      k += resp_opt(out + k, 3, ia, sizeof(ia));
+      peer_reply(resp_sock, out, k);
+      resp_msgs++;
+      resp_intn = 1;
+   }
+}
+
+/* Acquire an address from a responder with or without Rapid Commit, and return 0 on success */
+static int resp_run(uint16_t offset, uint8_t rapid)
+{
+   static uint8_t buf[DHCP6_MAX_MSG_SIZE];
+   uint8_t mac[6] = {0x00, 0x08, 0xdc, 0x01, 0x02, 0x03};
+   uint32_t x0, x1, t0;
+   uint64_t b0, b1;
+   uint8_t ev, ret = DHCP_RUNNING;
+
+   w6100sim_init(offset);
+   NETUNLOCK();
+   setSHAR(mac);
+   resp_rapid = rapid;
+   resp_msgs = 0;
+   resp_intn = 0;
+   resp_ms = 0;
+   if((resp_sock = peer_listen(offset + 547, PEER_UDP6)) < 0)
+   {
+      perror("responder");
+      return 1;
+   }
+   reg_dhcpv6_clock_cbfunc(resp_clock);
+   reg_wizchip_intn_cbfunc(resp_intn_wait);
+   DHCP_init(0, buf);
+   wiz_event_init(0x01, 0);
+
+   t0 = resp_ms + DHCP_next_deadline();
+   w6100sim_get_count(&x0, &b0);
+   while(ret != DHCP_IP_ASSIGN && resp_ms < RESP_LIMIT_MS)
+   {
+      resp_serve();
+      ev = wiz_wait_events(0x01, 0) ? SIK_RECEIVED : 0;
+      if(ev || DHCP_next_deadline() == 0) ret = DHCP_poll(ev);
+      if(ret == DHCP_IP_ASSIGN) break;
+      resp_ms += RESP_STEP_MS;
+      if(resp_ms % 1000 == 0) DHCP_time_handler();
+   }
+   w6100sim_get_count(&x1, &b1);
+
+   printf("%-29s: ", rapid ? "Rapid Commit server" : "server without Rapid Commit");
+   if(ret != DHCP_IP_ASSIGN) printf("no lease in %u ms\n", (unsigned)RESP_LIMIT_MS);
+   else printf("%u messages, %u SPI transfers, %llu SPI bytes, %u ms from the first SOLICIT\n",
+               resp_msgs, x1 - x0, (unsigned long long)(b1 - b0), resp_ms - t0);
+   DHCP_stop();
+   peer_close(resp_sock);
+   return ret != DHCP_IP_ASSIGN;
+}
+
+int main(int argc, char* argv[])
+{
+   uint16_t offset = (argc > 1) ? (uint16_t)atoi(argv[1]) : 20000;
+   int err = 0;
+
+   err |= resp_run(offset, 1);
+   err |= resp_run(offset, 0);
+   return err;
+}
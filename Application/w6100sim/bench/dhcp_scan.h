@@ -0,0 +1,46 @@
+#ifndef _DHCP_SCAN_H_
+#define _DHCP_SCAN_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Entries of the DHCP option scanner harness.
+ * @details dhcpv4_scan() and dhcp6_parse() are static, so dhcp_scan_v4.c and dhcp_scan_v6.c build dhcpv4.c and dhcpv6.c
+ *          into themselves and call them from here. Both are used by dhcp_scan_bench and by the libFuzzer target dhcp_scan_fuzz.
+ */
+
+/**
+ * @brief Lay out the state the parser checks, such as xid, client ID and IAID, and return a valid message of it.
+ * @param len Length of the message
+ */
+const uint8_t* dhcp_scan_v4_seed(uint16_t* len);
+const uint8_t* dhcp_scan_v6_seed(uint16_t* len);
+
+/**
+ * @brief Parse one message and read every value found, so an overread shows up under ASan.
+ * @return 1 if accepted, 0 if rejected
+ */
+int dhcp_scan_v4(const uint8_t* msg, uint16_t len);
+int dhcp_scan_v6(const uint8_t* msg, uint16_t len);
+
+/**
+ * @brief Parse the seed n times.
+ * @return ns per message
+ */
+double dhcp_scan_v4_bench(long n);
+double dhcp_scan_v6_bench(long n);
+
+/**
+ * @brief Check the REPLY whose first IA_NA is of another IAID, so dhcp6_parse() has to find the second one.
+ * @return 1 if the address of our IA_NA is taken
+ */
+int dhcp_scan_v6_check_iaid(void);
+
+/**
+ * @brief Check the REPLY whose IA_NA has T1 greater than T2, which RFC8415 21.4 tells the client to discard.
+ * @return 1 if dhcp6_parse() rejects it
+ */
+int dhcp_scan_v6_check_t1t2(void);
+
+#endif
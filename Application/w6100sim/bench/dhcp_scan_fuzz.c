@@ -0,0 +1,24 @@
+/**
+ * @file dhcp_scan_fuzz.c
+ * @brief libFuzzer target of dhcpv4_scan() and dhcp6_parse(), built by clang only.
+ * @details The first byte picks the parser, and the rest is the DHCPv4 options or the DHCPv6 message.
+ *          The DHCPv6 template is laid out once, so mutations of a valid REPLY reach the option walks.\n
+ *          build-sim/dhcp_scan_fuzz -max_total_time=60
+ */
+#include "dhcp_scan.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+   static int init = 0;
+   uint16_t len;
+
+   if(!init)
+   {
+      dhcp_scan_v6_seed(&len);
+      init = 1;
+   }
+   if(size < 1 || size > 0xFFFF) return 0;
+   if(data[0] & 1) dhcp_scan_v6(data + 1, (uint16_t)(size - 1));
+   else            dhcp_scan_v4(data + 1, (uint16_t)(size - 1));
+   return 0;
+}
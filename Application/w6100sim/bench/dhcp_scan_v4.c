@@ -0,0 +1,56 @@
+/* dhcpv4_scan() is static, so this file builds dhcpv4.c into itself. Nothing else of the harness links dhcpv4.c. */
+#include <stdlib.h>
+#include <time.h>
+#include "dhcpv4.c"
+#include "dhcp_scan.h"
+
+/* Options of a typical ACK, up to endOption */
+static const uint8_t dhcp_scan_v4_ack[] = {
+	dhcpMessageType, 1, DHCPV4_ACK,
+	dhcpServerIdentifier, 4, 192, 168, 0, 1,
+	dhcpIPaddrLeaseTime, 4, 0, 0, 0x0e, 0x10,
+	subnetMask, 4, 255, 255, 255, 0,
+	routersOnSubnet, 4, 192, 168, 0, 1,
+	dns, 4, 8, 8, 8, 8,
+	dhcpT1value, 4, 0, 0, 0x07, 0x08,
+	dhcpT2value, 4, 0, 0, 0x0c, 0x00,
+	hostName, 3, 'w', 'i', 'z',
+	endOption
+};
+
+const uint8_t* dhcp_scan_v4_seed(uint16_t* len)
+{
+	*len = sizeof(dhcp_scan_v4_ack);
+	return dhcp_scan_v4_ack;
+}
+
+int dhcp_scan_v4(const uint8_t* msg, uint16_t len)
+{
+	dhcpv4_opt_t opt[DHCPV4_O_NUM];
+	volatile uint8_t sum = 0;
+	uint8_t i, k;
+
+	if(dhcpv4_scan((uint8_t*)msg, (uint8_t*)msg + len, opt) < 0) return 0;
+	for(i = 0; i < DHCPV4_O_NUM; i++)
+	{
+		for(k = 0; k < opt[i].len; k++) sum += opt[i].val[k];
+	}
+	return 1;
+}
+
+double dhcp_scan_v4_bench(long n)
+{
+	dhcpv4_opt_t opt[DHCPV4_O_NUM];
+	struct timespec t0, t1;
+	volatile long acc = 0;
+	long i;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for(i = 0; i < n; i++)
+	{
+		acc += dhcpv4_scan((uint8_t*)dhcp_scan_v4_ack, (uint8_t*)dhcp_scan_v4_ack + sizeof(dhcp_scan_v4_ack), opt);
+		acc += opt[DHCPV4_O_LEASE].len;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / n;
+}
@@ -0,0 +1,127 @@
+/* dhcp6_parse() is static, so this file builds dhcpv6.c into itself. Nothing else of the harness links dhcpv6.c. */
+#include <time.h>
+#include "dhcpv6.c"
+#include "dhcp_scan.h"
+
+static uint8_t dhcp_scan_v6_reply[128];
+static uint16_t dhcp_scan_v6_len = 0;
+static uint16_t dhcp_scan_v6_t1 = 1800;
+
+static uint16_t dhcp_scan_v6_opt(uint8_t *p, uint16_t code, const uint8_t *val, uint16_t len)
+{
+    dhcp6_put16(p, code);
+    dhcp6_put16(p + 2, len);
+    if (len)
+        memcpy(p + 4, val, len);
+    return 4 + len;
+}
+
+/* IA_NA of iaid with an IA Address, or without one if addr is NULL */
+static uint16_t dhcp_scan_v6_iana(uint8_t *p, const uint8_t *iaid, const uint8_t *addr)
+{
+    uint8_t v[40];
+
+    memset(v, 0, sizeof(v));
+    memcpy(v, iaid, 4);
+    dhcp6_put16(v + 6, dhcp_scan_v6_t1); // T1
+    dhcp6_put16(v + 10, 2880);           // T2
+    if (addr == 0)
+        return dhcp_scan_v6_opt(p, OPT_IANA, v, 12);
+    dhcp6_put16(v + 12, OPT_IAADDR);
+    dhcp6_put16(v + 14, 24);
+    memcpy(v + 16, addr, 16);
+    dhcp6_put16(v + 34, 3600); // preferred lifetime
+    dhcp6_put16(v + 38, 7200); // valid lifetime
+    return dhcp_scan_v6_opt(p, OPT_IANA, v, 40);
+}
+
+/* REPLY to the template, with an IA_NA of another IAID first if other */
+static uint16_t dhcp_scan_v6_make(uint8_t *msg, uint8_t other)
+{
+    static const uint8_t mac[6] = {0x00, 0x08, 0xdc, 0x01, 0x02, 0x03};
+    static const uint8_t srvid[10] = {0x00, 0x03, 0x00, 0x01, 0x00, 0x08, 0xdc, 0xaa, 0xbb, 0xcc};
+    static const uint8_t addr[16] = {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10, 0x01};
+    static const uint8_t dns6[16] = {0x20, 0x01, 0x48, 0x60, 0x48, 0x60, 0, 0, 0, 0, 0, 0, 0, 0, 0x88, 0x88};
+    static const uint8_t iaid[4] = {0xde, 0xad, 0xbe, 0xef};
+    uint16_t k = 4;
+
+    memcpy(DHCP_CHADDR, mac, 6);
+    dhcp6_make_template();
+    dhcp6_tmpl[0] = DHCP6_SOLICIT;
+    dhcp6_tmpl[1] = 0x12;
+    dhcp6_tmpl[2] = 0x34;
+    dhcp6_tmpl[3] = 0x56;
+
+    memcpy(msg, dhcp6_tmpl, 4);
+    msg[0] = DHCP6_REPLY;
+    k += dhcp_scan_v6_opt(msg + k, OPT_CLIENTID, dhcp6_tmpl + DHCP6_OFF_CLIENTID + 4, 10);
+    k += dhcp_scan_v6_opt(msg + k, OPT_SERVERID, srvid, sizeof(srvid));
+    k += dhcp_scan_v6_opt(msg + k, OPT_RAPID_COMMIT, 0, 0);
+    k += dhcp_scan_v6_opt(msg + k, DNS_RecursiveNameServer, dns6, sizeof(dns6));
+    if (other)
+        k += dhcp_scan_v6_iana(msg + k, iaid, 0);
+    k += dhcp_scan_v6_iana(msg + k, dhcp6_tmpl + DHCP6_OFF_IANA + 4, addr);
+    return k;
+}
+
+const uint8_t *dhcp_scan_v6_seed(uint16_t *len)
+{
+    dhcp_scan_v6_len = dhcp_scan_v6_make(dhcp_scan_v6_reply, 0);
+    *len = dhcp_scan_v6_len;
+    return dhcp_scan_v6_reply;
+}
+
+int dhcp_scan_v6(const uint8_t *msg, uint16_t len)
+{
+    dhcp6_reply_t r;
+    volatile uint8_t sum = 0;
+    uint16_t k;
+
+    if (dhcp6_parse((uint8_t *)msg, len, &r) == 0)
+        return 0;
+    for (k = 0; k < r.srvid_len; k++)
+        sum += r.srvid[k];
+    if (r.dns)
+        for (k = 0; k < 16; k++)
+            sum += r.dns[k];
+    return 1;
+}
+
+double dhcp_scan_v6_bench(long n)
+{
+    dhcp6_reply_t r;
+    struct timespec t0, t1;
+    volatile long acc = 0;
+    long i;
+
+    if (dhcp_scan_v6_len == 0)
+        dhcp_scan_v6_seed(&dhcp_scan_v6_len);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < n; i++)
+        acc += dhcp6_parse(dhcp_scan_v6_reply, dhcp_scan_v6_len, &r) + r.has_addr;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / n;
+}
+
+int dhcp_scan_v6_check_iaid(void)
+{
+    uint8_t msg[128];
+    uint16_t len = dhcp_scan_v6_make(msg, 1);
+    dhcp6_reply_t r;
+
+    if (dhcp6_parse(msg, len, &r) != DHCP6_REPLY)
+        return 0;
+    return r.has_addr && (r.addr[15] == 0x01) && (r.valid_life == 7200) && (r.t1 == 1800);
+}
+
+int dhcp_scan_v6_check_t1t2(void)
+{
+    uint8_t msg[128];
+    uint16_t len;
+    dhcp6_reply_t r;
+
+    dhcp_scan_v6_t1 = 3000;
+    len = dhcp_scan_v6_make(msg, 0);
+    dhcp_scan_v6_t1 = 1800;
+    return dhcp6_parse(msg, len, &r) == 0;
+}
@@ -0,0 +1,154 @@
+/* dns_parseanswer() and dns_getname() are static, so this file builds dns.c into itself. Nothing else of the harness links dns.c. */
+#include <time.h>
+#include "dns.c"
+#include "dns_scan.h"
+
+/* dns_makequery() of the legacy DNS_run() takes the query type from the application */
+uint8_t IP_TYPE = DNS_TYPE_A;
+
+/* Response to www.wiznet.io A, a CNAME to wiznet.github.io compressed against the question, and its address */
+static const uint8_t dns_scan_a[] = {
+	0x11, 0x22, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+	3, 'w', 'w', 'w', 6, 'w', 'i', 'z', 'n', 'e', 't', 2, 'i', 'o', 0, 0x00, 0x01, 0x00, 0x01,
+	0xc0, 0x0c, 0x00, 0x05, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c, 0x00, 0x10,
+	6, 'w', 'i', 'z', 'n', 'e', 't', 6, 'g', 'i', 't', 'h', 'u', 'b', 0xc0, 0x17,
+	0xc0, 0x2b, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04, 185, 199, 108, 153
+};
+
+/* Response to ipv6.wiznet.io AAAA, one answer compressed against the question */
+static const uint8_t dns_scan_aaaa[] = {
+	0x33, 0x44, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+	4, 'i', 'p', 'v', '6', 6, 'w', 'i', 'z', 'n', 'e', 't', 2, 'i', 'o', 0, 0x00, 0x1c, 0x00, 0x01,
+	0xc0, 0x0c, 0x00, 0x1c, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x10,
+	0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x00, 0x10
+};
+
+const uint8_t* dns_scan_seed(uint8_t aaaa, uint16_t* len)
+{
+	*len = aaaa ? sizeof(dns_scan_aaaa) : sizeof(dns_scan_a);
+	return aaaa ? dns_scan_aaaa : dns_scan_a;
+}
+
+int dns_scan(const uint8_t* msg, uint16_t len)
+{
+	uint8_t* m = (uint8_t*)msg;
+	uint8_t* end = m + len;
+	uint8_t* cp;
+	char name[MAX_DOMAIN_NAME + 1];
+	char rname[MAX_DOMAIN_NAME + 1];
+	uint8_t ip[16];
+	uint32_t ttl;
+	volatile uint8_t sum = 0;
+	uint16_t i, rdlen;
+	int16_t n;
+	int ret = 0;
+
+	if(len < 12) return 0;
+	if(dns_getname(m, end, m + 12, name, sizeof(name)) < 0) return 0;
+	ret |= dns_parseanswer(m, len, (uint8_t*)name, DNS_TYPE_A, ip, &ttl);
+	ret |= dns_parseanswer(m, len, (uint8_t*)name, DNS_TYPE_AAAA, ip, &ttl);
+
+	/* Decode every owner name and CNAME of the answers, as a client following the chain does */
+	if((cp = dns_question(m + 12, end)) == 0) return ret;
+	for(i = get16(&m[6]); i > 0; i--)
+	{
+		if((n = parse_name(m, len, cp, rname, sizeof(rname))) < 0) return ret;
+		for(n = 0; rname[n]; n++) sum += rname[n];
+		if((n = dns_skipname(cp, end)) < 0 || (cp + n + 10 > end)) return ret;
+		cp += n;
+		rdlen = get16(cp + 8);
+		if(cp + 10 + rdlen > end) return ret;
+		if((get16(cp) == TYPE_CNAME) && (dns_getname(m, end, cp + 10, rname, sizeof(rname)) >= 0))
+			for(n = 0; rname[n]; n++) sum += rname[n];
+		cp += 10 + rdlen;
+	}
+	return ret;
+}
+
+double dns_scan_bench(long n)
+{
+	char name[MAX_DOMAIN_NAME + 1];
+	uint8_t ip[16];
+	uint32_t ttl;
+	struct timespec t0, t1;
+	volatile long acc = 0;
+	long i;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for(i = 0; i < n; i++)
+	{
+		acc += dns_getname((uint8_t*)dns_scan_a, (uint8_t*)dns_scan_a + sizeof(dns_scan_a), (uint8_t*)dns_scan_a + 12, name, sizeof(name));
+		acc += dns_parseanswer((uint8_t*)dns_scan_a, sizeof(dns_scan_a), (uint8_t*)name, DNS_TYPE_A, ip, &ttl);
+		acc += ip[3];
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / n;
+}
+
+/* Question name of msg replaced by name of len bytes, and the header of a response without answers */
+static uint16_t dns_scan_make(uint8_t* msg, const uint8_t* name, uint16_t len)
+{
+	memcpy(msg, dns_scan_a, 12);
+	msg[7] = 0;
+	memcpy(msg + 12, name, len);
+	return 12 + len;
+}
+
+const char* dns_scan_check(void)
+{
+	/* Names at offset 12 of the message */
+	static const uint8_t self_ptr[]  = {0xc0, 0x0c};                       // points to itself
+	static const uint8_t fwd_ptr[]   = {0xc0, 0x0e, 0xc0, 0x0c};           // points forward, back to the first
+	static const uint8_t label_loop[]= {1, 'a', 0xc0, 0x0c};               // a label and a pointer back to it
+	static const uint8_t cut_label[] = {3, 'w', 'w', 'w', 6, 'w', 'i'};    // label longer than the message
+	static const uint8_t cut_ptr[]   = {3, 'w', 'w', 'w', 0xc0};           // pointer of one byte
+	static const uint8_t bad_len[]   = {0x40, 'a', 0};                     // reserved label type
+	static const struct { const char* what; const uint8_t* name; uint16_t len; } bad[] = {
+		{"self pointer",            self_ptr,   sizeof(self_ptr)},
+		{"forward pointer loop",    fwd_ptr,    sizeof(fwd_ptr)},
+		{"backward label loop",     label_loop, sizeof(label_loop)},
+		{"truncated label",         cut_label,  sizeof(cut_label)},
+		{"truncated pointer",       cut_ptr,    sizeof(cut_ptr)},
+		{"reserved label type",     bad_len,    sizeof(bad_len)},
+	};
+	uint8_t msg[64];
+	char name[1024];
+	uint8_t ip[16];
+	uint32_t ttl;
+	uint16_t len, i;
+
+	for(i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+	{
+		len = dns_scan_make(msg, bad[i].name, bad[i].len);
+		// a buffer larger than the labels of a loop, so only DNS_MAX_LABELS or the message end stops it
+		if(dns_getname(msg, msg + len, msg + 12, name, sizeof(name)) >= 0) return bad[i].what;
+		if(parse_name(msg, len, msg + 12, name, sizeof(name)) >= 0)      return bad[i].what;
+		if(dns_parseanswer(msg, len, (uint8_t*)"a", DNS_TYPE_A, ip, &ttl)) return bad[i].what;
+	}
+
+	/* Name too long for the buffer */
+	if(parse_name((uint8_t*)dns_scan_a, sizeof(dns_scan_a), (uint8_t*)dns_scan_a + 12, name, 13) >= 0)
+		return "name longer than the buffer";
+
+	/* The seeds: the address after the CNAME with the lowest TTL of the chain, and the address of AAAA */
+	if((dns_getname((uint8_t*)dns_scan_a, (uint8_t*)dns_scan_a + sizeof(dns_scan_a), (uint8_t*)dns_scan_a + 12, name, sizeof(name)) != 13) ||
+	   strcmp(name, "www.wiznet.io") ||
+	   !dns_parseanswer((uint8_t*)dns_scan_a, sizeof(dns_scan_a), (uint8_t*)"WWW.wiznet.IO", DNS_TYPE_A, ip, &ttl) ||
+	   (ip[0] != 185) || (ip[3] != 153) || (ttl != 60))
+		return "A response with CNAME";
+	if((dns_getname((uint8_t*)dns_scan_a, (uint8_t*)dns_scan_a + sizeof(dns_scan_a), (uint8_t*)dns_scan_a + 43, name, sizeof(name)) < 0) ||
+	   strcmp(name, "wiznet.github.io"))
+		return "CNAME compressed against the question";
+	if(!dns_parseanswer((uint8_t*)dns_scan_aaaa, sizeof(dns_scan_aaaa), (uint8_t*)"ipv6.wiznet.io", DNS_TYPE_AAAA, ip, &ttl) ||
+	   (ip[0] != 0x20) || (ip[15] != 0x10) || (ttl != 120))
+		return "AAAA response";
+	if(dns_parseanswer((uint8_t*)dns_scan_aaaa, sizeof(dns_scan_aaaa), (uint8_t*)"ipv6.wiznet.com", DNS_TYPE_AAAA, ip, &ttl))
+		return "answer to another name";
+	/* Every response truncated before its address is rejected */
+	for(len = 0; len < sizeof(dns_scan_a); len++)
+	{
+		if(dns_parseanswer((uint8_t*)dns_scan_a, len, (uint8_t*)"www.wiznet.io", DNS_TYPE_A, ip, &ttl))
+			return "truncated response";
+	}
+	return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef _DNS_SCAN_H_
+#define _DNS_SCAN_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Entries of the DNS response parser harness.
+ * @details dns_parseanswer() and dns_getname() are static, so dns_scan.c builds dns.c into itself and calls them from here.
+ *          They are used by dns_scan_bench and by the libFuzzer target dns_scan_fuzz.
+ */
+
+/**
+ * @brief Return a response of www.wiznet.io A with a CNAME, or of ipv6.wiznet.io AAAA if aaaa.
+ * @param len Length of the response
+ */
+const uint8_t* dns_scan_seed(uint8_t aaaa, uint16_t* len);
+
+/**
+ * @brief Parse one response as the resolver does: the question name by dns_getname(), the answer of A and AAAA
+ *        by dns_parseanswer(), and every answer name and CNAME by parse_name() and dns_getname().
+ *        Every byte decoded is read, so an overread shows up under ASan.
+ * @return 1 if an address is found, 0 if not
+ */
+int dns_scan(const uint8_t* msg, uint16_t len);
+
+/**
+ * @brief Resolve the A seed n times, dns_getname() of the question and dns_parseanswer().
+ * @return ns per response
+ */
+double dns_scan_bench(long n);
+
+/**
+ * @brief Check the names of pointer loops, truncated labels and pointers, and reserved label types are rejected,
+ *        and the seeds are resolved.
+ * @return 0 if passed, or the case failed
+ */
+const char* dns_scan_check(void);
+
+#endif
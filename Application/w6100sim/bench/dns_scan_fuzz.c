@@ -0,0 +1,14 @@
+/**
+ * @file dns_scan_fuzz.c
+ * @brief libFuzzer target of the DNS response parser, built by clang only.
+ * @details The input is a whole response, parsed by @ref dns_scan() from the question name to the last answer.\n
+ *          build-sim/dns_scan_fuzz -max_total_time=60
+ */
+#include "dns_scan.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+   if(size > 0xFFFF) return 0;
+   dns_scan(data, (uint16_t)size);
+   return 0;
+}
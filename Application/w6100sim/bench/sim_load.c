@@ -0,0 +1,163 @@
+/**
+ * @file sim_load.c
+ * @brief TCP echo load test of @ref socket.c on the w6100sim model.
+ * @details The chip runs an echo server on n sockets in non-block io mode, and a host peer connected to each
+ *          socket sends m messages of s bytes and checks every echo.
+ *          SPI transfers and bytes are counted by @ref w6100sim_get_count() over the echo rounds only,
+ *          so the figures per message are the cost of one wiz_recv() and wiz_send() round trip.\n
+ *          usage: sim_load [-n sockets] [-m messages] [-s size] [-x xfer_ns] [-b byte_ns] [-p port_offset]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "wizchip_conf.h"
+#include "socket.h"
+#include "w6100sim.h"
+#include "sim_peer.h"
+
+#define LOAD_PORT       5000
+#define LOAD_MAX_SIZE   2048
+
+static uint8_t load_buf[_WIZCHIP_SOCK_NUM_][LOAD_MAX_SIZE];
+static uint8_t load_msg[LOAD_MAX_SIZE];
+static uint8_t load_echo[LOAD_MAX_SIZE];
+
+static int load_usage(void)
+{
+   fprintf(stderr, "usage: sim_load [-n sockets] [-m messages] [-s size] [-x xfer_ns] [-b byte_ns] [-p port_offset]\n");
+   return 2;
+}
+
+int main(int argc, char* argv[])
+{
+   int n = 4, m = 1000, size = 256, c, i, sn, round;
+   uint32_t xfer_ns = 0, byte_ns = 0, xfer0, xfer1;
+   uint16_t offset = 20000;
+   uint64_t bytes0, bytes1, t0, t1;
+   uint8_t bufsize[_WIZCHIP_SOCK_NUM_] = {2,2,2,2,2,2,2,2};
+   uint8_t sip[4] = {192,168,0,10};
+   int peer[_WIZCHIP_SOCK_NUM_];
+   datasize_t got[_WIZCHIP_SOCK_NUM_], txlen[_WIZCHIP_SOCK_NUM_], txoff[_WIZCHIP_SOCK_NUM_];
+   datasize_t ret;
+   double msgs;
+
+   while((c = getopt(argc, argv, "n:m:s:x:b:p:")) != -1)
+   {
+      switch(c)
+      {
+      case 'n': n = atoi(optarg); break;
+      case 'm': m = atoi(optarg); break;
+      case 's': size = atoi(optarg); break;
+      case 'x': xfer_ns = (uint32_t)atoi(optarg); break;
+      case 'b': byte_ns = (uint32_t)atoi(optarg); break;
+      case 'p': offset = (uint16_t)atoi(optarg); break;
+      default : return load_usage();
+      }
+   }
+   if(n < 1 || n > _WIZCHIP_SOCK_NUM_ || m < 1 || size < 1 || size > LOAD_MAX_SIZE) return load_usage();
+
+   w6100sim_init(offset);
+   if(wizchip_init(bufsize, bufsize) != 0) return 1;
+   NETUNLOCK();
+   setSIPR(sip);
+
+   for(sn = 0; sn < n; sn++)
+   {
+      if(wiz_socket(sn, Sn_MR_TCP4, LOAD_PORT + sn, SF_IO_NONBLOCK) != sn || wiz_listen(sn) != SOCK_OK)
+      {
+         fprintf(stderr, "socket %d: listen failed\n", sn);
+         return 1;
+      }
+      if((peer[sn] = peer_connect(offset + LOAD_PORT + sn)) < 0)
+      {
+         perror("peer_connect");
+         return 1;
+      }
+      while(getSn_SR(sn) != SOCK_ESTABLISHED);
+      setSn_IRCLR(sn, Sn_IR_CON);
+   }
+   for(i = 0; i < size; i++) load_msg[i] = (uint8_t)i;
+
+   w6100sim_set_latency(xfer_ns, byte_ns);
+   w6100sim_get_count(&xfer0, &bytes0);
+   t0 = peer_now_ns();
+   for(round = 0; round < m; round++)
+   {
+      int busy = n;
+      load_msg[0] = (uint8_t)round;
+      for(sn = 0; sn < n; sn++)
+      {
+         if(peer_send(peer[sn], load_msg, size) != size)
+         {
+            perror("peer_send");
+            return 1;
+         }
+         got[sn] = txlen[sn] = txoff[sn] = 0;
+      }
+      // echo on the chip until every socket has sent back all the bytes of the round
+      while(busy)
+      {
+         busy = 0;
+         for(sn = 0; sn < n; sn++)
+         {
+            if(txoff[sn] < txlen[sn])
+            {
+               ret = wiz_send(sn, load_buf[sn] + txoff[sn], txlen[sn] - txoff[sn]);
+               if(ret > 0) txoff[sn] += ret;
+            }
+            else if(got[sn] < size)
+            {
+               ret = wiz_recv(sn, load_buf[sn], size - got[sn]);
+               if(ret > 0)
+               {
+                  got[sn] += ret;
+                  txlen[sn] = ret;
+                  txoff[sn] = 0;
+               }
+            }
+            else continue;
+            if(ret < 0)
+            {
+               fprintf(stderr, "socket %d: error %d\n", sn, (int)ret);
+               return 1;
+            }
+            busy = 1;
+         }
+      }
+      for(sn = 0; sn < n; sn++)
+      {
+         for(i = 0; i < size; i += ret)
+         {
+            if((ret = peer_recv(peer[sn], load_echo + i, size - i)) <= 0)
+            {
+               perror("peer_recv");
+               return 1;
+            }
+         }
+         if(memcmp(load_echo, load_msg, size))
+         {
+            fprintf(stderr, "socket %d: bad echo in round %d\n", sn, round);
+            return 1;
+         }
+      }
+   }
+   t1 = peer_now_ns();
+   w6100sim_get_count(&xfer1, &bytes1);
+   w6100sim_set_latency(0, 0);
+
+   msgs = (double)n * m;
+   printf("sockets %d, messages %d x %d bytes, SPI latency %u ns + %u ns/byte\n", n, m, size, xfer_ns, byte_ns);
+   printf("SPI transfers %u (%.1f/message), SPI bytes %llu (%.1f/message)\n",
+          xfer1 - xfer0, (xfer1 - xfer0) / msgs, (unsigned long long)(bytes1 - bytes0), (bytes1 - bytes0) / msgs);
+   printf("elapsed %.3f s, %.1f us/message, %.0f messages/s\n",
+          (t1 - t0) / 1e9, (t1 - t0) / 1e3 / msgs, msgs * 1e9 / (t1 - t0));
+
+   for(sn = 0; sn < n; sn++)
+   {
+      peer_close(peer[sn]);
+      wiz_close(sn);
+   }
+   return 0;
+}
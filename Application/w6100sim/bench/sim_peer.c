@@ -0,0 +1,127 @@
+#define _GNU_SOURCE
+#include "sim_peer.h"
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+static struct sockaddr_storage peer_last;
+static socklen_t peer_lastlen;
+
+/* socket.c has setsockopt() of its own, so the host one is called by syscall. */
+static void peer_reuse(int s)
+{
+   int on = 1;
+   syscall(SYS_setsockopt, s, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+}
+
+static struct sockaddr_in peer_addr4(uint16_t port)
+{
+   struct sockaddr_in a;
+   memset(&a, 0, sizeof(a));
+   a.sin_family = AF_INET;
+   a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   a.sin_port = htons(port);
+   return a;
+}
+
+int peer_connect(uint16_t port)
+{
+   struct sockaddr_in a = peer_addr4(port);
+   int s = socket(AF_INET, SOCK_STREAM, 0);
+   if(s < 0) return -1;
+   if(connect(s, (struct sockaddr*)&a, sizeof(a)) < 0)
+   {
+      close(s);
+      return -1;
+   }
+   return s;
+}
+
+int peer_listen(uint16_t port, uint8_t type)
+{
+   int s, ret;
+   if(type == PEER_UDP6)
+   {
+      struct sockaddr_in6 a6;
+      memset(&a6, 0, sizeof(a6));
+      a6.sin6_family = AF_INET6;
+      a6.sin6_addr = in6addr_loopback;
+      a6.sin6_port = htons(port);
+      if((s = socket(AF_INET6, SOCK_DGRAM, 0)) < 0) return -1;
+      peer_reuse(s);
+      ret = bind(s, (struct sockaddr*)&a6, sizeof(a6));
+   }
+   else
+   {
+      struct sockaddr_in a = peer_addr4(port);
+      if((s = socket(AF_INET, type == PEER_TCP ? SOCK_STREAM : SOCK_DGRAM, 0)) < 0) return -1;
+      peer_reuse(s);
+      ret = bind(s, (struct sockaddr*)&a, sizeof(a));
+      if(ret == 0 && type == PEER_TCP) ret = listen(s, 8);
+   }
+   if(ret < 0)
+   {
+      close(s);
+      return -1;
+   }
+   return s;
+}
+
+int peer_accept(int s)
+{
+   return accept(s, 0, 0);
+}
+
+int peer_send(int s, const void* buf, int len)
+{
+   return send(s, buf, len, MSG_NOSIGNAL);
+}
+
+int peer_recv(int s, void* buf, int len)
+{
+   return recv(s, buf, len, 0);
+}
+
+int peer_close(int s)
+{
+   return close(s);
+}
+
+int peer_readable(int s, int timeout_ms)
+{
+   struct pollfd p;
+   p.fd = s;
+   p.events = POLLIN;
+   p.revents = 0;
+   return poll(&p, 1, timeout_ms) > 0;
+}
+
+int peer_recvfrom(int s, void* buf, int len, uint16_t* port)
+{
+   int ret;
+   peer_lastlen = sizeof(peer_last);
+   ret = recvfrom(s, buf, len, 0, (struct sockaddr*)&peer_last, &peer_lastlen);
+   if(ret >= 0 && port)
+   {
+      if(peer_last.ss_family == AF_INET6) *port = ntohs(((struct sockaddr_in6*)&peer_last)->sin6_port);
+      else                                *port = ntohs(((struct sockaddr_in*)&peer_last)->sin_port);
+   }
+   return ret;
+}
+
+int peer_reply(int s, const void* buf, int len)
+{
+   return sendto(s, buf, len, 0, (struct sockaddr*)&peer_last, peer_lastlen);
+}
+
+uint64_t peer_now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
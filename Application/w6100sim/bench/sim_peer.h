@@ -0,0 +1,54 @@
+#ifndef _SIM_PEER_H_
+#define _SIM_PEER_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Host side peers of the w6100sim benchmarks.
+ * @details Plain loopback sockets that stand in for the remote hosts of the chip sockets.
+ *          Every port here is a host port, so the caller adds the port_offset given to @ref w6100sim_init().\n
+ *          Functions return the host socket or byte count, or -1 with errno set, like the host calls they wrap.
+ */
+
+#define PEER_TCP     1
+#define PEER_UDP     2
+#define PEER_UDP6    3
+
+/**
+ * @brief Open a TCP connection to 127.0.0.1:port.
+ */
+int peer_connect(uint16_t port);
+
+/**
+ * @brief Open a listening TCP socket (@ref PEER_TCP) or a bound UDP socket (@ref PEER_UDP, @ref PEER_UDP6) on loopback.
+ */
+int peer_listen(uint16_t port, uint8_t type);
+
+int peer_accept(int s);
+int peer_send(int s, const void* buf, int len);
+int peer_recv(int s, void* buf, int len);
+int peer_close(int s);
+
+/**
+ * @brief Wait until s is readable.
+ * @return 1 when readable, 0 on timeout.
+ */
+int peer_readable(int s, int timeout_ms);
+
+/**
+ * @brief Receive a datagram and keep its source for @ref peer_reply().
+ * @param port Source port of the datagram, or NULL.
+ */
+int peer_recvfrom(int s, void* buf, int len, uint16_t* port);
+
+/**
+ * @brief Send a datagram to the source of the last @ref peer_recvfrom().
+ */
+int peer_reply(int s, const void* buf, int len);
+
+/**
+ * @brief Get the monotonic time in ns.
+ */
+uint64_t peer_now_ns(void);
+
+#endif
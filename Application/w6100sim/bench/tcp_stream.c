@@ -0,0 +1,140 @@
+/**
+ * @file tcp_stream.c
+ * @brief TCP send throughput of @ref SOCK_SEND_SERIAL against @ref SOCK_SEND_STREAM on the w6100sim model.
+ * @details The chip connects to a host peer that reads everything on a thread of its own, and sends
+ *          the same bytes in chunks with wiz_send() in block io mode, once in each send mode.
+ *          Each TCP SEND is held on the wire by @ref w6100sim_set_wire(), so SOCK_SEND_SERIAL waits for it
+ *          on every chunk while SOCK_SEND_STREAM appends the next chunks behind it.\n
+ *          Both runs report Sn_CR_SEND commands and SPI transfers up to the last wiz_send() or wiz_send_flush(),
+ *          and the throughput until the peer has every byte.\n
+ *          usage: tcp_stream [-t total] [-c chunk] [-w send_ns] [-y byte_ns] [-x xfer_ns] [-b byte_ns] [-p port_offset]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "wizchip_conf.h"
+#include "socket.h"
+#include "w6100sim.h"
+#include "sim_peer.h"
+
+#define STREAM_PORT       7000
+#define STREAM_MAX_CHUNK  2048
+
+static int      stream_peer;
+static long     stream_total;
+static volatile long stream_got;
+
+static int stream_usage(void)
+{
+   fprintf(stderr, "usage: tcp_stream [-t total] [-c chunk] [-w send_ns] [-y byte_ns] [-x xfer_ns] [-b byte_ns] [-p port_offset]\n");
+   return 2;
+}
+
+/* Peer side, read until the run has every byte */
+static void* stream_reader(void* arg)
+{
+   uint8_t buf[16384];
+   int ret;
+   (void)arg;
+   while(stream_got < stream_total)
+   {
+      if((ret = peer_recv(stream_peer, buf, sizeof(buf))) <= 0) break;
+      stream_got += ret;
+   }
+   return 0;
+}
+
+static int stream_run(uint16_t offset, uint8_t mode, int chunk)
+{
+   static uint8_t data[STREAM_MAX_CHUNK];
+   uint8_t dip[4] = {192, 168, 0, 100};
+   uint32_t x0, x1, s0, s1;
+   uint64_t b0, b1, t0, t1;
+   pthread_t th;
+   long sent = 0;
+   int l, ret;
+
+   if((l = peer_listen(offset + STREAM_PORT, PEER_TCP)) < 0)
+   {
+      perror("peer_listen");
+      return 1;
+   }
+   if((wiz_socket(0, Sn_MR_TCP4, 0, 0) != 0) || (ctlsocket(0, CS_SET_SENDMODE, &mode) != SOCK_OK) ||
+      (wiz_connect(0, dip, STREAM_PORT, 4) != SOCK_OK) || ((stream_peer = peer_accept(l)) < 0))
+   {
+      fprintf(stderr, "connect failed\n");
+      return 1;
+   }
+   peer_close(l);
+   stream_got = 0;
+   pthread_create(&th, 0, stream_reader, 0);
+
+   memset(data, mode ? 's' : 'r', sizeof(data));
+   w6100sim_get_count(&x0, &b0);
+   s0 = w6100sim_get_send_count();
+   t0 = peer_now_ns();
+   while(sent < stream_total)
+   {
+      l = (stream_total - sent < chunk) ? (int)(stream_total - sent) : chunk;
+      if((ret = wiz_send(0, data, l)) <= 0)
+      {
+         fprintf(stderr, "wiz_send: %d\n", ret);
+         return 1;
+      }
+      sent += ret;
+   }
+   if(mode == SOCK_SEND_STREAM) wiz_send_flush(0);
+   s1 = w6100sim_get_send_count();
+   w6100sim_get_count(&x1, &b1);
+   while(stream_got < stream_total) getSn_IR(0);   // keep the model polled until the peer has all
+   t1 = peer_now_ns();
+   pthread_join(th, 0);
+
+   printf("%-17s: %u Sn_CR_SEND, %u SPI transfers, %.1f SPI/chunk, %.3f s, %.2f MB/s\n",
+          mode ? "SOCK_SEND_STREAM" : "SOCK_SEND_SERIAL", s1 - s0, x1 - x0,
+          (double)(x1 - x0) * chunk / stream_total, (t1 - t0) / 1e9, stream_total * 1e3 / (t1 - t0));
+   wiz_close(0);
+   peer_close(stream_peer);
+   return 0;
+}
+
+int main(int argc, char* argv[])
+{
+   uint8_t bufsize[_WIZCHIP_SOCK_NUM_] = {2,2,2,2,2,2,2,2};
+   uint8_t sip[4] = {192,168,0,10};
+   uint32_t wire_ns = 20000, wire_byte_ns = 80, xfer_ns = 0, byte_ns = 0;
+   uint16_t offset = 20000;
+   int chunk = 100, c, err = 0;
+
+   stream_total = 1000000;
+   while((c = getopt(argc, argv, "t:c:w:y:x:b:p:")) != -1)
+   {
+      switch(c)
+      {
+      case 't': stream_total = atol(optarg); break;
+      case 'c': chunk = atoi(optarg); break;
+      case 'w': wire_ns = (uint32_t)atoi(optarg); break;
+      case 'y': wire_byte_ns = (uint32_t)atoi(optarg); break;
+      case 'x': xfer_ns = (uint32_t)atoi(optarg); break;
+      case 'b': byte_ns = (uint32_t)atoi(optarg); break;
+      case 'p': offset = (uint16_t)atoi(optarg); break;
+      default : return stream_usage();
+      }
+   }
+   if(stream_total < 1 || chunk < 1 || chunk > STREAM_MAX_CHUNK) return stream_usage();
+
+   w6100sim_init(offset);
+   if(wizchip_init(bufsize, bufsize) != 0) return 1;
+   NETUNLOCK();
+   setSIPR(sip);
+   w6100sim_set_latency(xfer_ns, byte_ns);
+   w6100sim_set_wire(wire_ns, wire_byte_ns);
+   printf("%ld bytes in %d-byte chunks, wire %u ns + %u ns/byte per SEND, SPI %u ns + %u ns/byte\n",
+          stream_total, chunk, wire_ns, wire_byte_ns, xfer_ns, byte_ns);
+   err |= stream_run(offset, SOCK_SEND_SERIAL, chunk);
+   err |= stream_run(offset, SOCK_SEND_STREAM, chunk);
+   return err;
+}
@@ -0,0 +1,800 @@
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+#include "w6100sim.h"
+
+#if defined(__linux__)
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define SIM_SOCK_NUM     8
+#define SIM_CREG_SIZE    0x4400
+#define SIM_SREG_SIZE    0x0240
+#define SIM_BUF_SIZE     0x4000
+
+#define SIM_CIDR         0x0000
+#define SIM_VER          0x0002
+#define SIM_SYSR         0x2000
+#define SIM_SYCR0        0x2004
+#define SIM_TCNTR        0x2016
+#define SIM_TCNTRCLR     0x2020
+#define SIM_IR           0x2100
+#define SIM_SIR          0x2101
+#define SIM_SLIR         0x2102
+#define SIM_IRCLR        0x2108
+#define SIM_SLIRCLR      0x2128
+#define SIM_SLCR         0x2130
+#define SIM_PHYSR        0x3000
+#define SIM_CHPLCKR      0x41F4
+#define SIM_NETLCKR      0x41F5
+#define SIM_PHYLCKR      0x41F6
+#define SIM_RTR          0x4200
+#define SIM_RCR          0x4204
+
+#define SIM_Sn_MR        0x0000
+#define SIM_Sn_CR        0x0010
+#define SIM_Sn_IR        0x0020
+#define SIM_Sn_IMR       0x0024
+#define SIM_Sn_IRCLR     0x0028
+#define SIM_Sn_SR        0x0030
+#define SIM_Sn_ESR       0x0031
+#define SIM_Sn_TTLR      0x0108
+#define SIM_Sn_PORTR     0x0114
+#define SIM_Sn_DIPR      0x0120
+#define SIM_Sn_DIP6R     0x0130
+#define SIM_Sn_DPORTR    0x0140
+#define SIM_Sn_RTR       0x0180
+#define SIM_Sn_RCR       0x0184
+#define SIM_Sn_TX_BSR    0x0200
+#define SIM_Sn_TX_FSR    0x0204
+#define SIM_Sn_TX_RD     0x0208
+#define SIM_Sn_TX_WR     0x020C
+#define SIM_Sn_RX_BSR    0x0220
+#define SIM_Sn_RX_RSR    0x0224
+#define SIM_Sn_RX_RD     0x0228
+#define SIM_Sn_RX_WR     0x022C
+
+#define SIM_PACK_IPv6    (1<<7)   // PACKET INFO of IPv6 datagram, same as PACK_IPv6 of socket.h
+
+typedef struct {
+   int      fd[2];          // host socket, [0] TCP or UDP over IPv4, [1] UDP over IPv6
+   uint8_t  sending;        // SEND is in progress until Sn_TX_RD reaches send_end
+   uint16_t send_end;
+   uint64_t deadline;       // ns timeout of SYNSENT and FIN_WAIT
+   uint64_t send_at;        // ns the SEND in progress leaves the wire, 0 at once
+   uint8_t  last_dip[16];   // destination of last UDP send
+   uint8_t  last_diplen;
+   uint16_t last_dport;
+} sim_sock;
+
+static pthread_mutex_t sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint16_t sim_port_offset = 0;
+static uint32_t sim_xfer_ns = 0;
+static uint32_t sim_byte_ns = 0;
+static uint32_t sim_xfer_count = 0;
+static uint64_t sim_byte_count = 0;
+static uint32_t sim_wire_send_ns = 0;
+static uint32_t sim_wire_byte_ns = 0;
+static uint32_t sim_send_count = 0;
+static uint64_t sim_tcnt_base = 0;    // ns of TCNTR 0
+static uint8_t  sim_unreach_ip[16];   // destination of UDP SEND that fails ARP or ND
+static uint8_t  sim_unreach_len = 0;
+
+#define SIM_SOCK_INIT    {{-1,-1}, 0, 0, 0, 0, {0}, 0, 0}
+static sim_sock sim_sn[SIM_SOCK_NUM] = {
+   SIM_SOCK_INIT, SIM_SOCK_INIT, SIM_SOCK_INIT, SIM_SOCK_INIT,
+   SIM_SOCK_INIT, SIM_SOCK_INIT, SIM_SOCK_INIT, SIM_SOCK_INIT
+};
+static uint8_t sim_creg[SIM_CREG_SIZE];
+static uint8_t sim_sreg[SIM_SOCK_NUM][SIM_SREG_SIZE];
+static uint8_t sim_txbuf[SIM_SOCK_NUM][SIM_BUF_SIZE];
+static uint8_t sim_rxbuf[SIM_SOCK_NUM][SIM_BUF_SIZE];
+static uint8_t sim_tmp[SIM_BUF_SIZE];
+
+static void sim_poll(uint8_t sn);
+
+/* socket.c has setsockopt() and getsockopt() of its own, so the host ones are called by syscall. */
+static int sim_setsockopt(int fd, int level, int name, const void* val, socklen_t len)
+{
+   return syscall(SYS_setsockopt, fd, level, name, val, len);
+}
+
+static int sim_getsockopt(int fd, int level, int name, void* val, socklen_t* len)
+{
+   return syscall(SYS_getsockopt, fd, level, name, val, len);
+}
+
+static uint64_t sim_now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint16_t sim_get16(uint8_t sn, uint16_t reg)
+{
+   return ((uint16_t)sim_sreg[sn][reg] << 8) | sim_sreg[sn][reg + 1];
+}
+
+static void sim_set16(uint8_t sn, uint16_t reg, uint16_t val)
+{
+   sim_sreg[sn][reg]     = (uint8_t)(val >> 8);
+   sim_sreg[sn][reg + 1] = (uint8_t)val;
+}
+
+static uint32_t sim_bufsize(uint8_t sn, uint16_t reg)
+{
+   uint8_t kb = sim_sreg[sn][reg];
+   return (uint32_t)((kb > 16) ? 16 : kb) << 10;
+}
+
+static void sim_update_ptr(uint8_t sn)
+{
+   uint32_t txsize = sim_bufsize(sn, SIM_Sn_TX_BSR);
+   uint16_t used   = sim_get16(sn, SIM_Sn_TX_WR) - sim_get16(sn, SIM_Sn_TX_RD);
+   sim_set16(sn, SIM_Sn_TX_FSR, (used < txsize) ? (uint16_t)(txsize - used) : 0);
+   sim_set16(sn, SIM_Sn_RX_RSR, sim_get16(sn, SIM_Sn_RX_WR) - sim_get16(sn, SIM_Sn_RX_RD));
+}
+
+static void sim_update_sir(void)
+{
+   uint8_t sir = 0;
+   uint8_t sn;
+   for(sn = 0; sn < SIM_SOCK_NUM; sn++)
+   {
+      if(sim_sreg[sn][SIM_Sn_IR] & sim_sreg[sn][SIM_Sn_IMR]) sir |= (1 << sn);
+   }
+   sim_creg[SIM_SIR] = sir;
+}
+
+static void sim_host_close(uint8_t sn)
+{
+   int i;
+   for(i = 0; i < 2; i++)
+   {
+      if(sim_sn[sn].fd[i] != -1) close(sim_sn[sn].fd[i]);
+      sim_sn[sn].fd[i] = -1;
+   }
+   sim_sn[sn].sending = 0;
+}
+
+static void sim_state(uint8_t sn, uint8_t sr, uint8_t ir)
+{
+   sim_sreg[sn][SIM_Sn_SR] = sr;
+   sim_sreg[sn][SIM_Sn_IR] |= ir;
+   if(sr == SOCK_CLOSED) sim_host_close(sn);
+}
+
+static void sim_power_on(void)
+{
+   uint8_t sn;
+   for(sn = 0; sn < SIM_SOCK_NUM; sn++)
+   {
+      sim_host_close(sn);
+      memset(sim_sreg[sn], 0, SIM_SREG_SIZE);
+      sim_sreg[sn][SIM_Sn_IMR] = 0xFF;
+      sim_sreg[sn][SIM_Sn_TTLR] = 0x80;
+      sim_set16(sn, SIM_Sn_RTR, 0x07D0);
+      sim_sreg[sn][SIM_Sn_RCR] = 0x08;
+      sim_sreg[sn][SIM_Sn_TX_BSR] = 2;
+      sim_sreg[sn][SIM_Sn_RX_BSR] = 2;
+      sim_sn[sn].last_diplen = 0;
+      sim_sn[sn].last_dport = 0;
+      sim_update_ptr(sn);
+   }
+   memset(sim_creg, 0, sizeof(sim_creg));
+   sim_creg[SIM_CIDR]    = 0x61;
+   sim_creg[SIM_VER]     = 0x46;
+   sim_creg[SIM_VER + 1] = 0x61;
+   sim_creg[SIM_SYSR]    = SYSR_CHPL | SYSR_NETL | SYSR_PHYL | SYSR_SPI;
+   sim_creg[SIM_SYCR0]   = 0x80;
+   sim_creg[SIM_PHYSR]   = PHYSR_LNK;
+   sim_creg[SIM_RTR]     = 0x07;
+   sim_creg[SIM_RTR + 1] = 0xD0;
+   sim_creg[SIM_RCR]     = 0x08;
+   sim_xfer_count = 0;
+   sim_byte_count = 0;
+   sim_send_count = 0;
+   sim_tcnt_base = sim_now();
+}
+
+/* Fill host address of loopback at port + port_offset. */
+static socklen_t sim_host_addr(struct sockaddr_storage* ss, uint8_t v6, uint16_t port)
+{
+   memset(ss, 0, sizeof(*ss));
+   port = htons((uint16_t)(port + sim_port_offset));
+   if(v6)
+   {
+      struct sockaddr_in6* a = (struct sockaddr_in6*)ss;
+      a->sin6_family = AF_INET6;
+      a->sin6_addr = in6addr_loopback;
+      a->sin6_port = port;
+      return sizeof(*a);
+   }
+   else
+   {
+      struct sockaddr_in* a = (struct sockaddr_in*)ss;
+      a->sin_family = AF_INET;
+      a->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      a->sin_port = port;
+      return sizeof(*a);
+   }
+}
+
+static int sim_host_open(uint8_t sn, uint8_t v6, int type, uint8_t must_bind)
+{
+   struct sockaddr_storage ss;
+   socklen_t len = sim_host_addr(&ss, v6, sim_get16(sn, SIM_Sn_PORTR));
+   int on = 1;
+   int fd = socket(v6 ? AF_INET6 : AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+   if(fd < 0) return -1;
+   sim_setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+   if(type == SOCK_DGRAM) sim_setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+   // W6100 can keep several SOCKETs listening on the same port.
+   else sim_setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+   if(bind(fd, (struct sockaddr*)&ss, len) < 0 && must_bind)
+   {
+      fprintf(stderr, "w6100sim: socket %d bind port %d error %d\r\n", sn, (uint16_t)(sim_get16(sn, SIM_Sn_PORTR) + sim_port_offset), errno);
+      close(fd);
+      return -1;
+   }
+   return fd;
+}
+
+static void sim_set_deadline(uint8_t sn)
+{
+   uint64_t us = (uint64_t)sim_get16(sn, SIM_Sn_RTR) * 100 * (sim_sreg[sn][SIM_Sn_RCR] + 1);
+   sim_sn[sn].deadline = sim_now() + us * 1000;
+}
+
+/* Move data between Sn_TX_RD and Sn_TX_WR of SEND to host socket.
+ * Sn_TX_RD follows the bytes taken by host, and SENDOK is set when all are taken. */
+static void sim_tcp_send(uint8_t sn)
+{
+   sim_sock* s = &sim_sn[sn];
+   uint32_t size = sim_bufsize(sn, SIM_Sn_TX_BSR);
+   uint16_t rd = sim_get16(sn, SIM_Sn_TX_RD);
+   if(s->sending && s->send_at && (sim_now() < s->send_at)) return;
+   while(s->sending && (rd != s->send_end) && size)
+   {
+      uint32_t idx = rd % size;
+      uint32_t len = (uint16_t)(s->send_end - rd);
+      ssize_t ret;
+      if(len > size - idx) len = size - idx;
+      ret = send(s->fd[0], &sim_txbuf[sn][idx], len, MSG_DONTWAIT | MSG_NOSIGNAL);
+      if(ret < 0)
+      {
+         if((errno != EAGAIN) && (errno != EWOULDBLOCK)) sim_state(sn, SOCK_CLOSED, Sn_IR_DISCON);
+         break;
+      }
+      rd += ret;
+   }
+   sim_set16(sn, SIM_Sn_TX_RD, rd);
+   if(s->sending && (rd == s->send_end))
+   {
+      s->sending = 0;
+      sim_sreg[sn][SIM_Sn_IR] |= Sn_IR_SENDOK;
+   }
+}
+
+/* Send data between Sn_TX_RD and Sn_TX_WR as one datagram to loopback at Sn_DPORTR. */
+static void sim_udp_send(uint8_t sn, uint8_t v6)
+{
+   sim_sock* s = &sim_sn[sn];
+   struct sockaddr_storage ss;
+   uint32_t size = sim_bufsize(sn, SIM_Sn_TX_BSR);
+   uint16_t rd = sim_get16(sn, SIM_Sn_TX_RD);
+   uint16_t wr = sim_get16(sn, SIM_Sn_TX_WR);
+   uint16_t len = wr - rd;
+   uint16_t dport = sim_get16(sn, SIM_Sn_DPORTR);
+   uint16_t i;
+   int fd = s->fd[v6 ? 1 : 0];
+
+   if(sim_unreach_len && (sim_unreach_len == (v6 ? 16 : 4)) &&
+      !memcmp(sim_unreach_ip, &sim_sreg[sn][v6 ? SIM_Sn_DIP6R : SIM_Sn_DIPR], sim_unreach_len))
+   {
+      // ARP or ND of the destination is not answered, so nothing is sent
+      sim_set16(sn, SIM_Sn_TX_RD, wr);
+      sim_sreg[sn][SIM_Sn_IR] |= Sn_IR_TIMEOUT;
+      return;
+   }
+   if(size && (len <= size) && (fd != -1))
+   {
+      for(i = 0; i < len; i++) sim_tmp[i] = sim_txbuf[sn][(uint16_t)(rd + i) % size];
+      sendto(fd, sim_tmp, len, MSG_DONTWAIT, (struct sockaddr*)&ss, sim_host_addr(&ss, v6, dport));
+      s->last_diplen = v6 ? 16 : 4;
+      memcpy(s->last_dip, &sim_sreg[sn][v6 ? SIM_Sn_DIP6R : SIM_Sn_DIPR], s->last_diplen);
+      s->last_dport = dport;
+   }
+   sim_set16(sn, SIM_Sn_TX_RD, wr);
+   sim_sreg[sn][SIM_Sn_IR] |= Sn_IR_SENDOK;
+}
+
+static void sim_rx_write(uint8_t sn, const uint8_t* data, uint32_t len)
+{
+   uint32_t size = sim_bufsize(sn, SIM_Sn_RX_BSR);
+   uint16_t wr = sim_get16(sn, SIM_Sn_RX_WR);
+   uint32_t i;
+   for(i = 0; i < len; i++) sim_rxbuf[sn][(uint16_t)(wr + i) % size] = data[i];
+   sim_set16(sn, SIM_Sn_RX_WR, wr + len);
+}
+
+static uint32_t sim_rx_free(uint8_t sn)
+{
+   uint32_t size = sim_bufsize(sn, SIM_Sn_RX_BSR);
+   uint16_t used = sim_get16(sn, SIM_Sn_RX_WR) - sim_get16(sn, SIM_Sn_RX_RD);
+   return (used < size) ? (size - used) : 0;
+}
+
+static void sim_tcp_recv(uint8_t sn)
+{
+   sim_sock* s = &sim_sn[sn];
+   uint32_t freesize = sim_rx_free(sn);
+   while(freesize && (s->fd[0] != -1))
+   {
+      ssize_t ret = recv(s->fd[0], sim_tmp, freesize, MSG_DONTWAIT);
+      if(ret > 0)
+      {
+         sim_rx_write(sn, sim_tmp, ret);
+         freesize -= ret;
+         sim_sreg[sn][SIM_Sn_IR] |= Sn_IR_RECV;
+         continue;
+      }
+      if((ret < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) break;
+      // Peer closed or reset.
+      if((ret == 0) && (sim_sreg[sn][SIM_Sn_SR] == SOCK_ESTABLISHED)) sim_state(sn, SOCK_CLOSE_WAIT, Sn_IR_DISCON);
+      else sim_state(sn, SOCK_CLOSED, Sn_IR_DISCON);
+      break;
+   }
+}
+
+/* Receive datagrams with PACKET INFO of W6100: 2 bytes of info and size,
+ * source address of 4 or 16 bytes and 2 bytes of source port. */
+static void sim_udp_recv(uint8_t sn)
+{
+   sim_sock* s = &sim_sn[sn];
+   uint8_t i;
+   for(i = 0; i < 2; i++)
+   {
+      while(s->fd[i] != -1)
+      {
+         struct sockaddr_storage ss;
+         socklen_t alen = sizeof(ss);
+         uint8_t  head[2 + 16 + 2];
+         uint8_t  iplen = i ? 16 : 4;
+         uint8_t  hlen = 2 + iplen + 2;
+         uint16_t port;
+         ssize_t  ret = recv(s->fd[i], sim_tmp, 0, MSG_DONTWAIT | MSG_PEEK | MSG_TRUNC);
+         if(ret < 0) break;
+         if(ret > 0x7FF)
+         {
+            // Larger than size of PACKET INFO, W6100 never receives it without fragments.
+            recv(s->fd[i], sim_tmp, 0, MSG_DONTWAIT);
+            continue;
+         }
+         if((uint32_t)ret + hlen > sim_rx_free(sn)) break;
+         ret = recvfrom(s->fd[i], sim_tmp, sizeof(sim_tmp), MSG_DONTWAIT, (struct sockaddr*)&ss, &alen);
+         if(ret < 0) break;
+
+         port = ntohs(i ? ((struct sockaddr_in6*)&ss)->sin6_port : ((struct sockaddr_in*)&ss)->sin_port);
+         head[0] = (i ? SIM_PACK_IPv6 : 0) | (uint8_t)((ret >> 8) & 0x07);
+         head[1] = (uint8_t)ret;
+         if(((uint16_t)(port - sim_port_offset) == s->last_dport) && (s->last_diplen == iplen))
+         {
+            memcpy(&head[2], s->last_dip, iplen);
+            port = s->last_dport;
+         }
+         else if(i) memcpy(&head[2], &((struct sockaddr_in6*)&ss)->sin6_addr, 16);
+         else       memcpy(&head[2], &((struct sockaddr_in*)&ss)->sin_addr, 4);
+         head[hlen - 2] = (uint8_t)(port >> 8);
+         head[hlen - 1] = (uint8_t)port;
+         sim_rx_write(sn, head, hlen);
+         sim_rx_write(sn, sim_tmp, ret);
+         sim_sreg[sn][SIM_Sn_IR] |= Sn_IR_RECV;
+      }
+   }
+}
+
+static void sim_accept(uint8_t sn)
+{
+   sim_sock* s = &sim_sn[sn];
+   struct sockaddr_storage ss;
+   socklen_t alen = sizeof(ss);
+   int fd = accept4(s->fd[0], (struct sockaddr*)&ss, &alen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+   if(fd < 0) return;
+   // One W6100 socket serves one connection.
+   close(s->fd[0]);
+   s->fd[0] = fd;
+   if(ss.ss_family == AF_INET6)
+   {
+      memcpy(&sim_sreg[sn][SIM_Sn_DIP6R], &((struct sockaddr_in6*)&ss)->sin6_addr, 16);
+      sim_set16(sn, SIM_Sn_DPORTR, ntohs(((struct sockaddr_in6*)&ss)->sin6_port));
+      sim_sreg[sn][SIM_Sn_ESR] = Sn_ESR_TCPOP_SVR | Sn_ESR_TCPM_IPV6;
+   }
+   else
+   {
+      memcpy(&sim_sreg[sn][SIM_Sn_DIPR], &((struct sockaddr_in*)&ss)->sin_addr, 4);
+      sim_set16(sn, SIM_Sn_DPORTR, ntohs(((struct sockaddr_in*)&ss)->sin_port));
+      sim_sreg[sn][SIM_Sn_ESR] = Sn_ESR_TCPOP_SVR | Sn_ESR_TCPM_IPV4;
+   }
+   sim_state(sn, SOCK_ESTABLISHED, Sn_IR_CON);
+   sim_tcp_recv(sn);
+}
+
+static void sim_poll(uint8_t sn)
+{
+   sim_sock* s = &sim_sn[sn];
+   switch(sim_sreg[sn][SIM_Sn_SR])
+   {
+      case SOCK_LISTEN:
+         sim_accept(sn);
+         break;
+      case SOCK_SYNSENT:
+      {
+         struct pollfd pfd = { s->fd[0], POLLOUT, 0 };
+         int err = 0;
+         socklen_t elen = sizeof(err);
+         if(poll(&pfd, 1, 0) > 0)
+         {
+            sim_getsockopt(s->fd[0], SOL_SOCKET, SO_ERROR, &err, &elen);
+            if(err) sim_state(sn, SOCK_CLOSED, Sn_IR_TIMEOUT);
+            else    sim_state(sn, SOCK_ESTABLISHED, Sn_IR_CON);
+         }
+         else if(sim_now() >= s->deadline) sim_state(sn, SOCK_CLOSED, Sn_IR_TIMEOUT);
+         break;
+      }
+      case SOCK_ESTABLISHED:
+         sim_tcp_send(sn);
+         sim_tcp_recv(sn);
+         break;
+      case SOCK_CLOSE_WAIT:
+         sim_tcp_send(sn);
+         break;
+      case SOCK_FIN_WAIT:
+         sim_tcp_recv(sn);
+         if((sim_sreg[sn][SIM_Sn_SR] == SOCK_FIN_WAIT) && (sim_now() >= s->deadline))
+            sim_state(sn, SOCK_CLOSED, Sn_IR_TIMEOUT);
+         break;
+      case SOCK_UDP:
+         sim_udp_recv(sn);
+         break;
+      default:
+         break;
+   }
+   sim_update_ptr(sn);
+}
+
+static void sim_command(uint8_t sn, uint8_t cmd)
+{
+   sim_sock* s = &sim_sn[sn];
+   uint8_t  sr = sim_sreg[sn][SIM_Sn_SR];
+   uint8_t  mode = sim_sreg[sn][SIM_Sn_MR] & 0x0F;
+
+   switch(cmd)
+   {
+      case Sn_CR_OPEN:
+         sim_host_close(sn);
+         sim_set16(sn, SIM_Sn_TX_RD, 0);
+         sim_set16(sn, SIM_Sn_TX_WR, 0);
+         sim_set16(sn, SIM_Sn_RX_RD, 0);
+         sim_set16(sn, SIM_Sn_RX_WR, 0);
+         sim_sreg[sn][SIM_Sn_IR] = 0;
+         sim_sreg[sn][SIM_Sn_ESR] = 0;
+         if(sim_get16(sn, SIM_Sn_RTR) == 0) sim_set16(sn, SIM_Sn_RTR, ((uint16_t)sim_creg[SIM_RTR] << 8) | sim_creg[SIM_RTR + 1]);
+         if(sim_sreg[sn][SIM_Sn_RCR] == 0)  sim_sreg[sn][SIM_Sn_RCR] = sim_creg[SIM_RCR];
+         s->last_diplen = 0;
+         s->last_dport = 0;
+         switch(mode)
+         {
+            case Sn_MR_TCP4:
+            case Sn_MR_TCP6:
+            case Sn_MR_TCPD:
+               sim_state(sn, SOCK_INIT, 0);
+               break;
+            case Sn_MR_UDP4:
+            case Sn_MR_UDP6:
+            case Sn_MR_UDPD:
+               if(mode != Sn_MR_UDP6) s->fd[0] = sim_host_open(sn, 0, SOCK_DGRAM, 1);
+               if(mode != Sn_MR_UDP4) s->fd[1] = sim_host_open(sn, 1, SOCK_DGRAM, 1);
+               sim_state(sn, SOCK_UDP, 0);
+               break;
+            case Sn_MR_IPRAW4: sim_state(sn, SOCK_IPRAW4, 0); break;
+            case Sn_MR_IPRAW6: sim_state(sn, SOCK_IPRAW6, 0); break;
+            case Sn_MR_MACRAW: sim_state(sn, SOCK_MACRAW, 0); break;
+            default:           sim_state(sn, SOCK_CLOSED, 0); break;
+         }
+         break;
+      case Sn_CR_LISTEN:
+         if(sr != SOCK_INIT) break;
+         s->fd[0] = sim_host_open(sn, mode == Sn_MR_TCP6, SOCK_STREAM, 1);
+         if((s->fd[0] < 0) || (listen(s->fd[0], 1) < 0)) sim_state(sn, SOCK_CLOSED, 0);
+         else sim_state(sn, SOCK_LISTEN, 0);
+         break;
+      case Sn_CR_CONNECT:
+      case Sn_CR_CONNECT6:
+      {
+         struct sockaddr_storage ss;
+         uint8_t v6 = (cmd == Sn_CR_CONNECT6);
+         socklen_t len;
+         if(sr != SOCK_INIT) break;
+         s->fd[0] = sim_host_open(sn, v6, SOCK_STREAM, 0);
+         len = sim_host_addr(&ss, v6, sim_get16(sn, SIM_Sn_DPORTR));
+         if((s->fd[0] < 0) || ((connect(s->fd[0], (struct sockaddr*)&ss, len) < 0) && (errno != EINPROGRESS)))
+         {
+            sim_state(sn, SOCK_CLOSED, Sn_IR_TIMEOUT);
+            break;
+         }
+         sim_sreg[sn][SIM_Sn_ESR] = Sn_ESR_TCPOP_CLT | (v6 ? Sn_ESR_TCPM_IPV6 : Sn_ESR_TCPM_IPV4);
+         sim_set_deadline(sn);
+         sim_state(sn, SOCK_SYNSENT, 0);
+         break;
+      }
+      case Sn_CR_DISCON:
+         if(sr == SOCK_ESTABLISHED)
+         {
+            shutdown(s->fd[0], SHUT_WR);
+            sim_set_deadline(sn);
+            sim_state(sn, SOCK_FIN_WAIT, 0);
+         }
+         else if(sr == SOCK_CLOSE_WAIT) sim_state(sn, SOCK_CLOSED, Sn_IR_DISCON);
+         else if((sr == SOCK_INIT) || (sr == SOCK_LISTEN) || (sr == SOCK_SYNSENT)) sim_state(sn, SOCK_CLOSED, 0);
+         break;
+      case Sn_CR_CLOSE:
+         sim_state(sn, SOCK_CLOSED, 0);
+         break;
+      case Sn_CR_SEND:
+      case Sn_CR_SEND6:
+      case Sn_CR_SEND_KEEP:
+         if(cmd != Sn_CR_SEND_KEEP) sim_send_count++;
+         if((sr == SOCK_ESTABLISHED) || (sr == SOCK_CLOSE_WAIT))
+         {
+            if(cmd == Sn_CR_SEND_KEEP)
+            {
+               sim_sreg[sn][SIM_Sn_IR] |= Sn_IR_SENDOK;
+               break;
+            }
+            s->send_end = sim_get16(sn, SIM_Sn_TX_WR);
+            s->sending = 1;
+            s->send_at = 0;
+            if(sim_wire_send_ns || sim_wire_byte_ns)
+               s->send_at = sim_now() + sim_wire_send_ns +
+                            (uint64_t)sim_wire_byte_ns * (uint16_t)(s->send_end - sim_get16(sn, SIM_Sn_TX_RD));
+            sim_tcp_send(sn);
+         }
+         else if(sr == SOCK_UDP) sim_udp_send(sn, cmd == Sn_CR_SEND6);
+         else if(sr != SOCK_CLOSED)
+         {
+            // IPRAW and MACRAW are not bridged, the data is dropped.
+            sim_set16(sn, SIM_Sn_TX_RD, sim_get16(sn, SIM_Sn_TX_WR));
+            sim_sreg[sn][SIM_Sn_IR] |= Sn_IR_SENDOK;
+         }
+         break;
+      case Sn_CR_RECV:
+         sim_update_ptr(sn);
+         sim_poll(sn);
+         break;
+      default:
+         break;
+   }
+   sim_sreg[sn][SIM_Sn_CR] = 0;
+}
+
+static void sim_creg_write(uint16_t offset, const uint8_t* data, datasize_t len)
+{
+   datasize_t i;
+   for(i = 0; i < len; i++)
+   {
+      uint32_t o = (uint32_t)offset + i;
+      uint8_t  d = data[i];
+      if(o >= SIM_CREG_SIZE) break;
+      switch(o)
+      {
+         case SIM_CIDR: case SIM_CIDR + 1: case SIM_VER: case SIM_VER + 1:
+         case SIM_SYSR: case SIM_IR: case SIM_SIR: case SIM_SLIR: case SIM_PHYSR:
+         case SIM_TCNTR: case SIM_TCNTR + 1:
+            break;
+         case SIM_TCNTRCLR:
+            sim_tcnt_base = sim_now();
+            break;
+         case SIM_SYCR0:
+            if(!(d & 0x80))
+            {
+               sim_power_on();
+               return;
+            }
+            break;
+         case SIM_IRCLR:
+            sim_creg[SIM_IR] &= ~d;
+            break;
+         case SIM_SLIRCLR:
+            sim_creg[SIM_SLIR] &= ~d;
+            break;
+         case SIM_SLCR:
+            // No neighbour answers ARP, PING or NDP on the bridge.
+            if(d) sim_creg[SIM_SLIR] |= SLIR_TOUT;
+            break;
+         case SIM_CHPLCKR:
+            if(d == 0xCE) sim_creg[SIM_SYSR] &= ~SYSR_CHPL;
+            else          sim_creg[SIM_SYSR] |= SYSR_CHPL;
+            break;
+         case SIM_NETLCKR:
+            if(d == 0x3A)      sim_creg[SIM_SYSR] &= ~SYSR_NETL;
+            else if(d == 0xC5) sim_creg[SIM_SYSR] |= SYSR_NETL;
+            break;
+         case SIM_PHYLCKR:
+            if(d == 0x53) sim_creg[SIM_SYSR] &= ~SYSR_PHYL;
+            else          sim_creg[SIM_SYSR] |= SYSR_PHYL;
+            break;
+         default:
+            sim_creg[o] = d;
+            break;
+      }
+   }
+}
+
+static void sim_sreg_write(uint8_t sn, uint16_t offset, const uint8_t* data, datasize_t len)
+{
+   datasize_t i;
+   for(i = 0; i < len; i++)
+   {
+      uint32_t o = (uint32_t)offset + i;
+      if(o >= SIM_SREG_SIZE) break;
+      switch(o)
+      {
+         case SIM_Sn_IR: case SIM_Sn_SR: case SIM_Sn_ESR:
+         case SIM_Sn_TX_FSR: case SIM_Sn_TX_FSR + 1: case SIM_Sn_TX_RD: case SIM_Sn_TX_RD + 1:
+         case SIM_Sn_RX_RSR: case SIM_Sn_RX_RSR + 1: case SIM_Sn_RX_WR: case SIM_Sn_RX_WR + 1:
+            break;
+         case SIM_Sn_CR:
+            sim_command(sn, data[i]);
+            break;
+         case SIM_Sn_IRCLR:
+            sim_sreg[sn][SIM_Sn_IR] &= ~data[i];
+            break;
+         default:
+            sim_sreg[sn][o] = data[i];
+            break;
+      }
+   }
+   sim_update_ptr(sn);
+}
+
+static void sim_mem_read(const uint8_t* mem, uint32_t size, uint16_t offset, uint8_t* data, datasize_t len)
+{
+   datasize_t i;
+   for(i = 0; i < len; i++)
+   {
+      uint32_t o = (uint32_t)offset + i;
+      data[i] = (o < size) ? mem[o] : 0;
+   }
+}
+
+static void sim_buf_xfer(uint8_t* mem, uint32_t size, uint16_t offset, uint8_t* data, datasize_t len, uint8_t write)
+{
+   datasize_t i;
+   for(i = 0; i < len; i++)
+   {
+      if(size == 0)
+      {
+         if(!write) data[i] = 0;
+         continue;
+      }
+      if(write) mem[((uint32_t)offset + i) % size] = data[i];
+      else      data[i] = mem[((uint32_t)offset + i) % size];
+   }
+}
+
+void w6100sim_xfer(uint8_t* addr, datasize_t alen, uint8_t* data, datasize_t dlen)
+{
+   uint64_t start = sim_now();
+   uint64_t ns;
+   uint16_t offset = ((uint16_t)addr[0] << 8) | addr[1];
+   uint8_t  bsb    = addr[2] >> 3;
+   uint8_t  write  = (addr[2] & _W6100_SPI_WRITE_) != 0;
+   uint8_t  sn;
+
+   pthread_mutex_lock(&sim_lock);
+   sim_xfer_count++;
+   sim_byte_count += alen + dlen;
+   if(bsb == 0)
+   {
+      if(write) sim_creg_write(offset, data, dlen);
+      else
+      {
+         for(sn = 0; sn < SIM_SOCK_NUM; sn++) sim_poll(sn);
+         sim_update_sir();
+         ns = (start - sim_tcnt_base) / 100000;   // TCNTR counts 100us
+         sim_creg[SIM_TCNTR]     = (uint8_t)(ns >> 8);
+         sim_creg[SIM_TCNTR + 1] = (uint8_t)ns;
+         sim_mem_read(sim_creg, SIM_CREG_SIZE, offset, data, dlen);
+      }
+   }
+   else if(((bsb - 1) >> 2) < SIM_SOCK_NUM)
+   {
+      sn = (bsb - 1) >> 2;
+      switch((bsb - 1) & 0x03)
+      {
+         case 0:
+            if(write) sim_sreg_write(sn, offset, data, dlen);
+            else
+            {
+               sim_poll(sn);
+               sim_mem_read(sim_sreg[sn], SIM_SREG_SIZE, offset, data, dlen);
+            }
+            break;
+         case 1:
+            sim_buf_xfer(sim_txbuf[sn], sim_bufsize(sn, SIM_Sn_TX_BSR), offset, data, dlen, write);
+            break;
+         case 2:
+            sim_buf_xfer(sim_rxbuf[sn], sim_bufsize(sn, SIM_Sn_RX_BSR), offset, data, dlen, write);
+            break;
+         default:
+            if(!write) memset(data, 0, dlen);
+            break;
+      }
+   }
+   else if(!write) memset(data, 0, dlen);
+   sim_update_sir();
+   ns = sim_xfer_ns + (uint64_t)sim_byte_ns * (alen + dlen);
+   pthread_mutex_unlock(&sim_lock);
+
+   // Busy wait, sleep is too coarse for SPI timing.
+   while(ns && (sim_now() - start < ns));
+}
+
+void w6100sim_reset(void)
+{
+   pthread_mutex_lock(&sim_lock);
+   sim_power_on();
+   pthread_mutex_unlock(&sim_lock);
+}
+
+void w6100sim_init(uint16_t port_offset)
+{
+   sim_port_offset = port_offset;
+   w6100sim_reset();
+   reg_wizchip_spi_cbfunc(0, 0, 0, 0, w6100sim_xfer);
+}
+
+void w6100sim_set_latency(uint32_t xfer_ns, uint32_t byte_ns)
+{
+   sim_xfer_ns = xfer_ns;
+   sim_byte_ns = byte_ns;
+}
+
+void w6100sim_set_wire(uint32_t send_ns, uint32_t byte_ns)
+{
+   sim_wire_send_ns = send_ns;
+   sim_wire_byte_ns = byte_ns;
+}
+
+void w6100sim_set_unreachable(const uint8_t* ip, uint8_t len)
+{
+   pthread_mutex_lock(&sim_lock);
+   sim_unreach_len = (ip && (len == 4 || len == 16)) ? len : 0;
+   if(sim_unreach_len) memcpy(sim_unreach_ip, ip, len);
+   pthread_mutex_unlock(&sim_lock);
+}
+
+void w6100sim_get_count(uint32_t* xfer, uint64_t* bytes)
+{
+   if(xfer)  *xfer  = sim_xfer_count;
+   if(bytes) *bytes = sim_byte_count;
+}
+
+uint32_t w6100sim_get_send_count(void)
+{
+   return sim_send_count;
+}
+
+#endif
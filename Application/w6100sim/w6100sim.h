@@ -0,0 +1,87 @@
+#ifndef _W6100SIM_H_
+#define _W6100SIM_H_
+
+#include <stdint.h>
+#include "wizchip_conf.h"
+
+/**
+ * @brief Register-level W6100 model for host test and benchmark on Linux.
+ * @details The model keeps the common and socket register maps and 16KB TX/RX memory of each socket
+ *          behind the SPI VDM transfer, so @ref socket.c, DNS, DHCP and the C++ wrappers run without the chip.\n
+ *          Sn_CR commands run the socket state machine, Sn_TX_RD and Sn_RX_WR are moved by the model,
+ *          Sn_TX_FSR and Sn_RX_RSR are computed from the ring pointers, SIR follows Sn_IR & Sn_IMR,
+ *          and TCNTR counts 100us of host time from reset or TCNTRCLR.\n
+ *          TCP and UDP sockets are bridged to host sockets on loopback. Every destination address is mapped to
+ *          127.0.0.1 or ::1, and every port, local or destination, is shifted by port_offset,
+ *          so a test peer can serve privileged ports such as DHCP 67 and 68 without root.
+ *          UDP replies from the last destination port are reported with the original destination address.
+ *          IPRAW and MACRAW sockets can be opened, but nothing is bridged for them.
+ *          Host sockets are polled when socket registers or common registers are read.\n
+ *          Application/w6100sim/CMakeLists.txt is a host project of the model with the benchmarks in bench/,
+ *          such as sim_load, the TCP echo load test that reports SPI transfers and bytes per message.
+ */
+
+#if defined(__linux__)
+
+#if __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Reset the model and install it with @ref reg_wizchip_spi_cbfunc().
+ * @param port_offset Added to every port of the bridged host sockets.
+ */
+void w6100sim_init(uint16_t port_offset);
+
+/**
+ * @brief Reset all registers and close all host sockets, same as power on.
+ */
+void w6100sim_reset(void);
+
+/**
+ * @brief Set the time of one SPI transfer, kept by busy wait in @ref w6100sim_xfer().
+ * @param xfer_ns Fixed ns of each transfer, such as CS and address phase.
+ * @param byte_ns ns of each byte of address and data.
+ */
+void w6100sim_set_latency(uint32_t xfer_ns, uint32_t byte_ns);
+
+/**
+ * @brief SPI VDM transfer of the model. Installed by @ref w6100sim_init(), or called from
+ *        W6100AdapterOp::vdmXfer() when the C++ adapter is used.
+ */
+void w6100sim_xfer(uint8_t* addr, datasize_t alen, uint8_t* data, datasize_t dlen);
+
+/**
+ * @brief Set the time a TCP SEND takes on the wire.
+ * @details Sn_CR_SEND of n bytes moves Sn_TX_RD and sets Sn_IR_SENDOK only after send_ns + n * byte_ns,
+ *          like the round trip and the line rate of a real link. Both 0, the default, complete it at once.
+ *          It is kept over @ref w6100sim_reset(), like the latency.
+ */
+void w6100sim_set_wire(uint32_t send_ns, uint32_t byte_ns);
+
+/**
+ * @brief Make UDP SEND to ip fail as if ARP or ND got no answer.
+ * @details Nothing is sent and Sn_IR_TIMEOUT is set instead of Sn_IR_SENDOK, as the address conflict check
+ *          of DHCPv4 expects for a free address. It is kept over @ref w6100sim_reset(), like the latency.
+ * @param ip  Destination address, or NULL to clear it.
+ * @param len 4 or 16.
+ */
+void w6100sim_set_unreachable(const uint8_t* ip, uint8_t len);
+
+/**
+ * @brief Get count of transfers and bytes passed through @ref w6100sim_xfer() since reset.
+ */
+void w6100sim_get_count(uint32_t* xfer, uint64_t* bytes);
+
+/**
+ * @brief Get count of Sn_CR_SEND and Sn_CR_SEND6 commands of all sockets since reset.
+ */
+uint32_t w6100sim_get_send_count(void);
+
+#if __cplusplus
+ }
+#endif
+
+#endif
+
+#endif
@@ -33,6 +33,11 @@
 
 #include "w6100.h"
 
+#if (_WIZCHIP_IO_TRACE_ == 1)
+#include <stdio.h>
+#include <string.h>
+#endif
+
 
 
 #define _WIZCHIP_SPI_VDM_OP_    0x00
@@ -50,6 +55,82 @@
 
 #define _W6100_SPI_OP_          _WIZCHIP_SPI_VDM_OP_
 
+#if (_WIZCHIP_IO_COUNT_ == 1)
+static uint32_t wizchip_io_count = 0;
+#define WIZCHIP_IO_COUNT()      wizchip_io_count++
+#else
+#define WIZCHIP_IO_COUNT()
+#endif
+
+#if (_WIZCHIP_IO_TRACE_ == 1)
+static wiz_IOTraceStat wizchip_trace;
+static uint8_t   wizchip_trace_api = WIZ_TRACE_APP;
+static uint32_t (*wizchip_trace_clock)(void) = 0;
+
+static uint32_t wizchip_trace_now(void)
+{
+   return wizchip_trace_clock ? wizchip_trace_clock() : 0;
+}
+
+static void wizchip_trace_add(wiz_IOTrace* t, datasize_t ctrl, datasize_t data, uint32_t time)
+{
+   t->count++;
+   t->ctrl += ctrl;
+   t->data += data;
+   t->time += time;
+}
+
+/* Account a transaction to the register block of AddrSel and the current SOCKET API. */
+static void wizchip_trace_io(uint32_t AddrSel, datasize_t ctrl, datasize_t data, uint32_t start)
+{
+   uint8_t bsb = (uint8_t)((AddrSel & 0xF8) >> 3);
+   uint8_t block = (bsb == 0) ? WIZ_TRACE_CREG : (uint8_t)(WIZ_TRACE_SREG + ((bsb - 1) & 0x03));
+   uint32_t time = wizchip_trace_now() - start;
+   wizchip_trace_add(&wizchip_trace.block[block], ctrl, data, time);
+   wizchip_trace_add(&wizchip_trace.api[wizchip_trace_api], ctrl, data, time);
+}
+
+#define WIZCHIP_TRACE_BEGIN()                     uint32_t trace_start = wizchip_trace_now()
+#define WIZCHIP_TRACE_END(AddrSel, ctrl, data)    wizchip_trace_io(AddrSel, ctrl, data, trace_start)
+#else
+#define WIZCHIP_TRACE_BEGIN()
+#define WIZCHIP_TRACE_END(AddrSel, ctrl, data)
+#endif
+
+/*
+ * State of the asynchronous transfer of wiz_send_data_async() and wiz_recv_data_async().
+ * The buffer pointer is written back by the first access to _WIZCHIP_ after the transfer is completed.
+ */
+static volatile uint8_t wizchip_xfer_busy = 0;     ///< transfer is in progress, accessed by WIZCHIP_XFER_BUSY() and WIZCHIP_XFER_SET()
+static uint8_t  wizchip_xfer_commit = 0;           ///< buffer pointer is not written back yet
+static uint8_t  wizchip_xfer_ad[3];                ///< address phase, kept while in progress
+static uint32_t wizchip_xfer_ptr_addr;             ///< _Sn_TX_WR_ or _Sn_RX_RD_
+static uint16_t wizchip_xfer_ptr;                  ///< the value of wizchip_xfer_ptr_addr after the transfer
+static void   (*wizchip_xfer_cb)(void* arg) = 0;
+static void*    wizchip_xfer_arg = 0;
+
+/*
+ * wizchip_xfer_done() can run in another thread or an interrupt. Clearing wizchip_xfer_busy releases the received data
+ * and the state above to the waiter, so it is accessed with acquire and release where the compiler supports it.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define WIZCHIP_XFER_BUSY()      __atomic_load_n(&wizchip_xfer_busy, __ATOMIC_ACQUIRE)
+#define WIZCHIP_XFER_SET(v)      __atomic_store_n(&wizchip_xfer_busy, (v), __ATOMIC_RELEASE)
+#else
+#define WIZCHIP_XFER_BUSY()      (wizchip_xfer_busy)
+#define WIZCHIP_XFER_SET(v)      (wizchip_xfer_busy = (v))
+#endif
+
+static void wizchip_xfer_sync(void)
+{
+   while(WIZCHIP_XFER_BUSY());
+   if(wizchip_xfer_commit)
+   {
+      wizchip_xfer_commit = 0;
+      WIZCHIP_WRITE_16(wizchip_xfer_ptr_addr, wizchip_xfer_ptr);
+   }
+}
+
 //////////////////////////////////////////////////
 void WIZCHIP_WRITE(uint32_t AddrSel, uint8_t wb )
 {
@@ -60,7 +141,10 @@ void WIZCHIP_WRITE(uint32_t AddrSel, uint8_t wb )
    tAD[3] = wb;
 
    tAD[2] |= (_W6100_SPI_WRITE_ | _W6100_SPI_OP_);
+   wizchip_xfer_sync();
    WIZCHIP_CRITICAL_ENTER();
+   WIZCHIP_IO_COUNT();
+   WIZCHIP_TRACE_BEGIN();
    if(WIZCHIP.IF.SPI._vdm_xfer != 0)
    {
 	   WIZCHIP.IF.SPI._vdm_xfer(tAD, 3, &wb, 1);			// For test
@@ -78,6 +162,7 @@ void WIZCHIP_WRITE(uint32_t AddrSel, uint8_t wb )
 
 	   WIZCHIP.CS._d_e_s_e_l_e_c_t_();
    }
+   WIZCHIP_TRACE_END(AddrSel, 3, 1);
    WIZCHIP_CRITICAL_EXIT();
 }
 
@@ -90,7 +175,10 @@ uint8_t  WIZCHIP_READ(uint32_t AddrSel)
    tAD[2] = (uint8_t)(AddrSel & 0x000000ff);
    tAD[2] |= (_W6100_SPI_READ_ | _W6100_SPI_OP_);
 
+   wizchip_xfer_sync();
    WIZCHIP_CRITICAL_ENTER();
+   WIZCHIP_IO_COUNT();
+   WIZCHIP_TRACE_BEGIN();
    if(WIZCHIP.IF.SPI._vdm_xfer != 0)
    {
 	   WIZCHIP.IF.SPI._vdm_xfer(tAD, 3, &ret, 1);
@@ -111,6 +199,7 @@ uint8_t  WIZCHIP_READ(uint32_t AddrSel)
 
 	   WIZCHIP.CS._d_e_s_e_l_e_c_t_();
    }
+   WIZCHIP_TRACE_END(AddrSel, 3, 1);
    WIZCHIP_CRITICAL_EXIT();
    return ret;
 }
@@ -123,7 +212,10 @@ void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len)
    tAD[2] = (uint8_t)(AddrSel & 0x000000ff);
    tAD[2] |= (_W6100_SPI_WRITE_ | _W6100_SPI_OP_);
 
+   wizchip_xfer_sync();
    WIZCHIP_CRITICAL_ENTER();
+   WIZCHIP_IO_COUNT();
+   WIZCHIP_TRACE_BEGIN();
    if(WIZCHIP.IF.SPI._vdm_xfer != 0)
    {
 	   WIZCHIP.IF.SPI._vdm_xfer(tAD, 3, pBuf, len);			// For test
@@ -145,6 +237,7 @@ void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len)
 
 	   WIZCHIP.CS._d_e_s_e_l_e_c_t_();
    }
+   WIZCHIP_TRACE_END(AddrSel, 3, len);
    WIZCHIP_CRITICAL_EXIT();
 }
 
@@ -156,7 +249,10 @@ void WIZCHIP_READ_BUF (uint32_t AddrSel, uint8_t* pBuf, datasize_t len)
    tAD[2] = (uint8_t)(AddrSel & 0x000000ff);
    tAD[2] |= (_W6100_SPI_READ_ | _W6100_SPI_OP_);
 
+   wizchip_xfer_sync();
    WIZCHIP_CRITICAL_ENTER();
+   WIZCHIP_IO_COUNT();
+   WIZCHIP_TRACE_BEGIN();
    if(WIZCHIP.IF.SPI._vdm_xfer != 0)
    {
 	   WIZCHIP.IF.SPI._vdm_xfer(tAD, 3, pBuf, len);			// For test
@@ -175,17 +271,119 @@ void WIZCHIP_READ_BUF (uint32_t AddrSel, uint8_t* pBuf, datasize_t len)
 #endif
 	   WIZCHIP.CS._d_e_s_e_l_e_c_t_();
    }
+   WIZCHIP_TRACE_END(AddrSel, 3, len);
+   WIZCHIP_CRITICAL_EXIT();
+}
+
+uint16_t WIZCHIP_READ_16(uint32_t AddrSel)
+{
+   uint8_t tmp[2];
+   WIZCHIP_READ_BUF(AddrSel, tmp, 2);
+   return (((uint16_t)tmp[0]) << 8) + tmp[1];
+}
+
+void WIZCHIP_WRITE_16(uint32_t AddrSel, uint16_t wb)
+{
+   uint8_t tmp[2];
+   tmp[0] = (uint8_t)(wb >> 8);
+   tmp[1] = (uint8_t)wb;
+   WIZCHIP_WRITE_BUF(AddrSel, tmp, 2);
+}
+
+uint32_t WIZCHIP_READ_32(uint32_t AddrSel)
+{
+   uint8_t tmp[4];
+   WIZCHIP_READ_BUF(AddrSel, tmp, 4);
+   return (((uint32_t)tmp[0]) << 24) + (((uint32_t)tmp[1]) << 16) + (((uint32_t)tmp[2]) << 8) + tmp[3];
+}
+
+void WIZCHIP_WRITE_32(uint32_t AddrSel, uint32_t wb)
+{
+   uint8_t tmp[4];
+   tmp[0] = (uint8_t)(wb >> 24);
+   tmp[1] = (uint8_t)(wb >> 16);
+   tmp[2] = (uint8_t)(wb >> 8);
+   tmp[3] = (uint8_t)wb;
+   WIZCHIP_WRITE_BUF(AddrSel, tmp, 4);
+}
+
+#if (_WIZCHIP_IO_COUNT_ == 1)
+uint32_t wizchip_getiocount(void)
+{
+   return wizchip_io_count;
+}
+
+void wizchip_clriocount(void)
+{
+   wizchip_io_count = 0;
+}
+#endif
+
+#if (_WIZCHIP_IO_TRACE_ == 1)
+void reg_wizchip_trace_cbfunc(uint32_t (*clock)(void))
+{
+   wizchip_trace_clock = clock;
+}
+
+void wizchip_trace_get(wiz_IOTraceStat* stat)
+{
+   WIZCHIP_CRITICAL_ENTER();
+   memcpy(stat, &wizchip_trace, sizeof(wiz_IOTraceStat));
    WIZCHIP_CRITICAL_EXIT();
 }
 
+void wizchip_trace_clear(void)
+{
+   WIZCHIP_CRITICAL_ENTER();
+   memset(&wizchip_trace, 0, sizeof(wiz_IOTraceStat));
+   WIZCHIP_CRITICAL_EXIT();
+}
+
+static void wizchip_trace_print(const char* name, const wiz_IOTrace* t)
+{
+   uint32_t total = t->ctrl + t->data;
+   if(t->count == 0) return;
+   printf("%-12s %10lu %10lu %10lu %10lu %4lu\r\n", name,
+          (unsigned long)t->count, (unsigned long)t->ctrl, (unsigned long)t->data, (unsigned long)t->time,
+          (unsigned long)(((uint64_t)t->ctrl * 1000) / total));
+}
+
+void wizchip_trace_dump(void)
+{
+   static const char* const block_name[WIZ_TRACE_BLOCK_NUM] = { "CREG", "SREG", "TXBUF", "RXBUF" };
+   static const char* const api_name[WIZ_TRACE_API_NUM] =
+   {
+      "app", "socket", "close", "listen", "connect", "disconnect", "send", "recv",
+      "sendto", "recvfrom", "ctlsocket", "setsockopt", "getsockopt", "peek", "event"
+   };
+   wiz_IOTraceStat stat;
+   uint8_t i;
+   wizchip_trace_get(&stat);
+   printf("%-12s %10s %10s %10s %10s %4s\r\n", "", "count", "ctrl", "data", "time", "o/h");
+   for(i = 0; i < WIZ_TRACE_BLOCK_NUM; i++) wizchip_trace_print(block_name[i], &stat.block[i]);
+   for(i = 0; i < WIZ_TRACE_API_NUM; i++)   wizchip_trace_print(api_name[i], &stat.api[i]);
+}
+
+uint8_t wizchip_trace_enter(uint8_t api)
+{
+   uint8_t prev = wizchip_trace_api;
+   wizchip_trace_api = api;
+   return prev;
+}
+
+void wizchip_trace_leave(uint8_t* api)
+{
+   wizchip_trace_api = *api;
+}
+#endif
+
 datasize_t getSn_TX_FSR(uint8_t sn)
 {
    datasize_t prev_val=-1,val=0;
    do
    {
       prev_val = val;
-      val = WIZCHIP_READ(_Sn_TX_FSR_(sn));
-      val = (val << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_Sn_TX_FSR_(sn),1));
+      val = (datasize_t)WIZCHIP_READ_16(_Sn_TX_FSR_(sn));
    }while (val != prev_val);
    return val;
 }
@@ -196,8 +394,7 @@ datasize_t getSn_RX_RSR(uint8_t sn)
    do
    {
       prev_val = val;
-      val = WIZCHIP_READ(_Sn_RX_RSR_(sn));
-      val = (val << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_Sn_RX_RSR_(sn),1));
+      val = (datasize_t)WIZCHIP_READ_16(_Sn_RX_RSR_(sn));
    }while (val != prev_val);
    return val;
 }
@@ -230,6 +427,70 @@ void wiz_recv_ignore(uint8_t sn, datasize_t len)
    setSn_RX_RD(sn,getSn_RX_RD(sn)+len);
 }
 
+static void wiz_data_async(uint32_t bufsel, uint8_t rw, uint32_t ptr_addr, uint8_t *wizdata, datasize_t len, void (*done)(void* arg), void* arg)
+{
+   uint16_t ptr;
+   uint32_t addrsel;
+
+   if(len <= 0)
+   {
+      if(done) done(arg);
+      return;
+   }
+   ptr = WIZCHIP_READ_16(ptr_addr);   // waits the previous transfer
+   addrsel = ((uint32_t)ptr << 8) + bufsel;
+   if(WIZCHIP.IF.SPI._vdm_xfer_async == 0)
+   {
+      if(rw == _W6100_SPI_WRITE_) WIZCHIP_WRITE_BUF(addrsel, wizdata, len);
+      else                        WIZCHIP_READ_BUF(addrsel, wizdata, len);
+      WIZCHIP_WRITE_16(ptr_addr, ptr + len);
+      if(done) done(arg);
+      return;
+   }
+   wizchip_xfer_ad[0] = (uint8_t)((addrsel & 0x00FF0000) >> 16);
+   wizchip_xfer_ad[1] = (uint8_t)((addrsel & 0x0000FF00) >> 8);
+   wizchip_xfer_ad[2] = (uint8_t)(addrsel & 0x000000ff);
+   wizchip_xfer_ad[2] |= (rw | _W6100_SPI_OP_);
+   wizchip_xfer_ptr_addr = ptr_addr;
+   wizchip_xfer_ptr = ptr + len;
+   wizchip_xfer_cb  = done;
+   wizchip_xfer_arg = arg;
+   wizchip_xfer_commit = 1;
+   WIZCHIP_XFER_SET(1);
+
+   WIZCHIP_CRITICAL_ENTER();
+   WIZCHIP_IO_COUNT();
+   WIZCHIP_TRACE_BEGIN();
+   WIZCHIP.IF.SPI._vdm_xfer_async(wizchip_xfer_ad, 3, wizdata, len);
+   WIZCHIP_TRACE_END(addrsel, 3, len);
+   WIZCHIP_CRITICAL_EXIT();
+}
+
+void wiz_send_data_async(uint8_t sn, uint8_t *wizdata, datasize_t len, void (*done)(void* arg), void* arg)
+{
+   wiz_data_async(WIZCHIP_TXBUF_BLOCK(sn), _W6100_SPI_WRITE_, _Sn_TX_WR_(sn), wizdata, len, done, arg);
+}
+
+void wiz_recv_data_async(uint8_t sn, uint8_t *wizdata, datasize_t len, void (*done)(void* arg), void* arg)
+{
+   wiz_data_async(WIZCHIP_RXBUF_BLOCK(sn), _W6100_SPI_READ_, _Sn_RX_RD_(sn), wizdata, len, done, arg);
+}
+
+uint8_t wiz_data_async_busy(void)
+{
+   return WIZCHIP_XFER_BUSY();
+}
+
+void wizchip_xfer_done(void)
+{
+   /* Take the callback before release, as the next transfer can be started at once after it. */
+   void (*cb)(void* arg) = wizchip_xfer_cb;
+   void* arg = wizchip_xfer_arg;
+   wizchip_xfer_cb = 0;
+   WIZCHIP_XFER_SET(0);
+   if(cb) cb(arg);
+}
+
 /// @cond DOXY_APPLY_CODE
 #if (_PHY_IO_MODE_ == _PHY_IO_MODE_MII_)
 /// @endcond
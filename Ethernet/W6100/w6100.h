@@ -3410,6 +3410,184 @@ void WIZCHIP_READ_BUF (uint32_t AddrSel, uint8_t* pBuf, datasize_t len);
  */
 void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len);
 
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It reads 2 bytes value from a 16bit register in one bus transaction.
+ * @details The register is read as big-endian with @ref WIZCHIP_READ_BUF(),\n
+ *          so it costs one address phase instead of the two of @ref WIZCHIP_READ().
+ * @param AddrSel Register address of the upper byte
+ * @return The value of register
+ * @sa WIZCHIP_WRITE_16(), WIZCHIP_READ_32(), WIZCHIP_READ_BUF()
+ */
+uint16_t WIZCHIP_READ_16(uint32_t AddrSel);
+
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It writes 2 bytes value to a 16bit register in one bus transaction.
+ * @param AddrSel Register address of the upper byte
+ * @param wb Write data
+ * @return void
+ * @sa WIZCHIP_READ_16(), WIZCHIP_WRITE_32(), WIZCHIP_WRITE_BUF()
+ */
+void WIZCHIP_WRITE_16(uint32_t AddrSel, uint16_t wb);
+
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It reads 4 bytes value from a 32bit register in one bus transaction.
+ * @param AddrSel Register address of the most significant byte
+ * @return The value of register
+ * @sa WIZCHIP_WRITE_32(), WIZCHIP_READ_16(), WIZCHIP_READ_BUF()
+ */
+uint32_t WIZCHIP_READ_32(uint32_t AddrSel);
+
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It writes 4 bytes value to a 32bit register in one bus transaction.
+ * @param AddrSel Register address of the most significant byte
+ * @param wb Write data
+ * @return void
+ * @sa WIZCHIP_READ_32(), WIZCHIP_WRITE_16(), WIZCHIP_WRITE_BUF()
+ */
+void WIZCHIP_WRITE_32(uint32_t AddrSel, uint32_t wb);
+
+/// @cond DOXY_APPLY_CODE
+#if (_WIZCHIP_IO_COUNT_ == 1)
+/// @endcond
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It gets the count of bus transactions issued to @ref _WIZCHIP_.
+ * @details Every call of @ref WIZCHIP_READ(), @ref WIZCHIP_WRITE(), @ref WIZCHIP_READ_BUF() and @ref WIZCHIP_WRITE_BUF()\n
+ *          is one transaction, that is one chip select with its own address phase.
+ * @return The count of transactions since the last @ref wizchip_clriocount()
+ * @note In order to use it, You should define @ref _WIZCHIP_IO_COUNT_ to 1.
+ * @sa wizchip_clriocount()
+ */
+uint32_t wizchip_getiocount(void);
+
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It clears the count of bus transactions.
+ * @note In order to use it, You should define @ref _WIZCHIP_IO_COUNT_ to 1.
+ * @sa wizchip_getiocount()
+ */
+void wizchip_clriocount(void);
+/// @cond DOXY_APPLY_CODE
+#endif
+/// @endcond
+
+/// @cond DOXY_APPLY_CODE
+#if (_WIZCHIP_IO_TRACE_ == 1)
+/// @endcond
+/**
+ * @ingroup DATA_TYPE
+ * @brief Register blocks of @ref _WIZCHIP_ accounted by the bus tracer.
+ */
+typedef enum
+{
+   WIZ_TRACE_CREG,      ///< Common registers
+   WIZ_TRACE_SREG,      ///< SOCKETn registers
+   WIZ_TRACE_TXBUF,     ///< SOCKETn TX buffer
+   WIZ_TRACE_RXBUF,     ///< SOCKETn RX buffer
+   WIZ_TRACE_BLOCK_NUM
+}wiz_trace_block;
+
+/**
+ * @ingroup DATA_TYPE
+ * @brief SOCKET APIs accounted by the bus tracer.
+ */
+typedef enum
+{
+   WIZ_TRACE_APP,          ///< Out of SOCKET APIs, such as the register access of your application
+   WIZ_TRACE_SOCKET,       ///< wiz_socket()
+   WIZ_TRACE_CLOSE,        ///< wiz_close()
+   WIZ_TRACE_LISTEN,       ///< wiz_listen()
+   WIZ_TRACE_CONNECT,      ///< wiz_connect()
+   WIZ_TRACE_DISCONNECT,   ///< wiz_disconnect()
+   WIZ_TRACE_SEND,         ///< wiz_send(), wiz_sendv() and wiz_send_flush()
+   WIZ_TRACE_RECV,         ///< wiz_recv() and wiz_recvv()
+   WIZ_TRACE_SENDTO,       ///< wiz_sendto()
+   WIZ_TRACE_RECVFROM,     ///< wiz_recvfrom()
+   WIZ_TRACE_CTLSOCKET,    ///< ctlsocket()
+   WIZ_TRACE_SETSOCKOPT,   ///< setsockopt()
+   WIZ_TRACE_GETSOCKOPT,   ///< getsockopt()
+   WIZ_TRACE_PEEK,         ///< peeksockmsg()
+   WIZ_TRACE_EVENT,        ///< wiz_poll() and wiz_wait_events()
+   WIZ_TRACE_API_NUM
+}wiz_trace_api;
+
+/**
+ * @ingroup DATA_TYPE
+ * @brief Accounting of bus transactions.
+ */
+typedef struct wiz_IOTrace_t
+{
+   uint32_t count;      ///< transactions
+   uint32_t ctrl;       ///< address and control phase bytes
+   uint32_t data;       ///< data phase bytes
+   uint32_t time;       ///< time in the unit of the clock of @ref reg_wizchip_trace_cbfunc()
+}wiz_IOTrace;
+
+/**
+ * @ingroup DATA_TYPE
+ * @brief Statistics of the bus tracer.
+ */
+typedef struct wiz_IOTraceStat_t
+{
+   wiz_IOTrace block[WIZ_TRACE_BLOCK_NUM];   ///< by @ref wiz_trace_block
+   wiz_IOTrace api[WIZ_TRACE_API_NUM];       ///< by @ref wiz_trace_api
+}wiz_IOTraceStat;
+
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It registers the clock to measure the time of bus transactions.
+ * @param clock callback function returning a free running counter such as us. NULL stops the time measurement.
+ * @note In order to use it, You should define @ref _WIZCHIP_IO_TRACE_ to 1.
+ */
+void reg_wizchip_trace_cbfunc(uint32_t (*clock)(void));
+
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It gets the statistics of bus transactions since the last @ref wizchip_trace_clear().
+ * @param stat Pointer of @ref wiz_IOTraceStat to be filled.
+ * @note In order to use it, You should define @ref _WIZCHIP_IO_TRACE_ to 1.
+ */
+void wizchip_trace_get(wiz_IOTraceStat* stat);
+
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It clears the statistics of bus transactions.
+ * @note In order to use it, You should define @ref _WIZCHIP_IO_TRACE_ to 1.
+ */
+void wizchip_trace_clear(void);
+
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It prints the statistics of bus transactions with printf().
+ * @details Each line has transactions, address/control bytes, data bytes, time \n
+ *          and the overhead ratio of address/control bytes to all bytes in permille.
+ * @note In order to use it, You should define @ref _WIZCHIP_IO_TRACE_ to 1.
+ */
+void wizchip_trace_dump(void);
+
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It sets the SOCKET API accounting the following transactions.
+ * @param api @ref wiz_trace_api
+ * @return The previous one, to be restored by @ref wizchip_trace_leave().
+ * @note It is called by SOCKET APIs.
+ */
+uint8_t wizchip_trace_enter(uint8_t api);
+
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It restores the SOCKET API returned by @ref wizchip_trace_enter().
+ * @param api Pointer of the value returned by @ref wizchip_trace_enter().
+ */
+void wizchip_trace_leave(uint8_t* api);
+/// @cond DOXY_APPLY_CODE
+#endif
+/// @endcond
+
 
 
 /////////////////////////////////
@@ -3420,10 +3598,10 @@ void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len);
  * @{
  */
 #define getCIDR() \
-        ((((uint16_t)WIZCHIP_READ(_CIDR_)) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_CIDR_,1)))
+        WIZCHIP_READ_16(_CIDR_)
 
 #define getVER() \
-        ((((uint16_t)WIZCHIP_READ(_VER_)) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_VER_,1)))
+        WIZCHIP_READ_16(_VER_)
 
 #define getSYSR() \
         WIZCHIP_READ(_SYSR_)
@@ -3441,7 +3619,7 @@ void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len);
         WIZCHIP_WRITE(_SYCR1_, (sycr1))
 
 #define getTCNTR() \
-        ((((uint16_t)WIZCHIP_READ(_TCNTR_)) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_TCNTR_,1)))
+        WIZCHIP_READ_16(_TCNTR_)
 
 #define setTCNTRCLR(tcntrclr) \
         WIZCHIP_WRITE(_TCNTRCLR_,(tcntrclr))
@@ -3575,22 +3753,16 @@ void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len);
         WIZCHIP_READ_BUF(_PHAR_,(phar),6)
 
 #define setPSIDR(psidr) \
-        do{                                                                \
-            WIZCHIP_WRITE(_PSIDR_,(uint8_t)((psidr) >> 8));                \
-            WIZCHIP_WRITE(WIZCHIP_OFFSET_INC(_PSIDR_,1),(uint8_t)(psidr)); \
-        }while(0);
+        WIZCHIP_WRITE_16(_PSIDR_,(psidr))
 
 #define getPSIDR() \
-        ((((uint16_t)WIZCHIP_READ(_PSIDR_)) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_PSIDR_,1)))
+        WIZCHIP_READ_16(_PSIDR_)
 
 #define setPMRUR(pmrur) \
-        do{                                                                \
-            WIZCHIP_WRITE(_PMRUR_,(uint8_t)((pmrur) >> 8));                \
-            WIZCHIP_WRITE(WIZCHIP_OFFSET_INC(_PMRUR_,1),(uint8_t)(pmrur)); \
-        }while(0);
+        WIZCHIP_WRITE_16(_PMRUR_,(pmrur))
 
 #define getPMRUR() \
-        ((((uint16_t)WIZCHIP_READ(_PMRUR_)) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_PMRUR_,1)))
+        WIZCHIP_READ_16(_PMRUR_)
 
 #define setSHAR(shar) \
         WIZCHIP_WRITE_BUF(_SHAR_,(shar),6)
@@ -3664,22 +3836,16 @@ void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len);
         WIZCHIP_READ_BUF(_SLDHAR_,(sldhar),6)
 
 #define setPINGIDR(pingidr) \
-        do{                                                                    \
-            WIZCHIP_WRITE(_PINGIDR_,(uint8_t)((pingidr)>>8));                  \
-            WIZCHIP_WRITE(WIZCHIP_OFFSET_INC(_PINGIDR_,1),(uint8_t)(pingidr)); \
-        }while(0);
+        WIZCHIP_WRITE_16(_PINGIDR_,(pingidr))
 
 #define getPINGIDR() \
-        (((int16_t)(WIZCHIP_READ(_PINGIDR_) << 8)) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_PINGIDR_,1)))
+        ((int16_t)WIZCHIP_READ_16(_PINGIDR_))
 
 #define setPINGSEQR(pingseqr) \
-        do{                                                                      \
-            WIZCHIP_WRITE(_PINGSEQR_,(uint8_t)((pingseqr)>>8));                  \
-            WIZCHIP_WRITE(WIZCHIP_OFFSET_INC(_PINGSEQR_,1),(uint8_t)(pingseqr)); \
-        }while(0);
+        WIZCHIP_WRITE_16(_PINGSEQR_,(pingseqr))
 
 #define getPINGSEQR() \
-        (((int16_t)(WIZCHIP_READ(_PINGSEQR_) << 8)) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_PINGSEQR_,1)))
+        ((int16_t)WIZCHIP_READ_16(_PINGSEQR_))
 
 #define getUIPR(uipr) \
         WIZCHIP_READ_BUF(_UIPR_, (uipr), 4)
@@ -3687,7 +3853,7 @@ void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len);
 #define getUIP4R(uip4r)          getUIPR(uip4r)
 
 #define getUPORTR() \
-        ((((uint16_t)WIZCHIP_READ(_UPORTR_)) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_UPORTR_,1)))
+        WIZCHIP_READ_16(_UPORTR_)
 
 #define getUPORT4R()             getUPORTR()
 
@@ -3695,16 +3861,13 @@ void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len);
         WIZCHIP_READ_BUF(_UIP6R_,(uip6r),16)
 
 #define getUPORT6R(uport6r) \
-        ((((uint16_t)WIZCHIP_READ(_UPORT6R_)) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_UPORT6R_,1)))
+        WIZCHIP_READ_16(_UPORT6R_)
 
 #define setINTPTMR(intptmr) \
-        do{                                                                     \
-            WIZCHIP_WRITE(_INTPTMR_,(uint8_t)((intptmr) >> 8));                 \
-            WIZCHIP_WRITE(WIZCHIP_OFFSET_INC(_INTPTMR_,1),(uint8_t)(intptmr));  \
-       }while(0);
+        WIZCHIP_WRITE_16(_INTPTMR_,(intptmr))
 
 #define getINTPTMR() \
-        ((((uint16_t)WIZCHIP_READ(_INTPTMR_)) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_INTPTMR_,1)))
+        WIZCHIP_READ_16(_INTPTMR_)
 
 #define getPLR() \
         WIZCHIP_READ(_PLR_)
@@ -3713,16 +3876,10 @@ void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len);
         WIZCHIP_READ(_PFR_)
 
 #define getVLTR() \
-        ( (((uint32_t)WIZCHIP_READ(_VLTR_)) << 24) +                       \
-          (((uint32_t)WIZCHIP_READ(WIZCHIP_OFFSET_INC(_VLTR_,1))) << 16) + \
-          (((uint32_t)WIZCHIP_READ(WIZCHIP_OFFSET_INC(_VLTR_,2))) << 16) + \
-          (((uint32_t)WIZCHIP_READ(WIZCHIP_OFFSET_INC(_VLTR_,3))) << 16) )
+        WIZCHIP_READ_32(_VLTR_)
 
 #define getPLTR() \
-        ( (((uint32_t)WIZCHIP_READ(_PLTR_)) << 24) +                       \
-          (((uint32_t)WIZCHIP_READ(WIZCHIP_OFFSET_INC(_PLTR_,1))) << 16) + \
-          (((uint32_t)WIZCHIP_READ(WIZCHIP_OFFSET_INC(_PLTR_,2))) << 16) + \
-          (((uint32_t)WIZCHIP_READ(WIZCHIP_OFFSET_INC(_PLTR_,3))) << 16) )
+        WIZCHIP_READ_32(_PLTR_)
 
 #define getPAR(par) \
         WIZCHIP_READ_BUF(_PAR_, (par), 16)
@@ -3761,13 +3918,10 @@ void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len);
 #define PHYUNLOCK()    setPHYLCKR(0x53)
 
 #define setRTR(rtr) \
-        do{                                                            \
-            WIZCHIP_WRITE(_RTR_,(uint8_t)((rtr)>>8));                  \
-            WIZCHIP_WRITE(WIZCHIP_OFFSET_INC(_RTR_,1),(uint8_t)(rtr)); \
-        }while(0);
+        WIZCHIP_WRITE_16(_RTR_,(rtr))
 
 #define getRTR() \
-        ((((uint16_t)WIZCHIP_READ(_RTR_)) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_RTR_,1)))
+        WIZCHIP_READ_16(_RTR_)
 
 #define setRCR(rcr) \
         WIZCHIP_WRITE(_RCR_,(rcr))
@@ -3776,13 +3930,10 @@ void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len);
         WIZCHIP_READ(_RCR_)
 
 #define setSLRTR(slrtr) \
-        do{                                                                \
-            WIZCHIP_WRITE(_SLRTR_,(uint8_t)((slrtr)>>8));                  \
-            WIZCHIP_WRITE(WIZCHIP_OFFSET_INC(_SLRTR_,1),(uint8_t)(slrtr)); \
-        }while(0);
+        WIZCHIP_WRITE_16(_SLRTR_,(slrtr))
 
 #define getSLRTR() \
-        ((((uint16_t)WIZCHIP_READ(_SLRTR_)) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_SLRTR_,1)))
+        WIZCHIP_READ_16(_SLRTR_)
 
 #define setSLRCR(slrcr) \
         WIZCHIP_WRITE(_SLRCR_,(slrcr))
@@ -3862,28 +4013,19 @@ void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len);
 #define getSn_HOPR(sn)           getSn_TTLR(sn)
 
 #define setSn_FRGR(sn,frgr) \
-        do{                                                                      \
-            WIZCHIP_WRITE(_Sn_FRGR_(sn),(uint8_t)((frgr)>>8));                   \
-            WIZCHIP_WRITE(WIZCHIP_OFFSET_INC(_Sn_FRGR_(sn),1),(uint8_t)(frgr));  \
-        }while(0);
+        WIZCHIP_WRITE_16(_Sn_FRGR_(sn),(frgr))
 #define getSn_FRGR(sn,frgr) \
-        ((((uint16_t)WIZCHIP_READ(_Sn_FRGR_(sn))) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_Sn_FRGR_(sn),1)))
+        WIZCHIP_READ_16(_Sn_FRGR_(sn))
 
 #define setSn_MSSR(sn,mssr) \
-        do{                                                                      \
-            WIZCHIP_WRITE(_Sn_MSSR_(sn),(uint8_t)((mssr)>>8));                   \
-            WIZCHIP_WRITE(WIZCHIP_OFFSET_INC(_Sn_MSSR_(sn),1),(uint8_t)(mssr));  \
-        }while(0);
+        WIZCHIP_WRITE_16(_Sn_MSSR_(sn),(mssr))
 #define getSn_MSSR(sn) \
-        ((((uint16_t)WIZCHIP_READ(_Sn_MSSR_(sn))) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_Sn_MSSR_(sn),1)))
+        WIZCHIP_READ_16(_Sn_MSSR_(sn))
 
 #define setSn_PORTR(sn,portr) \
-        do{                                                                       \
-            WIZCHIP_WRITE(_Sn_PORTR_(sn),(uint8_t)((portr)>>8));                  \
-            WIZCHIP_WRITE(WIZCHIP_OFFSET_INC(_Sn_PORTR_(sn),1),(uint8_t)(portr)); \
-        }while(0);
+        WIZCHIP_WRITE_16(_Sn_PORTR_(sn),(portr))
 #define getSn_PORTR(sn) \
-        ((((uint16_t)WIZCHIP_READ(_Sn_PORTR_(sn))) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_Sn_PORTR_(sn),1)))
+        WIZCHIP_READ_16(_Sn_PORTR_(sn))
 
 #define setSn_DHAR(sn,dhar) \
         WIZCHIP_WRITE_BUF(_Sn_DHAR_(sn),(dhar),6)
@@ -3904,12 +4046,9 @@ void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len);
         WIZCHIP_READ_BUF(_Sn_DIP6R_(sn),(dip6r),16)
 
 #define setSn_DPORTR(sn,dportr) \
-        do{                                                                         \
-            WIZCHIP_WRITE(_Sn_DPORTR_(sn),(uint8_t)((dportr)>>8));                  \
-            WIZCHIP_WRITE(WIZCHIP_OFFSET_INC(_Sn_DPORTR_(sn),1),(uint8_t)(dportr)); \
-        }while(0);
+        WIZCHIP_WRITE_16(_Sn_DPORTR_(sn),(dportr))
 #define getSn_DPORTR(sn) \
-        ((((uint16_t)WIZCHIP_READ(_Sn_DPORTR_(sn))) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_Sn_DPORTR_(sn),1)))
+        WIZCHIP_READ_16(_Sn_DPORTR_(sn))
 
 #define setSn_MR2(sn,mr2) \
         WIZCHIP_WRITE(_Sn_MR2_(sn),(mr2))
@@ -3917,12 +4056,9 @@ void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len);
         WIZCHIP_READ(_Sn_MR2_(sn))
 
 #define setSn_RTR(sn,rtr) \
-        do{                                                                   \
-            WIZCHIP_WRITE(_Sn_RTR_(sn),(uint8_t)((rtr)>>8));                  \
-            WIZCHIP_WRITE(WIZCHIP_OFFSET_INC(_Sn_RTR_(sn),1),(uint8_t)(rtr)); \
-        }while(0);
+        WIZCHIP_WRITE_16(_Sn_RTR_(sn),(rtr))
 #define getSn_RTR(sn) \
-        ((((uint16_t)WIZCHIP_READ(_Sn_RTR_(sn))) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_Sn_RTR_(sn),1)))
+        WIZCHIP_READ_16(_Sn_RTR_(sn))
 
 #define setSn_RCR(sn,rcr) \
         WIZCHIP_WRITE(_Sn_RCR_(sn),(rcr))
@@ -3948,15 +4084,12 @@ void WIZCHIP_WRITE_BUF(uint32_t AddrSel, uint8_t* pBuf, datasize_t len);
 datasize_t getSn_TX_FSR(uint8_t sn);
 
 #define getSn_TX_RD(sn) \
-        ((((uint16_t)WIZCHIP_READ(_Sn_TX_RD_(sn))) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_Sn_TX_RD_(sn),1)))
+        WIZCHIP_READ_16(_Sn_TX_RD_(sn))
 
 #define setSn_TX_WR(sn,txwr) \
-        do{                                                                       \
-            WIZCHIP_WRITE(_Sn_TX_WR_(sn), (uint8_t)((txwr)>>8));                  \
-            WIZCHIP_WRITE(WIZCHIP_OFFSET_INC(_Sn_TX_WR_(sn),1), (uint8_t)(txwr)); \
-        }while(0);
+        WIZCHIP_WRITE_16(_Sn_TX_WR_(sn),(txwr))
 #define getSn_TX_WR(sn) \
-        (((uint16_t)WIZCHIP_READ(_Sn_TX_WR_(sn)) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_Sn_TX_WR_(sn),1)))
+        WIZCHIP_READ_16(_Sn_TX_WR_(sn))
 
 #define setSn_RX_BSR(sn,rmsr) \
         WIZCHIP_WRITE(_Sn_RX_BSR_(sn),(rmsr))
@@ -3972,16 +4105,13 @@ datasize_t getSn_TX_FSR(uint8_t sn);
 datasize_t getSn_RX_RSR(uint8_t s);
 
 #define setSn_RX_RD(sn,rxrd) \
-        do{                                                                        \
-            WIZCHIP_WRITE(_Sn_RX_RD_(sn), (uint8_t)((rxrd)>>8));                   \
-            WIZCHIP_WRITE(WIZCHIP_OFFSET_INC(_Sn_RX_RD_(sn),1), (uint8_t)(rxrd)) ; \
-        }while(0);
+        WIZCHIP_WRITE_16(_Sn_RX_RD_(sn),(rxrd))
 
 #define getSn_RX_RD(sn) \
-        (((uint16_t)WIZCHIP_READ(_Sn_RX_RD_(sn)) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_Sn_RX_RD_(sn),1)))
+        WIZCHIP_READ_16(_Sn_RX_RD_(sn))
 
 #define getSn_RX_WR(sn) \
-        (((uint16_t)WIZCHIP_READ(_Sn_RX_WR_(sn)) << 8) + WIZCHIP_READ(WIZCHIP_OFFSET_INC(_Sn_RX_WR_(sn),1)))
+        WIZCHIP_READ_16(_Sn_RX_WR_(sn))
 /**
  * @}
  */
@@ -4027,6 +4157,57 @@ void wiz_recv_data(uint8_t sn, uint8_t *wizdata, datasize_t len);
  */
 void wiz_recv_ignore(uint8_t sn, datasize_t len);
 
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It starts to save data to be sent in the SOCKETn TX buffer, and returns without waiting it completed.
+ * @details It is same as @ref wiz_send_data() except that the copy of <i>wizdata</i> is started by \n
+ *          the asynchronous transfer callback of @ref reg_wizchip_spi_async_cbfunc(), such as SPI DMA.\n
+ *          <i>done</i> is called from @ref wizchip_xfer_done() when the transfer is completed, \n
+ *          and @ref _Sn_TX_WR_ is increased by the first access to @ref _WIZCHIP_ after that.
+ * @param sn SOCKETn. It should be <b>0 ~ @ref _WIZCHIP_SOCK_NUM_</b>.
+ * @param wizdata Pointer buffer to write data. It should be kept until <i>done</i> is called.
+ * @param len Data length
+ * @param done Callback called when the transfer is completed. It can be NULL.
+ * @param arg Argument of <i>done</i>
+ * @note Any access to @ref _WIZCHIP_ waits until the transfer is completed.\n
+ *       If the asynchronous transfer callback is not registered, it works as @ref wiz_send_data() and calls <i>done</i> before return.
+ * @sa wiz_recv_data_async(), wiz_data_async_busy()
+ */
+void wiz_send_data_async(uint8_t sn, uint8_t *wizdata, datasize_t len, void (*done)(void* arg), void* arg);
+
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It starts to copy the received data in the SOCKETn RX buffer to <i>wizdata</i>, and returns without waiting it completed.
+ * @details It is same as @ref wiz_recv_data() except that the copy is started by \n
+ *          the asynchronous transfer callback of @ref reg_wizchip_spi_async_cbfunc(), such as SPI DMA.\n
+ *          <i>done</i> is called from @ref wizchip_xfer_done() when the transfer is completed, \n
+ *          and @ref _Sn_RX_RD_ is increased by the first access to @ref _WIZCHIP_ after that.
+ * @param sn SOCKETn. It should be <b>0 ~ @ref _WIZCHIP_SOCK_NUM_</b>.
+ * @param wizdata Pointer buffer to read data. It is valid after <i>done</i> is called.
+ * @param len Data length
+ * @param done Callback called when the transfer is completed. It can be NULL.
+ * @param arg Argument of <i>done</i>
+ * @note Same as @ref wiz_send_data_async().
+ * @sa wiz_send_data_async(), wiz_data_async_busy()
+ */
+void wiz_recv_data_async(uint8_t sn, uint8_t *wizdata, datasize_t len, void (*done)(void* arg), void* arg);
+
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It checks the transfer of @ref wiz_send_data_async() or @ref wiz_recv_data_async() is in progress.
+ * @return 1 : in progress, 0 : completed
+ */
+uint8_t wiz_data_async_busy(void);
+
+/**
+ * @ingroup Basic_IO_function_W6100
+ * @brief It completes the transfer started by the asynchronous transfer callback.
+ * @details Your transfer completion handler, such as SPI DMA interrupt, should call it \n
+ *          after <i>_WIZCHIP_</i> is deselected. It calls <i>done</i> of @ref wiz_send_data_async() or @ref wiz_recv_data_async().
+ * @sa reg_wizchip_spi_async_cbfunc()
+ */
+void wizchip_xfer_done(void);
+
 /// @cond DOXY_APPLY_CODE
 #if (_PHY_IO_MODE_ == _PHY_IO_MODE_MII_)
 /// @endcond
@@ -35,6 +35,7 @@
 //*****************************************************************************
 
 #include <stdio.h>
+#include <string.h>
 #include "socket.h"
 #include "w6100.h"
 
@@ -43,8 +44,66 @@
 static uint16_t sock_any_port = SOCK_ANY_PORT_NUM;
 static uint16_t sock_io_mode = 0;
 static uint16_t sock_is_sending = 0;
+static uint16_t sock_send_stream = 0;
 static datasize_t sock_remained_size[_WIZCHIP_SOCK_NUM_] = {0,0,};
 static uint8_t  sock_pack_info[_WIZCHIP_SOCK_NUM_] = {0,};
+static datasize_t sock_send_pending[_WIZCHIP_SOCK_NUM_] = {0,};  ///< bytes appended by SOCK_SEND_STREAM and not sent yet
+
+static uint8_t  sock_intr_sn = 0;                                ///< SOCKETs of the event engine
+static uint8_t  sock_ir[_WIZCHIP_SOCK_NUM_] = {0,};              ///< _Sn_IR_ collected by wiz_poll()
+static void   (*sock_event_cb[_WIZCHIP_SOCK_NUM_])(uint8_t sn, uint8_t events) = {0,};
+
+static uint8_t    sock_sel_valid = 0;                            ///< SOCKETs whose state below is cached for wiz_select()
+static uint8_t    sock_sel_sr[_WIZCHIP_SOCK_NUM_] = {0,};
+static datasize_t sock_sel_rsr[_WIZCHIP_SOCK_NUM_] = {0,};
+static datasize_t sock_sel_fsr[_WIZCHIP_SOCK_NUM_] = {0,};
+
+static uint8_t    sock_pool_used = 0;                            ///< SOCKETs owned in the SOCKET pool
+static uint8_t    sock_pool_owner[_WIZCHIP_SOCK_NUM_] = {0,};
+static uint8_t    sock_linger = 0;                               ///< SOCKETs disconnecting in non-block io mode
+static wiz_SockPoolStat sock_pool_stat[SOCK_OWN_NUM];
+
+static uint8_t    sock_recv_commit = 0;                          ///< SOCKETs whose Sn_CR_RECV of wiz_recv_async() is not issued yet
+static void     (*sock_async_cb[_WIZCHIP_SOCK_NUM_])(uint8_t sn, datasize_t len) = {0,};
+
+/* The SOCKET API changes the state, so wiz_select() fetches it again. */
+#define SOCK_SEL_DIRTY(sn)    sock_sel_valid &= (uint8_t)~(1 << ((sn) & 0x07))
+
+#define SOCK_INTN_WAIT_TIME   10    ///< ms to sleep on INTn at once in the blocking SOCKET APIs
+
+#ifndef SOCK_POOL_SERVICE_RESERVED
+#define SOCK_POOL_SERVICE_RESERVED  0   ///< highest SOCKETs taken only by the service class of wiz_sock_alloc()
+#endif
+
+#ifndef SOCK_POOL_APP_RESERVED
+#define SOCK_POOL_APP_RESERVED      0   ///< lowest SOCKETs taken only by the application class of wiz_sock_alloc()
+#endif
+
+#define SOCK_POOL_ALL         ((uint8_t)((1 << _WIZCHIP_SOCK_NUM_) - 1))
+#define SOCK_POOL_APP_ONLY    ((uint8_t)((1 << SOCK_POOL_APP_RESERVED) - 1))
+#define SOCK_POOL_SERVICE_ONLY ((uint8_t)(SOCK_POOL_ALL & ~(SOCK_POOL_ALL >> SOCK_POOL_SERVICE_RESERVED)))
+
+#ifndef SOCK_PEEK_CHUNK
+#define SOCK_PEEK_CHUNK       128   ///< bytes of SOCKETn RX buffer read at once by wiz_peek_find(), and the max pattern length
+#endif
+
+/* Account the bus transactions until return to the SOCKET API. */
+#if (_WIZCHIP_IO_TRACE_ == 1)
+#define SOCK_TRACE(api)   uint8_t sock_trace_prev __attribute__((cleanup(wizchip_trace_leave))) = wizchip_trace_enter(api)
+#else
+#define SOCK_TRACE(api)
+#endif
+
+
+/*
+ * Offsets of SOCKETn registers in the bursts of wiz_sock_snapshot().
+ * The control burst covers _Sn_MR_ ~ _Sn_ESR_, and the buffer burst covers _Sn_TX_BSR_ ~ _Sn_RX_WR_.
+ */
+#define SOCK_SNAP_CREG(reg)        ((uint16_t)((reg(0) - _Sn_MR_(0)) >> 8))
+#define SOCK_SNAP_BREG(reg)        ((uint16_t)((reg(0) - _Sn_TX_BSR_(0)) >> 8))
+#define SOCK_SNAP_BREG16(b, reg)   ((((uint16_t)(b)[SOCK_SNAP_BREG(reg)]) << 8) + (b)[SOCK_SNAP_BREG(reg) + 1])
+#define SOCK_SNAP_CREG_LEN         (SOCK_SNAP_CREG(_Sn_ESR_) + 1)
+#define SOCK_SNAP_BREG_LEN         (SOCK_SNAP_BREG(_Sn_RX_WR_) + 2)
 
 
 #define CHECK_SOCKNUM()                                    \
@@ -96,10 +155,77 @@ static uint8_t  sock_pack_info[_WIZCHIP_SOCK_NUM_] = {0,};
       if (ipzero == 0) return SOCKERR_IPINVALID;                     \
    }while(0);
 
+/* _Sn_IR_ including the interrupts collected by wiz_poll() */
+static uint8_t sock_getir(uint8_t sn)
+{
+   return getSn_IR(sn) | sock_ir[sn];
+}
+
+static void sock_clrir(uint8_t sn, uint8_t ir)
+{
+   sock_ir[sn] &= ~ir;
+   setSn_IRCLR(sn, ir);
+}
+
+/* Issue Sn_CR_SEND for all the data in SOCKETn TX buffer up to _Sn_TX_WR_. */
+static void sock_send_issue(uint8_t sn)
+{
+   setSn_CR(sn,Sn_CR_SEND);
+   while(getSn_CR(sn));   // wait to process the command...
+   sock_is_sending |= (1<<sn);
+   sock_send_pending[sn] = 0;
+}
+
+/* Issue Sn_CR_RECV for the data taken by wiz_recv_async(). The access waits its transfer and writes back _Sn_RX_RD_ first. */
+static void sock_recv_flush(uint8_t sn)
+{
+   if(!(sock_recv_commit & (1<<sn))) return;
+   sock_recv_commit &= ~(1<<sn);
+   setSn_CR(sn,Sn_CR_RECV);
+   while(getSn_CR(sn));
+}
+
+/* Complete the commands left by wiz_send_async() and wiz_recv_async(), once their transfer is completed. */
+static void sock_async_kick(void)
+{
+   uint8_t sn;
+   if(wiz_data_async_busy()) return;
+   for(sn = 0; sn < _WIZCHIP_SOCK_NUM_; sn++)
+   {
+      sock_recv_flush(sn);
+      /* The data after a completed or no send. The data after a send in progress is sent on its Sn_IR_SENDOK. */
+      if(!sock_send_pending[sn]) continue;
+      if(!(sock_is_sending & (1<<sn))) sock_send_issue(sn);
+      else if(sock_getir(sn) & Sn_IR_SENDOK)
+      {
+         sock_clrir(sn, Sn_IR_SENDOK);
+         sock_send_issue(sn);
+      }
+   }
+}
+
+/* Done of wiz_send_data_async() and wiz_recv_data_async(). SOCKET number and length are packed in arg. */
+static void sock_async_done(void* arg)
+{
+   uint32_t v = (uint32_t)(uintptr_t)arg;
+   uint8_t sn = (uint8_t)(v & 0x07);
+   if(sock_async_cb[sn]) sock_async_cb[sn](sn, (datasize_t)(v >> 8));
+}
+
+/* Sleep on INTn instead of polling SOCKETn registers, until any of ir is pending. */
+static void sock_idle(uint8_t sn, uint8_t ir)
+{
+   if((sock_intr_sn & (1<<sn)) && !(sock_ir[sn] & ir))
+   {
+      if(WIZCHIP.INTN._wait_(SOCK_INTN_WAIT_TIME)) wiz_poll();
+   }
+}
 
 
 int8_t wiz_socket(uint8_t sn, uint8_t protocol, uint16_t port, uint8_t flag)
 { 
+   SOCK_TRACE(WIZ_TRACE_SOCKET);
+   SOCK_SEL_DIRTY(sn);
    uint8_t taddr[16];
    //uint16_t local_port = 0;
    CHECK_SOCKNUM(); 
@@ -174,8 +300,11 @@ int8_t wiz_socket(uint8_t sn, uint8_t protocol, uint16_t port, uint8_t flag)
    sock_io_mode &= ~(1 <<sn);
    sock_io_mode |= ((flag & (SF_IO_NONBLOCK>>3)) << sn);
    sock_is_sending &= ~(1<<sn);
+   sock_send_stream &= ~(1<<sn);
+   sock_send_pending[sn] = 0;
    sock_remained_size[sn] = 0;
    sock_pack_info[sn] = PACK_NONE;
+   sock_ir[sn] = 0;
 
    while(getSn_SR(sn) == SOCK_CLOSED) ;
 //   printf("[%d]%d\r\n", sn, getSn_PORTR(sn));
@@ -185,6 +314,8 @@ int8_t wiz_socket(uint8_t sn, uint8_t protocol, uint16_t port, uint8_t flag)
 
 int8_t wiz_close(uint8_t sn)
 {
+   SOCK_TRACE(WIZ_TRACE_CLOSE);
+   SOCK_SEL_DIRTY(sn);
    CHECK_SOCKNUM();
    setSn_CR(sn,Sn_CR_CLOSE);
    /* wait to process the command... */
@@ -195,7 +326,12 @@ int8_t wiz_close(uint8_t sn)
    sock_io_mode &= ~(1<<sn); 
    sock_remained_size[sn] = 0;
    sock_is_sending &= ~(1<<sn);
+   sock_send_stream &= ~(1<<sn);
+   sock_send_pending[sn] = 0;
    sock_pack_info[sn] = PACK_NONE;
+   sock_ir[sn] = 0;
+   sock_linger &= ~(1<<sn);
+   sock_recv_commit &= ~(1<<sn);
    while(getSn_SR(sn) != SOCK_CLOSED);
    return SOCK_OK;
 }
@@ -203,6 +339,8 @@ int8_t wiz_close(uint8_t sn)
 
 int8_t wiz_listen(uint8_t sn)
 {
+   SOCK_TRACE(WIZ_TRACE_LISTEN);
+   SOCK_SEL_DIRTY(sn);
    CHECK_SOCKNUM();
    CHECK_SOCKINIT();
    setSn_CR(sn,Sn_CR_LISTEN);
@@ -218,6 +356,8 @@ int8_t wiz_listen(uint8_t sn)
 
 int8_t wiz_connect(uint8_t sn, uint8_t * addr, uint16_t port, uint8_t addrlen)
 { 
+   SOCK_TRACE(WIZ_TRACE_CONNECT);
+   SOCK_SEL_DIRTY(sn);
 
    CHECK_SOCKNUM();
    CHECK_TCPMODE();
@@ -250,21 +390,24 @@ int8_t wiz_connect(uint8_t sn, uint8_t * addr, uint16_t port, uint8_t addrlen)
 
    while(getSn_SR(sn) != SOCK_ESTABLISHED)
    {
-      if (getSn_IR(sn) & Sn_IR_TIMEOUT)
+      if (sock_getir(sn) & Sn_IR_TIMEOUT)
       {
-         setSn_IRCLR(sn, Sn_IR_TIMEOUT);
+         sock_clrir(sn, Sn_IR_TIMEOUT);
          return SOCKERR_TIMEOUT;
       }
       if (getSn_SR(sn) == SOCK_CLOSED)
       {
          return SOCKERR_SOCKCLOSED;
       }
+      sock_idle(sn, Sn_IR_CON | Sn_IR_DISCON | Sn_IR_TIMEOUT);
    } 
    return SOCK_OK;
 }
 
 int8_t wiz_disconnect(uint8_t sn)
 {
+   SOCK_TRACE(WIZ_TRACE_DISCONNECT);
+   SOCK_SEL_DIRTY(sn);
    CHECK_SOCKNUM();
    CHECK_TCPMODE();
    if(getSn_SR(sn) != SOCK_CLOSED)
@@ -272,14 +415,19 @@ int8_t wiz_disconnect(uint8_t sn)
       setSn_CR(sn,Sn_CR_DISCON);
       /* wait to process the command... */
       while(getSn_CR(sn));
-      if(sock_io_mode & (1<<sn)) return SOCK_BUSY;
+      if(sock_io_mode & (1<<sn))
+      {
+         sock_linger |= (1<<sn);
+         return SOCK_BUSY;
+      }
       while(getSn_SR(sn) != SOCK_CLOSED)
       {
-         if(getSn_IR(sn) & Sn_IR_TIMEOUT)
+         if(sock_getir(sn) & Sn_IR_TIMEOUT)
          {
             wiz_close(sn);
             return SOCKERR_TIMEOUT;
          }
+         sock_idle(sn, Sn_IR_DISCON | Sn_IR_TIMEOUT);
       }
    }
    return SOCK_OK;
@@ -288,57 +436,144 @@ int8_t wiz_disconnect(uint8_t sn)
 
 datasize_t wiz_send(uint8_t sn, uint8_t * buf, datasize_t len)
 {
-   uint8_t tmp=0;
-   datasize_t freesize=0;
+   wiz_iovec iov;
+   iov.buf = buf;
+   iov.len = len;
+   return wiz_sendv(sn, &iov, 1);
+}
+
+
+datasize_t wiz_recv(uint8_t sn, uint8_t * buf, datasize_t len)
+{
+   wiz_iovec iov;
+   iov.buf = buf;
+   iov.len = len;
+   return wiz_recvv(sn, &iov, 1);
+}
+
+
+datasize_t wiz_sendv(uint8_t sn, const wiz_iovec* iov, uint8_t count)
+{
+   SOCK_TRACE(WIZ_TRACE_SEND);
+   SOCK_SEL_DIRTY(sn);
+   wiz_SockSnapshot snap;
+   uint32_t total = 0;
+   datasize_t len, seg, remained;
+   uint16_t ptr;
+   uint8_t i;
    /* 
     * The below codes can be omitted for optmization of speed
     */
    //CHECK_SOCKNUM();
    //CHECK_TCPMODE(Sn_MR_TCP4);
    /************/
+   for(i = 0; i < count; i++) total += (uint16_t)iov[i].len;
 
-   freesize = getSn_TxMAX(sn);
-   if (len > freesize) len = freesize; // check size not to exceed MAX size.
    while(1)
    {
-      freesize = (datasize_t)getSn_TX_FSR(sn);
-      tmp = getSn_SR(sn);
-      if ((tmp != SOCK_ESTABLISHED) && (tmp != SOCK_CLOSE_WAIT))
+      if(wiz_sock_snapshot(sn, &snap) != SOCK_OK) return SOCKERR_SOCKNUM;
+      len = (total > (uint32_t)snap.tx_max) ? snap.tx_max : (datasize_t)total; // check size not to exceed MAX size.
+      if ((snap.sr != SOCK_ESTABLISHED) && (snap.sr != SOCK_CLOSE_WAIT))
       {
-         if(tmp == SOCK_CLOSED) wiz_close(sn);
+         if(snap.sr == SOCK_CLOSED) wiz_close(sn);
          return SOCKERR_SOCKSTATUS;
       }
-      if(len <= freesize) break;
+      /* In non-block io mode, nothing is written while the previous send is in progress, so SOCK_BUSY leaves no data behind. */
+      if((sock_io_mode & (1<<sn)) && (sock_is_sending & (1<<sn)) && !(sock_send_stream & (1<<sn)) && !(snap.ir & Sn_IR_SENDOK))
+         return SOCK_BUSY;
+      if(len <= snap.tx_fsr - sock_send_pending[sn]) break;
+      if(sock_send_pending[sn] && (snap.ir & Sn_IR_SENDOK))
+      {
+         /* TX buffer is full of the appended data, so send it to make a room. */
+         sock_clrir(sn, Sn_IR_SENDOK);
+         sock_send_issue(sn);
+         continue;
+      }
       if( sock_io_mode & (1<<sn) ) return SOCK_BUSY;  
+      sock_idle(sn, Sn_IR_SENDOK | Sn_IR_DISCON | Sn_IR_TIMEOUT);
    }
-   wiz_send_data(sn, buf, len);
+   /* write each segment straight into SOCKETn TX buffer, and _Sn_TX_WR_ once */
+   ptr = snap.tx_wr;
+   remained = len;
+   for(i = 0; (i < count) && (remained > 0); i++)
+   {
+      seg = (iov[i].len < remained) ? iov[i].len : remained;
+      if(seg <= 0) continue;
+      WIZCHIP_WRITE_BUF(((uint32_t)ptr << 8) + WIZCHIP_TXBUF_BLOCK(sn), iov[i].buf, seg);
+      ptr += seg;
+      remained -= seg;
+   }
+   setSn_TX_WR(sn, ptr);
    if(sock_is_sending & (1<<sn))
    {
-      while ( !(getSn_IR(sn) & Sn_IR_SENDOK) )
+      if((sock_send_stream & (1<<sn)) && !(snap.ir & Sn_IR_SENDOK))
+      {
+         /* The previous send is in progress. It is sent with the next send. */
+         sock_send_pending[sn] += len;
+         return len;
+      }
+      while ( !(snap.ir & Sn_IR_SENDOK) )
       {    
-         tmp = getSn_SR(sn);
-         if ((tmp != SOCK_ESTABLISHED) && (tmp != SOCK_CLOSE_WAIT) )
+         sock_idle(sn, Sn_IR_SENDOK | Sn_IR_DISCON | Sn_IR_TIMEOUT);
+         if(wiz_sock_snapshot(sn, &snap) != SOCK_OK) return SOCKERR_SOCKNUM;
+         if(snap.ir & Sn_IR_SENDOK) break;
+         if ((snap.sr != SOCK_ESTABLISHED) && (snap.sr != SOCK_CLOSE_WAIT) )
          {
-            if( (tmp == SOCK_CLOSED) || (getSn_IR(sn) & Sn_IR_TIMEOUT) ) wiz_close(sn);
+            if( (snap.sr == SOCK_CLOSED) || (snap.ir & Sn_IR_TIMEOUT) ) wiz_close(sn);
             return SOCKERR_SOCKSTATUS;
          }
          if(sock_io_mode & (1<<sn)) return SOCK_BUSY;
       } 
-      setSn_IRCLR(sn, Sn_IR_SENDOK);
+      sock_clrir(sn, Sn_IR_SENDOK);
    }
-   setSn_CR(sn,Sn_CR_SEND);
- 
-   while(getSn_CR(sn));   // wait to process the command...
-   sock_is_sending |= (1<<sn);
- 
+   sock_send_issue(sn);
    return len;
 }
 
 
-datasize_t wiz_recv(uint8_t sn, uint8_t * buf, datasize_t len)
+int8_t wiz_send_flush(uint8_t sn)
 {
-   uint8_t  tmp = 0;
-   datasize_t recvsize = 0;
+   SOCK_TRACE(WIZ_TRACE_SEND);
+   SOCK_SEL_DIRTY(sn);
+   uint8_t ir, sr;
+   CHECK_SOCKNUM();
+   while(sock_send_pending[sn])
+   {
+      ir = sock_getir(sn);
+      if(!(sock_is_sending & (1<<sn)))
+      {
+         /* The data of wiz_send_async() without a send in progress */
+         sock_send_issue(sn);
+         break;
+      }
+      if(ir & Sn_IR_SENDOK)
+      {
+         sock_clrir(sn, Sn_IR_SENDOK);
+         sock_send_issue(sn);
+         break;
+      }
+      sr = getSn_SR(sn);
+      if((sr != SOCK_ESTABLISHED) && (sr != SOCK_CLOSE_WAIT))
+      {
+         if((sr == SOCK_CLOSED) || (ir & Sn_IR_TIMEOUT)) wiz_close(sn);
+         return SOCKERR_SOCKSTATUS;
+      }
+      if(sock_io_mode & (1<<sn)) return SOCK_BUSY;
+      sock_idle(sn, Sn_IR_SENDOK | Sn_IR_DISCON | Sn_IR_TIMEOUT);
+   }
+   return SOCK_OK;
+}
+
+
+datasize_t wiz_recvv(uint8_t sn, const wiz_iovec* iov, uint8_t count)
+{
+   SOCK_TRACE(WIZ_TRACE_RECV);
+   SOCK_SEL_DIRTY(sn);
+   wiz_SockSnapshot snap;
+   uint32_t total = 0;
+   datasize_t len, seg, remained;
+   uint16_t ptr;
+   uint8_t i;
    /* 
     * The below codes can be omitted for optmization of speed
     */
@@ -346,31 +581,98 @@ datasize_t wiz_recv(uint8_t sn, uint8_t * buf, datasize_t len)
    //CHECK_TCPMODE();
    //CHECK_SOCKDATA();
    /************/
+   for(i = 0; i < count; i++) total += (uint16_t)iov[i].len;
+   sock_recv_flush(sn);
  
-   recvsize = getSn_RxMAX(sn); 
-   if(recvsize < len) len = recvsize;
    while(1)
    {
-      recvsize = (datasize_t)getSn_RX_RSR(sn);
-      tmp = getSn_SR(sn);
-      if (tmp != SOCK_ESTABLISHED && tmp != SOCK_CLOSE_WAIT)
+      if(sock_intr_sn & (1<<sn)) sock_clrir(sn, Sn_IR_RECV);
+      if(wiz_sock_snapshot(sn, &snap) != SOCK_OK) return SOCKERR_SOCKNUM;
+      if (snap.sr != SOCK_ESTABLISHED && snap.sr != SOCK_CLOSE_WAIT)
       {
-         if(tmp == SOCK_CLOSED) wiz_close(sn);
+         if(snap.sr == SOCK_CLOSED) wiz_close(sn);
          return SOCKERR_SOCKSTATUS;
       }
-      if(recvsize) break;
+      if(snap.rx_rsr) break;
       if(sock_io_mode & (1<<sn)) return SOCK_BUSY;
+      sock_idle(sn, Sn_IR_RECV | Sn_IR_DISCON | Sn_IR_TIMEOUT);
+   }
+   len = (total > (uint32_t)snap.rx_max) ? snap.rx_max : (datasize_t)total;
+   if(snap.rx_rsr < len) len = snap.rx_rsr;
+   if(len == 0) return 0;
+   /* read each segment straight from SOCKETn RX buffer, and _Sn_RX_RD_ once */
+   ptr = snap.rx_rd;
+   remained = len;
+   for(i = 0; (i < count) && (remained > 0); i++)
+   {
+      seg = (iov[i].len < remained) ? iov[i].len : remained;
+      if(seg <= 0) continue;
+      WIZCHIP_READ_BUF(((uint32_t)ptr << 8) + WIZCHIP_RXBUF_BLOCK(sn), iov[i].buf, seg);
+      ptr += seg;
+      remained -= seg;
    }
-   if(recvsize < len) len = recvsize;
-   wiz_recv_data(sn, buf, len); 
+   setSn_RX_RD(sn, ptr);
    setSn_CR(sn,Sn_CR_RECV); 
    while(getSn_CR(sn));  
    return len;
 }
 
 
+datasize_t wiz_send_async(uint8_t sn, uint8_t * buf, datasize_t len, void (*done)(uint8_t sn, datasize_t len))
+{
+   SOCK_TRACE(WIZ_TRACE_SEND);
+   SOCK_SEL_DIRTY(sn);
+   wiz_SockSnapshot snap;
+   datasize_t room;
+   CHECK_SOCKNUM();
+   if(len <= 0) return SOCKERR_DATALEN;
+   if(wiz_data_async_busy()) return SOCK_BUSY;
+   if(wiz_sock_snapshot(sn, &snap) != SOCK_OK) return SOCKERR_SOCKNUM;
+   if((snap.mr & 0x03) != 0x01) return SOCKERR_SOCKMODE;
+   if((snap.sr != SOCK_ESTABLISHED) && (snap.sr != SOCK_CLOSE_WAIT))
+   {
+      if(snap.sr == SOCK_CLOSED) wiz_close(sn);
+      return SOCKERR_SOCKSTATUS;
+   }
+   room = snap.tx_fsr - sock_send_pending[sn];
+   if(len > room) len = room;
+   if(len <= 0) return SOCK_BUSY;
+   sock_send_pending[sn] += len;
+   sock_async_cb[sn] = done;
+   wiz_send_data_async(sn, buf, len, sock_async_done, (void*)(uintptr_t)(((uint32_t)len << 8) | sn));
+   return len;
+}
+
+datasize_t wiz_recv_async(uint8_t sn, uint8_t * buf, datasize_t len, void (*done)(uint8_t sn, datasize_t len))
+{
+   SOCK_TRACE(WIZ_TRACE_RECV);
+   SOCK_SEL_DIRTY(sn);
+   wiz_SockSnapshot snap;
+   CHECK_SOCKNUM();
+   if(len <= 0) return SOCKERR_DATALEN;
+   if(wiz_data_async_busy()) return SOCK_BUSY;
+   sock_recv_flush(sn);
+   if(wiz_sock_snapshot(sn, &snap) != SOCK_OK) return SOCKERR_SOCKNUM;
+   if((snap.mr & 0x03) != 0x01) return SOCKERR_SOCKMODE;
+   if((snap.sr != SOCK_ESTABLISHED) && (snap.sr != SOCK_CLOSE_WAIT))
+   {
+      if(snap.sr == SOCK_CLOSED) wiz_close(sn);
+      return SOCKERR_SOCKSTATUS;
+   }
+   if(sock_intr_sn & (1<<sn)) sock_clrir(sn, Sn_IR_RECV);
+   if(len > snap.rx_rsr) len = snap.rx_rsr;
+   if(len <= 0) return SOCK_BUSY;
+   sock_recv_commit |= (1<<sn);
+   sock_async_cb[sn] = done;
+   wiz_recv_data_async(sn, buf, len, sock_async_done, (void*)(uintptr_t)(((uint32_t)len << 8) | sn));
+   return len;
+}
+
+
 datasize_t wiz_sendto(uint8_t sn, uint8_t * buf, datasize_t len, uint8_t * addr, uint16_t port, uint8_t addrlen)
 {
+   SOCK_TRACE(WIZ_TRACE_SENDTO);
+   SOCK_SEL_DIRTY(sn);
    uint8_t tmp = 0;
    uint8_t tcmd = Sn_CR_SEND;
    uint16_t freesize = 0;
@@ -415,6 +717,7 @@ datasize_t wiz_sendto(uint8_t sn, uint8_t * buf, datasize_t len, uint8_t * addr,
       if(getSn_SR(sn) == SOCK_CLOSED) return SOCKERR_SOCKCLOSED;
       if(len <= freesize) break;
       if( sock_io_mode & (1<<sn) ) return SOCK_BUSY;  
+      sock_idle(sn, Sn_IR_SENDOK | Sn_IR_TIMEOUT);
    }
    wiz_send_data(sn, buf, len);
    setSn_CR(sn,tcmd);
@@ -422,17 +725,18 @@ datasize_t wiz_sendto(uint8_t sn, uint8_t * buf, datasize_t len, uint8_t * addr,
   
    while(1)
    {
-      tmp = getSn_IR(sn);
+      tmp = sock_getir(sn);
       if(tmp & Sn_IR_SENDOK)
       {
-         setSn_IRCLR(sn, Sn_IR_SENDOK);
+         sock_clrir(sn, Sn_IR_SENDOK);
          break;
       }  
       else if(tmp & Sn_IR_TIMEOUT)
       {
-         setSn_IRCLR(sn, Sn_IR_TIMEOUT);   
+         sock_clrir(sn, Sn_IR_TIMEOUT);   
          return SOCKERR_TIMEOUT;
       }
+      sock_idle(sn, Sn_IR_SENDOK | Sn_IR_TIMEOUT);
    }  
    return (int32_t)len;
 }
@@ -440,6 +744,8 @@ datasize_t wiz_sendto(uint8_t sn, uint8_t * buf, datasize_t len, uint8_t * addr,
 
 datasize_t wiz_recvfrom(uint8_t sn, uint8_t * buf, datasize_t len, uint8_t * addr, uint16_t *port, uint8_t *addrlen)
 { 
+   SOCK_TRACE(WIZ_TRACE_RECVFROM);
+   SOCK_SEL_DIRTY(sn);
    uint8_t  head[2];
    datasize_t pack_len=0;
   
@@ -455,6 +761,7 @@ datasize_t wiz_recvfrom(uint8_t sn, uint8_t * buf, datasize_t len, uint8_t * add
    {
       while(1)
       {
+         if(sock_intr_sn & (1<<sn)) sock_clrir(sn, Sn_IR_RECV);
          pack_len = getSn_RX_RSR(sn);
          if(getSn_SR(sn) == SOCK_CLOSED) return SOCKERR_SOCKCLOSED;
          if(pack_len != 0)
@@ -463,6 +770,7 @@ datasize_t wiz_recvfrom(uint8_t sn, uint8_t * buf, datasize_t len, uint8_t * add
             break;
          } 
          if( sock_io_mode & (1<<sn) ) return SOCK_BUSY;
+         sock_idle(sn, Sn_IR_RECV | Sn_IR_TIMEOUT);
       };
       /* First read 2 bytes of PACKET INFO in SOCKETn RX buffer*/
       wiz_recv_data(sn, head, 2);  
@@ -527,6 +835,7 @@ datasize_t wiz_recvfrom(uint8_t sn, uint8_t * buf, datasize_t len, uint8_t * add
 
 int8_t ctlsocket(uint8_t sn, ctlsock_type cstype, void* arg)
 {
+   SOCK_TRACE(WIZ_TRACE_CTLSOCKET);
    uint8_t tmp = 0;
    CHECK_SOCKNUM();
    tmp = *((uint8_t*)arg); 
@@ -548,10 +857,10 @@ int8_t ctlsocket(uint8_t sn, ctlsock_type cstype, void* arg)
          break;
       case CS_CLR_INTERRUPT:
          if( tmp > SIK_ALL) return SOCKERR_ARG;
-         setSn_IRCLR(sn,tmp);
+         sock_clrir(sn,tmp);
          break;
       case CS_GET_INTERRUPT:
-         *((uint8_t*)arg) = getSn_IR(sn);
+         *((uint8_t*)arg) = sock_getir(sn);
          break;
       case CS_SET_INTMASK:
          if( tmp > SIK_ALL) return SOCKERR_ARG;
@@ -567,6 +876,14 @@ int8_t ctlsocket(uint8_t sn, ctlsock_type cstype, void* arg)
       case CS_GET_PREFER:
     	  *(uint8_t*) arg = getSn_PSR(sn);
     	  break;
+      case CS_SET_SENDMODE:
+         if(tmp == SOCK_SEND_STREAM)      sock_send_stream |= (1<<sn);
+         else if(tmp == SOCK_SEND_SERIAL) sock_send_stream &= ~(1<<sn);
+         else return SOCKERR_ARG;
+         break;
+      case CS_GET_SENDMODE:
+         *((uint8_t*)arg) = (uint8_t)((sock_send_stream >> sn) & 0x0001);
+         break;
       default:
          return SOCKERR_ARG;
    }
@@ -575,6 +892,7 @@ int8_t ctlsocket(uint8_t sn, ctlsock_type cstype, void* arg)
 
 int8_t setsockopt(uint8_t sn, sockopt_type sotype, void* arg)
 {
+   SOCK_TRACE(WIZ_TRACE_SETSOCKOPT);
    CHECK_SOCKNUM();
    switch(sotype)
    {
@@ -600,9 +918,9 @@ int8_t setsockopt(uint8_t sn, sockopt_type sotype, void* arg)
          setSn_CR(sn,Sn_CR_SEND_KEEP);
          while(getSn_CR(sn) != 0)
          {     
-            if (getSn_IR(sn) & Sn_IR_TIMEOUT)
+            if (sock_getir(sn) & Sn_IR_TIMEOUT)
             {
-               setSn_IRCLR(sn, Sn_IR_TIMEOUT);
+               sock_clrir(sn, Sn_IR_TIMEOUT);
                return SOCKERR_TIMEOUT;
             }
          }
@@ -619,6 +937,7 @@ int8_t setsockopt(uint8_t sn, sockopt_type sotype, void* arg)
 
 int8_t getsockopt(uint8_t sn, sockopt_type sotype, void* arg)
 {
+   SOCK_TRACE(WIZ_TRACE_GETSOCKOPT);
    CHECK_SOCKNUM();
    switch(sotype)
    {
@@ -688,10 +1007,21 @@ int8_t getsockopt(uint8_t sn, sockopt_type sotype, void* arg)
 
 int16_t peeksockmsg(uint8_t sn, uint8_t* submsg, uint16_t subsize)
 {
+   SOCK_TRACE(WIZ_TRACE_PEEK);
+   wiz_iovec pat;
+   int16_t ret;
    uint32_t rx_ptr = 0;
    uint16_t i = 0, sub_idx = 0;
 
-   if( (getSn_RX_RSR(sn) > 0) && (subsize > 0) )
+   if(subsize <= SOCK_PEEK_CHUNK)
+   {
+      pat.buf = submsg;
+      pat.len = (datasize_t)subsize;
+      ret = wiz_peek_find(sn, &pat, 1, 0);
+      return (ret < 0) ? -1 : ret;
+   }
+   /* A pattern longer than the chunk of wiz_peek_find() */
+   if(getSn_RX_RSR(sn) > 0)
    {
        rx_ptr = ((uint32_t)getSn_RX_RD(sn) << 8)  + WIZCHIP_RXBUF_BLOCK(sn);
        sub_idx = 0;
@@ -708,3 +1038,288 @@ int16_t peeksockmsg(uint8_t sn, uint8_t* submsg, uint16_t subsize)
    }
    return -1;
 }
+
+/* First position before <i>limit</i> where <i>pat</i> starts in <i>buf</i> of <i>len</i> bytes, or -1. */
+static int16_t sock_memfind(const uint8_t* buf, datasize_t limit, datasize_t len, const uint8_t* pat, datasize_t plen)
+{
+   const uint8_t* p = buf;
+   const uint8_t* end = buf + limit;
+
+   while((p < end) && (p = (const uint8_t*)memchr(p, pat[0], end - p)) != 0)
+   {
+      if((p + plen <= buf + len) && (memcmp(p + 1, pat + 1, plen - 1) == 0)) return (int16_t)(p - buf);
+      p++;
+   }
+   return -1;
+}
+
+int16_t wiz_peek_find(uint8_t sn, const wiz_iovec* pats, uint8_t count, uint8_t* which)
+{
+   SOCK_TRACE(WIZ_TRACE_PEEK);
+   uint8_t    buf[SOCK_PEEK_CHUNK * 2];
+   datasize_t rsr, pos, keep, len, n, limit, maxlen = 0;
+   datasize_t base = 0;
+   uint16_t   ptr;
+   int16_t    off, best;
+   uint8_t    i;
+
+   CHECK_SOCKNUM();
+   if((pats == 0) || (count == 0)) return SOCKERR_ARG;
+   for(i = 0; i < count; i++)
+   {
+      if((pats[i].buf == 0) || (pats[i].len <= 0) || (pats[i].len > SOCK_PEEK_CHUNK)) return SOCKERR_ARG;
+      if(pats[i].len > maxlen) maxlen = pats[i].len;
+   }
+
+   rsr = getSn_RX_RSR(sn);
+   ptr = getSn_RX_RD(sn);
+   keep = 0;
+   for(pos = 0; pos < rsr; pos += n)
+   {
+      n = rsr - pos;
+      if(n > SOCK_PEEK_CHUNK) n = SOCK_PEEK_CHUNK;
+      // The pointer wraps in 16 bits, and W6100 wraps the address in SOCKETn RX buffer.
+      WIZCHIP_READ_BUF(((uint32_t)(uint16_t)(ptr + pos) << 8) + WIZCHIP_RXBUF_BLOCK(sn), buf + keep, n);
+      len = keep + n;
+      // Starts before limit are checked with every pattern, the rest is kept for the next chunk.
+      limit = (pos + n == rsr) ? len : (len - maxlen + 1);
+      best = -1;
+      for(i = 0; i < count; i++)
+      {
+         off = sock_memfind(buf, (best < 0) ? limit : best, len, pats[i].buf, pats[i].len);
+         if(off >= 0)
+         {
+            best = off;
+            if(which) *which = i;
+         }
+      }
+      if(best >= 0) return (int16_t)(base + best);
+      keep = len - limit;
+      memmove(buf, buf + limit, keep);
+      base += limit;
+   }
+   return SOCKERR_NOTFOUND;
+}
+
+int8_t wiz_sock_snapshot(uint8_t sn, wiz_SockSnapshot* snap)
+{
+   uint8_t creg[SOCK_SNAP_CREG_LEN];
+   uint8_t breg[SOCK_SNAP_BREG_LEN];
+   CHECK_SOCKNUM();
+   WIZCHIP_READ_BUF(_Sn_MR_(sn), creg, SOCK_SNAP_CREG_LEN);
+   WIZCHIP_READ_BUF(_Sn_TX_BSR_(sn), breg, SOCK_SNAP_BREG_LEN);
+
+   snap->mr  = creg[SOCK_SNAP_CREG(_Sn_MR_)];
+   snap->cr  = creg[SOCK_SNAP_CREG(_Sn_CR_)];
+   snap->ir  = creg[SOCK_SNAP_CREG(_Sn_IR_)] | sock_ir[sn];
+   snap->imr = creg[SOCK_SNAP_CREG(_Sn_IMR_)];
+   snap->sr  = creg[SOCK_SNAP_CREG(_Sn_SR_)];
+   if(snap->sr == SOCK_CLOSED) sock_linger &= ~(1<<sn);
+   snap->esr = creg[SOCK_SNAP_CREG(_Sn_ESR_)];
+
+   snap->tx_max = (datasize_t)breg[SOCK_SNAP_BREG(_Sn_TX_BSR_)] << 10;
+   snap->tx_fsr = (datasize_t)SOCK_SNAP_BREG16(breg, _Sn_TX_FSR_);
+   snap->tx_rd  = SOCK_SNAP_BREG16(breg, _Sn_TX_RD_);
+   snap->tx_wr  = SOCK_SNAP_BREG16(breg, _Sn_TX_WR_);
+   snap->rx_max = (datasize_t)breg[SOCK_SNAP_BREG(_Sn_RX_BSR_)] << 10;
+   snap->rx_rsr = (datasize_t)SOCK_SNAP_BREG16(breg, _Sn_RX_RSR_);
+   snap->rx_rd  = SOCK_SNAP_BREG16(breg, _Sn_RX_RD_);
+   snap->rx_wr  = SOCK_SNAP_BREG16(breg, _Sn_RX_WR_);
+   return SOCK_OK;
+}
+
+int8_t wiz_event_init(uint8_t sn_mask, uint16_t intptmr)
+{
+   uint8_t sn;
+   for(sn = 0; sn < _WIZCHIP_SOCK_NUM_; sn++)
+   {
+      if(sn_mask & (1<<sn)) setSn_IMR(sn, SIK_ALL);
+   }
+   setSIMR((getSIMR() & ~sock_intr_sn) | sn_mask);
+   sock_intr_sn = sn_mask;
+   if(sn_mask)
+   {
+      setINTPTMR(intptmr);
+      setSYCR1(getSYCR1() | SYCR1_IEN);
+   }
+   return SOCK_OK;
+}
+
+int8_t reg_wiz_event_cbfunc(uint8_t sn, void (*handler)(uint8_t sn, uint8_t events))
+{
+   CHECK_SOCKNUM();
+   sock_event_cb[sn] = handler;
+   return SOCK_OK;
+}
+
+/* Collect _Sn_IR_ of SOCKETs flagged in <i>sir</i> and dispatch them. */
+static uint8_t sock_collect(uint8_t sir)
+{
+   uint8_t sn, ir;
+   uint8_t ret = 0;
+   sock_async_kick();
+   for(sn = 0; sn < _WIZCHIP_SOCK_NUM_; sn++)
+   {
+      if(!(sir & (1<<sn))) continue;
+      ir = getSn_IR(sn);
+      if(ir == 0) continue;
+      setSn_IRCLR(sn, ir);
+      sock_ir[sn] |= ir;
+      if(ir & (Sn_IR_DISCON | Sn_IR_TIMEOUT)) sock_linger &= ~(1<<sn);
+      if((ir & Sn_IR_SENDOK) && sock_send_pending[sn])
+      {
+         /* send the data appended by SOCK_SEND_STREAM as soon as the previous send is completed. */
+         sock_ir[sn] &= ~Sn_IR_SENDOK;
+         sock_send_issue(sn);
+      }
+      ret |= (1<<sn);
+      if(sock_event_cb[sn]) sock_event_cb[sn](sn, ir);
+   }
+   return ret;
+}
+
+uint8_t wiz_poll(void)
+{
+   SOCK_TRACE(WIZ_TRACE_EVENT);
+   return sock_collect(getSIR() & sock_intr_sn);
+}
+
+uint8_t wiz_wait_events(uint8_t sn_mask, uint32_t timeout)
+{
+   SOCK_TRACE(WIZ_TRACE_EVENT);
+   uint8_t sn;
+   uint8_t ret = 0;
+   for(sn = 0; sn < _WIZCHIP_SOCK_NUM_; sn++)
+      if(sock_ir[sn]) ret |= (1<<sn);
+   if((ret & sn_mask) == 0)
+   {
+      if(!WIZCHIP.INTN._wait_(timeout)) return 0;
+      wiz_poll();
+      for(sn = 0; sn < _WIZCHIP_SOCK_NUM_; sn++)
+         if(sock_ir[sn]) ret |= (1<<sn);
+   }
+   return ret & sn_mask;
+}
+
+int8_t wiz_select(uint8_t* rd_mask, uint8_t* wr_mask, uint8_t* ex_mask, uint32_t timeout)
+{
+   SOCK_TRACE(WIZ_TRACE_EVENT);
+   wiz_SockSnapshot snap;
+   uint8_t want_rd = rd_mask ? *rd_mask : 0;
+   uint8_t want_wr = wr_mask ? *wr_mask : 0;
+   uint8_t want_ex = ex_mask ? *ex_mask : 0;
+   uint8_t watch = want_rd | want_wr | want_ex;
+   uint8_t rd, wr, ex, sn, ir, sr, waited = 0;
+   int8_t  ret = 0;
+
+   while(1)
+   {
+      /* One read of _SIR_ tells which SOCKETs have new interrupts, and only their state is fetched again. */
+      sock_sel_valid &= ~sock_collect(getSIR() & (watch | sock_intr_sn));
+      rd = wr = ex = 0;
+      for(sn = 0; sn < _WIZCHIP_SOCK_NUM_; sn++)
+      {
+         if(!(watch & (1<<sn))) continue;
+         if(!(sock_sel_valid & (1<<sn)))
+         {
+            wiz_sock_snapshot(sn, &snap);
+            sock_sel_sr[sn]  = snap.sr;
+            sock_sel_rsr[sn] = snap.rx_rsr;
+            sock_sel_fsr[sn] = snap.tx_fsr;
+            sock_sel_valid |= (1<<sn);
+         }
+         ir = sock_ir[sn];
+         sr = sock_sel_sr[sn];
+         if((sock_sel_rsr[sn] > 0) || (ir & Sn_IR_CON) || (sr == SOCK_CLOSE_WAIT) || (sr == SOCK_CLOSED))
+            rd |= (1<<sn);
+         if((sock_sel_fsr[sn] > 0) && (sr != SOCK_CLOSED) && (sr != SOCK_INIT) && (sr != SOCK_LISTEN) &&
+            (sr != SOCK_SYNSENT) && (sr != SOCK_SYNRECV) && (sr != SOCK_FIN_WAIT) && (sr != SOCK_TIME_WAIT) && (sr != SOCK_LAST_ACK) &&
+            (!(sock_is_sending & (1<<sn)) || (ir & Sn_IR_SENDOK)))
+            wr |= (1<<sn);
+         if((ir & (Sn_IR_DISCON | Sn_IR_TIMEOUT)) || (sr == SOCK_CLOSED))
+            ex |= (1<<sn);
+      }
+      rd &= want_rd;
+      wr &= want_wr;
+      ex &= want_ex;
+      if((rd | wr | ex) || waited || (timeout == 0)) break;
+      if(!WIZCHIP.INTN._wait_(timeout)) break;
+      waited = 1;
+   }
+   if(rd_mask) *rd_mask = rd;
+   if(wr_mask) *wr_mask = wr;
+   if(ex_mask) *ex_mask = ex;
+   for(sn = 0; sn < _WIZCHIP_SOCK_NUM_; sn++)
+   {
+      ret += ((rd >> sn) & 1) + ((wr >> sn) & 1) + ((ex >> sn) & 1);
+   }
+   return ret;
+}
+
+/* Take SOCKETn for <i>kind</i> and count it. */
+static int8_t sock_pool_take(uint8_t sn, uint8_t kind)
+{
+   wiz_SockPoolStat* st = &sock_pool_stat[kind];
+   sock_pool_used |= (1<<sn);
+   sock_pool_owner[sn] = kind;
+   st->allocs++;
+   if(++st->in_use > st->peak) st->peak = st->in_use;
+   return (int8_t)sn;
+}
+
+int8_t wiz_sock_alloc(uint8_t kind)
+{
+   /* The lowest and the highest set bit of each nibble, 4 if none. */
+   static const uint8_t lowest[16]  = {4,0,1,0,2,0,1,0,3,0,1,0,2,0,1,0};
+   static const uint8_t highest[16] = {4,0,1,1,2,2,2,2,3,3,3,3,3,3,3,3};
+   uint8_t free, sn;
+
+   if(kind >= SOCK_OWN_NUM) return SOCKERR_ARG;
+   free = SOCK_POOL_ALL & ~sock_pool_used & ~(SOCK_OWN_IS_SERVICE(kind) ? SOCK_POOL_APP_ONLY : SOCK_POOL_SERVICE_ONLY);
+   /* A disconnecting SOCKET is closed by wiz_socket(), so take it last. */
+   if(free & ~sock_linger) free &= ~sock_linger;
+   if(free == 0)
+   {
+      sock_pool_stat[kind].fails++;
+      return SOCKERR_SOCKNUM;
+   }
+   if(SOCK_OWN_IS_SERVICE(kind))
+      sn = (free & 0xF0) ? (uint8_t)(highest[free >> 4] + 4) : highest[free & 0x0F];
+   else
+      sn = (free & 0x0F) ? lowest[free & 0x0F] : (uint8_t)(lowest[free >> 4] + 4);
+   return sock_pool_take(sn, kind);
+}
+
+int8_t wiz_sock_claim(uint8_t sn, uint8_t kind)
+{
+   if(kind >= SOCK_OWN_NUM) return SOCKERR_ARG;
+   if((sn >= _WIZCHIP_SOCK_NUM_) || ((sock_pool_used & (1<<sn)) && (sock_pool_owner[sn] != kind)))
+   {
+      sock_pool_stat[kind].fails++;
+      return SOCKERR_SOCKNUM;
+   }
+   if(sock_pool_used & (1<<sn)) return (int8_t)sn;
+   return sock_pool_take(sn, kind);
+}
+
+int8_t wiz_sock_free(uint8_t sn)
+{
+   CHECK_SOCKNUM();
+   if(!(sock_pool_used & (1<<sn))) return SOCKERR_SOCKNUM;
+   sock_pool_used &= ~(1<<sn);
+   sock_pool_stat[sock_pool_owner[sn]].in_use--;
+   return SOCK_OK;
+}
+
+uint8_t wiz_sock_owner(uint8_t sn)
+{
+   if((sn >= _WIZCHIP_SOCK_NUM_) || !(sock_pool_used & (1<<sn))) return SOCK_OWN_NONE;
+   return sock_pool_owner[sn];
+}
+
+int8_t wiz_sock_pool_stat(uint8_t kind, wiz_SockPoolStat* stat)
+{
+   if(kind >= SOCK_OWN_NUM) return SOCKERR_ARG;
+   *stat = sock_pool_stat[kind];
+   return SOCK_OK;
+}
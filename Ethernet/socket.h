@@ -103,6 +103,7 @@ extern "C" {
 #define SOCKERR_BUFFER       (SOCK_ERROR - 15)    ///< Socket buffer is not enough for data communication.
 //#define SOCKERR_IPvMISMATCH   (SOCK_ERROR - 16)    ///< Socket IP version invalid
 //#define SOCKERR_IPLENINVALID  (SOCK_ERROR - 17)    ///< Socket IP version invalid
+#define SOCKERR_NOTFOUND     (SOCK_ERROR - 18)    ///< No pattern is found by @ref wiz_peek_find()
 
 #define SOCKFATAL_PACKLEN    (SOCK_FATAL - 1)     ///< Invalid packet length. Fatal Error.
 
@@ -187,6 +188,8 @@ extern "C" {
 /////////////////////////////
 #define SOCK_IO_BLOCK         0  ///< Socket Block IO Mode in @ref setsockopt().
 #define SOCK_IO_NONBLOCK      1  ///< Socket Non-block IO Mode in @ref setsockopt().
+#define SOCK_SEND_SERIAL      0  ///< Socket Send Mode in @ref ctlsocket(). Each send waits @ref Sn_IR_SENDOK of the previous one.
+#define SOCK_SEND_STREAM      1  ///< Socket Send Mode in @ref ctlsocket(). Data is appended to TX buffer while the previous send is in progress.
 
 
 /**
@@ -430,6 +433,8 @@ typedef enum
    CS_GET_INTMASK,         ///< get the masked interrupt of SOCKET. refer to @ref sockint_kind.
    CS_SET_PREFER,          ///< set the preferred source IPv6 address of transmission packet.\n Refer to @ref SRCV6_PREFER_AUTO, @ref SRCV6_PREFER_LLA and @ref SRCV6_PREFER_GUA.
    CS_GET_PREFER,          ///< get the preferred source IPv6 address of transmission packet.\n Refer to @ref SRCV6_PREFER_AUTO, @ref SRCV6_PREFER_LLA and @ref SRCV6_PREFER_GUA.
+   CS_SET_SENDMODE,        ///< set SOCKET send mode with @ref SOCK_SEND_SERIAL or @ref SOCK_SEND_STREAM
+   CS_GET_SENDMODE,        ///< get SOCKET send mode
 }ctlsock_type;
 
 
@@ -456,6 +461,76 @@ typedef enum
    SO_PACKINFO          ///< Valid only in @ref getsockopt(). Get the packet information as @ref PACK_FIRST, @ref PACK_REMAINED, and etc.
 }sockopt_type;
 
+/**
+ * @ingroup DATA_TYPE
+ * @brief The decoded register block of SOCKETn.
+ * @details It is filled by @ref wiz_sock_snapshot() with the SOCKETn mode, command, interrupt, status\n
+ *          and the TX/RX buffer pointers read in burst.
+ * @sa wiz_sock_snapshot()
+ */
+typedef struct wiz_SockSnapshot_t
+{
+   uint8_t    mr;       ///< SOCKETn mode. Refer to @ref _Sn_MR_.
+   uint8_t    cr;       ///< SOCKETn command. It is not zero while the previous command is processed. Refer to @ref _Sn_CR_.
+   uint8_t    ir;       ///< SOCKETn interrupt. Refer to @ref _Sn_IR_.
+   uint8_t    imr;      ///< SOCKETn interrupt mask. Refer to @ref _Sn_IMR_.
+   uint8_t    sr;       ///< SOCKETn status such as @ref SOCK_ESTABLISHED. Refer to @ref _Sn_SR_.
+   uint8_t    esr;      ///< SOCKETn extended status. Refer to @ref _Sn_ESR_.
+   datasize_t tx_max;   ///< The size of SOCKETn TX buffer. Refer to @ref getSn_TxMAX().
+   datasize_t tx_fsr;   ///< The free size of SOCKETn TX buffer. Refer to @ref _Sn_TX_FSR_.
+   uint16_t   tx_rd;    ///< SOCKETn TX read pointer. Refer to @ref _Sn_TX_RD_.
+   uint16_t   tx_wr;    ///< SOCKETn TX write pointer. Refer to @ref _Sn_TX_WR_.
+   datasize_t rx_max;   ///< The size of SOCKETn RX buffer. Refer to @ref getSn_RxMAX().
+   datasize_t rx_rsr;   ///< The received size in SOCKETn RX buffer. Refer to @ref _Sn_RX_RSR_.
+   uint16_t   rx_rd;    ///< SOCKETn RX read pointer. Refer to @ref _Sn_RX_RD_.
+   uint16_t   rx_wr;    ///< SOCKETn RX write pointer. Refer to @ref _Sn_RX_WR_.
+}wiz_SockSnapshot;
+
+/**
+ * @ingroup DATA_TYPE
+ * @brief The owner of SOCKETn in the SOCKET pool.
+ * @details The owners before @ref SOCK_OWN_TCP_CLIENT are the service class, and the others are the application class.\n
+ *          The service class takes SOCKETs from the highest number, and the application class from the lowest.
+ * @sa wiz_sock_alloc()
+ */
+typedef enum
+{
+   SOCK_OWN_DHCPV4 = 0,    ///< DHCPv4 client. Service class.
+   SOCK_OWN_DHCPV6,        ///< DHCPv6 client. Service class.
+   SOCK_OWN_DNS,           ///< DNS client. Service class.
+   SOCK_OWN_SERVICE,       ///< Other network services. Service class.
+   SOCK_OWN_TCP_CLIENT,    ///< TCP client of the application. Application class.
+   SOCK_OWN_TCP_SERVER,    ///< TCP server of the application. Application class.
+   SOCK_OWN_APP,           ///< Other SOCKETs of the application. Application class.
+   SOCK_OWN_NUM
+}sockown_kind;
+
+#define SOCK_OWN_NONE        0xFF     ///< SOCKETn is not owned. Returned by @ref wiz_sock_owner().
+#define SOCK_OWN_IS_SERVICE(kind)   ((kind) < SOCK_OWN_TCP_CLIENT)   ///< The <i>kind</i> is the service class.
+
+/**
+ * @ingroup DATA_TYPE
+ * @brief Statistics of an owner of the SOCKET pool.
+ * @sa wiz_sock_pool_stat()
+ */
+typedef struct wiz_SockPoolStat_t
+{
+   uint8_t  in_use;     ///< SOCKETs owned now.
+   uint8_t  peak;       ///< The max of in_use.
+   uint16_t allocs;     ///< Successful @ref wiz_sock_alloc() and @ref wiz_sock_claim().
+   uint16_t fails;      ///< Failed @ref wiz_sock_alloc() and @ref wiz_sock_claim().
+}wiz_SockPoolStat;
+
+/**
+ * @ingroup DATA_TYPE
+ * @brief A segment of data for @ref wiz_sendv() and @ref wiz_recvv().
+ */
+typedef struct wiz_iovec
+{
+   uint8_t*   buf;      ///< Pointer of the segment
+   datasize_t len;      ///< The byte length of the segment
+}wiz_iovec;
+
 /**
  * @ingroup WIZnet_socket_APIs
  * @brief Control SOCKETn.
@@ -475,6 +550,8 @@ typedef enum
  *                  <td> @ref sockint_kind </td> <td> @ref SIK_CONNECTED, etc.  </td> </tr> 
  *             <tr> <td> @ref CS_SET_PREFER \n @ref CS_GET_PREFER       </td> <td> uint8_t </td>
  *                  <td> @ref SRCV6_PREFER_AUTO, @ref SRCV6_PREFER_LLA, @ref SRCV6_PREFER_GUA  </td>< /tr>
+ *             <tr> <td> @ref CS_SET_SENDMODE \n @ref CS_GET_SENDMODE </td> <td> uint8_t       </td>
+ *                  <td>@ref SOCK_SEND_SERIAL, @ref SOCK_SEND_STREAM </td> </tr>
  *          </table>
  * @return Success @ref SOCK_OK \n
  *         Fail   : \n
@@ -559,10 +636,254 @@ int8_t getsockopt(uint8_t sn, sockopt_type sotype, void* arg);
  *   - Fail : -1
  * @note
  *   It is just return the length of incoming message before the found sub-message. It does not receive the message.\n
- *   So, after calling peeksockmsg, @ref _Sn_RX_RD_ is not changed.
+ *   So, after calling peeksockmsg, @ref _Sn_RX_RD_ is not changed.\n
+ *   <i>submsg</i> up to SOCK_PEEK_CHUNK bytes is found by @ref wiz_peek_find(), and a longer one is compared byte by byte.
  */
 int16_t peeksockmsg(uint8_t sn, uint8_t* submsg, uint16_t subsize);
 
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Finds the first of several patterns in SOCKETn RX buffer.
+ * @details It reads the received data with burst reads of SOCK_PEEK_CHUNK bytes into a local buffer\n
+ *          and searches all patterns in it, so framing such as "\r\n" or "\r\n\r\n" costs a few SPI transactions\n
+ *          instead of one per byte. A pattern over the end of a chunk is found in the next one.\n
+ *          @ref _Sn_RX_RSR_ and @ref _Sn_RX_RD_ are read once, and the data is not received.
+ * @param sn SOCKET number. It should be <b>0 ~ @ref _WIZCHIP_SOCK_NUM_</b>.
+ * @param pats Array of @ref wiz_iovec of the patterns. Each length should be <b>1 ~ SOCK_PEEK_CHUNK</b>.
+ * @param count The number of patterns in <i>pats</i>.
+ * @param which The index of the found pattern in <i>pats</i> is returned. It can be NULL.\n
+ *              When several patterns start at the same position, it is the first one in <i>pats</i>.
+ * @return
+ *   - Success : the length of incoming message before the first found pattern\n
+ *   - Fail :
+ *     - @ref SOCKERR_NOTFOUND - No pattern is found\n
+ *     - @ref SOCKERR_SOCKNUM  - Invalid SOCKET number\n
+ *     - @ref SOCKERR_ARG      - Invalid pattern
+ * @note SOCK_PEEK_CHUNK is 128 when not defined, and the local buffer uses its twice of stack.
+ */
+int16_t wiz_peek_find(uint8_t sn, const wiz_iovec* pats, uint8_t count, uint8_t* which);
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Send data gathered from several buffers to the connected peer.
+ * @details It is same as @ref wiz_send() except that the data is the segments of <i>iov</i> in order.\n
+ *          Each segment is written to SOCKETn TX buffer directly, and @ref _Sn_TX_WR_ and @ref Sn_CR_SEND are issued once.
+ * @param sn SOCKET number. It should be <b>0 ~ @ref _WIZCHIP_SOCK_NUM_</b>.
+ * @param iov Array of @ref wiz_iovec to be sent.
+ * @param count The number of segments in <i>iov</i>.
+ * @return Same as @ref wiz_send(). The real sent data size is the sum of the sent segments.
+ * @note The segments over SOCKET TX buffer size are not sent.
+ */
+datasize_t wiz_sendv(uint8_t sn, const wiz_iovec* iov, uint8_t count);
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Send the data kept in SOCKETn TX buffer by @ref SOCK_SEND_STREAM.
+ * @details In @ref SOCK_SEND_STREAM mode, @ref wiz_send() and @ref wiz_sendv() only append data to SOCKETn TX buffer \n
+ *          while the previous @ref Sn_CR_SEND is in progress, and the appended data is sent by the next one of them.\n
+ *          It waits @ref Sn_IR_SENDOK of the previous send and issues @ref Sn_CR_SEND for the appended data.
+ * @param sn SOCKET number. It should be <b>0 ~ @ref _WIZCHIP_SOCK_NUM_</b>.
+ * @return Success : @ref SOCK_OK \n
+ *         Fail    : \n @ref SOCKERR_SOCKSTATUS - Invalid SOCKET status for SOCKET operation \n
+ *                          @ref SOCKERR_SOCKNUM    - Invalid SOCKET number \n
+ *                          @ref SOCK_BUSY          - The previous send is not completed in non-block io mode.
+ * @note @ref wiz_poll() also issues it when @ref Sn_IR_SENDOK of SOCKETn is collected.
+ */
+int8_t wiz_send_flush(uint8_t sn);
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Receive data scattering into several buffers from the connected peer.
+ * @details It is same as @ref wiz_recv() except that the received data is filled into the segments of <i>iov</i> in order.\n
+ *          Each segment is read from SOCKETn RX buffer directly, and @ref _Sn_RX_RD_ and @ref Sn_CR_RECV are issued once.
+ * @param sn SOCKET number. It should be <b>0 ~ @ref _WIZCHIP_SOCK_NUM_</b>.
+ * @param iov Array of @ref wiz_iovec to be filled.
+ * @param count The number of segments in <i>iov</i>.
+ * @return Same as @ref wiz_recv(). The real received data size is the sum of the filled segments.
+ */
+datasize_t wiz_recvv(uint8_t sn, const wiz_iovec* iov, uint8_t count);
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Send data to the connected peer without waiting its transfer to SOCKETn TX buffer.
+ * @details It starts @ref wiz_send_data_async() and returns immediately. <i>buf</i> should be kept until <i>done</i> is called.\n
+ *          @ref Sn_CR_SEND is issued by @ref wiz_poll() after the transfer, or by @ref wiz_send_flush().
+ * @param sn SOCKET number. It should be <b>0 ~ @ref _WIZCHIP_SOCK_NUM_</b>.
+ * @param buf Pointer buffer containing data to be sent.
+ * @param len The byte length of data in buf.
+ * @param done Callback called with <i>sn</i> and the started length when the transfer is completed. It can be NULL.
+ * @return Success : The started data size, clamped to the free size of SOCKETn TX buffer \n
+ *         Fail    : \n @ref SOCKERR_SOCKSTATUS - Invalid SOCKET status for SOCKET operation \n
+ *                          @ref SOCKERR_SOCKMODE   - Invalid operation in the SOCKET \n
+ *                          @ref SOCKERR_SOCKNUM    - Invalid SOCKET number \n
+ *                          @ref SOCKERR_DATALEN    - zero data length \n
+ *                          @ref SOCK_BUSY          - Another transfer is in progress, or SOCKETn TX buffer is full.
+ * @note Only one transfer of @ref wiz_send_async() or @ref wiz_recv_async() is in progress at a time.
+ *       <i>done</i> is called in the context of @ref wizchip_xfer_done() and should not access <i>_WIZCHIP_</i>.
+ */
+datasize_t wiz_send_async(uint8_t sn, uint8_t * buf, datasize_t len, void (*done)(uint8_t sn, datasize_t len));
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Receive data from the connected peer without waiting its transfer from SOCKETn RX buffer.
+ * @details It starts @ref wiz_recv_data_async() for the received data and returns immediately. <i>buf</i> is filled when <i>done</i> is called.\n
+ *          @ref Sn_CR_RECV is issued by @ref wiz_poll() after the transfer, or by the next receive of SOCKETn.
+ * @param sn SOCKET number. It should be <b>0 ~ @ref _WIZCHIP_SOCK_NUM_</b>.
+ * @param buf Pointer buffer to read incoming data.
+ * @param len The max data length of data in buf.
+ * @param done Same as @ref wiz_send_async().
+ * @return Success : The started data size, clamped to the received size of SOCKETn RX buffer \n
+ *         Fail    : Same as @ref wiz_send_async(). @ref SOCK_BUSY is also returned when SOCKETn RX buffer is empty.
+ * @note Same as @ref wiz_send_async().
+ */
+datasize_t wiz_recv_async(uint8_t sn, uint8_t * buf, datasize_t len, void (*done)(uint8_t sn, datasize_t len));
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Get the register block of SOCKETn at once.
+ * @details It reads the SOCKETn control registers from @ref _Sn_MR_ to @ref _Sn_ESR_ \n
+ *          and the buffer registers from @ref _Sn_TX_BSR_ to @ref _Sn_RX_WR_ with two burst reads, \n
+ *          and decodes them into <i>snap</i>.
+ * @param sn SOCKET number. It should be <b>0 ~ @ref _WIZCHIP_SOCK_NUM_</b>.
+ * @param snap Pointer of @ref wiz_SockSnapshot to be filled.
+ * @return Success : @ref SOCK_OK \n
+ *         Fail    : @ref SOCKERR_SOCKNUM - Invalid SOCKET number
+ * @note @ref _Sn_TX_FSR_ and @ref _Sn_RX_RSR_ are sampled once without the re-read of @ref getSn_TX_FSR() and @ref getSn_RX_RSR(). \n
+ *       The upper byte is read first in the same burst, so a value updated in the middle of the read can be only smaller than the real one.
+ */
+int8_t wiz_sock_snapshot(uint8_t sn, wiz_SockSnapshot* snap);
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Starts the interrupt driven event engine on SOCKETs.
+ * @details It enables all SOCKET interrupts(@ref SIK_ALL) in @ref _Sn_IMR_ of SOCKETs in <i>sn_mask</i>, \n
+ *          sets them in @ref _SIMR_, sets @ref _INTPTMR_ to <i>intptmr</i> and sets @ref SYCR1_IEN.\n
+ *          After that, @ref wiz_poll() collects their interrupts, and the blocking SOCKET APIs on them \n
+ *          sleep on INTn by the callback of @ref reg_wizchip_intn_cbfunc() instead of polling their registers.
+ * @param sn_mask SOCKETs to be handled. Bit n is SOCKETn. 0 stops the engine.
+ * @param intptmr interrupt pending time. Refer to @ref _INTPTMR_.
+ * @return @ref SOCK_OK
+ * @note @ref _Sn_IR_ of those SOCKETs is cleared by @ref wiz_poll() and kept by SOCKET APIs.\n
+ *       So get and clear it with @ref CS_GET_INTERRUPT and @ref CS_CLR_INTERRUPT of @ref ctlsocket() instead of @ref getSn_IR() and @ref setSn_IRCLR().
+ */
+int8_t wiz_event_init(uint8_t sn_mask, uint16_t intptmr);
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Registers the event handler of SOCKETn.
+ * @details <i>handler</i> is called by @ref wiz_poll() with the interrupts of SOCKETn newly occurred.
+ * @param sn SOCKET number. It should be <b>0 ~ @ref _WIZCHIP_SOCK_NUM_</b>.
+ * @param handler event handler. <i>events</i> is OR of @ref sockint_kind. NULL removes the handler.
+ * @return Success : @ref SOCK_OK \n
+ *         Fail    : @ref SOCKERR_SOCKNUM - Invalid SOCKET number
+ */
+int8_t reg_wiz_event_cbfunc(uint8_t sn, void (*handler)(uint8_t sn, uint8_t events));
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Collects and dispatches SOCKET events.
+ * @details It reads @ref _SIR_, and for each SOCKET of @ref wiz_event_init() flagged in it, \n
+ *          it reads and clears @ref _Sn_IR_, keeps the interrupts for SOCKET APIs and calls the handler of @ref reg_wiz_event_cbfunc().
+ * @return SOCKETs which had new events. Bit n is SOCKETn.
+ * @note @ref _IR_ and @ref _SLIR_ are not handled. Their owners should clear them.
+ */
+uint8_t wiz_poll(void);
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Waits SOCKET events.
+ * @details If none of SOCKETs in <i>sn_mask</i> has the pending interrupt, \n
+ *          it waits INTn up to <i>timeout</i> ms and calls @ref wiz_poll().
+ * @param sn_mask SOCKETs to wait. Bit n is SOCKETn.
+ * @param timeout time to wait INTn in ms.
+ * @return SOCKETs in <i>sn_mask</i> which have the pending interrupt. Bit n is SOCKETn.\n
+ *         0 if timeout or INTn was asserted only by other SOCKETs.
+ * @note The pending interrupt is kept until cleared by @ref CS_CLR_INTERRUPT of @ref ctlsocket(). \n
+ *       @ref SIK_RECEIVED is cleared also by @ref wiz_recv() and @ref wiz_recvfrom().
+ */
+uint8_t wiz_wait_events(uint8_t sn_mask, uint32_t timeout);
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Waits SOCKETs to be ready for receive, send or exception.
+ * @details It reads @ref _SIR_ once, and only SOCKETs flagged in it or changed by the SOCKET APIs after the last call \n
+ *          get their state with @ref wiz_sock_snapshot(). The state of the other SOCKETs is kept from the last call, \n
+ *          so an idle loop over 8 SOCKETs costs one register read. @ref _Sn_IR_ of the flagged SOCKETs is collected \n
+ *          as @ref wiz_poll() does.\n
+ *          If no SOCKET is ready, it waits INTn up to <i>timeout</i> ms and checks them once again.
+ *          - receive : @ref _Sn_RX_RSR_ is not 0, @ref Sn_IR_CON is pending, or the SOCKET is @ref SOCK_CLOSE_WAIT or @ref SOCK_CLOSED.
+ *          - send : @ref _Sn_TX_FSR_ is not 0 in a data state such as @ref SOCK_ESTABLISHED or @ref SOCK_UDP, \n
+ *                   and the previous @ref Sn_CR_SEND is completed.
+ *          - exception : @ref Sn_IR_DISCON or @ref Sn_IR_TIMEOUT is pending, or the SOCKET is @ref SOCK_CLOSED.
+ * @param rd_mask SOCKETs to check for receive, and the ready ones are returned. Bit n is SOCKETn. It can be NULL.
+ * @param wr_mask SOCKETs to check for send, and the ready ones are returned. It can be NULL.
+ * @param ex_mask SOCKETs to check for exception, and the ready ones are returned. It can be NULL.
+ * @param timeout time to wait INTn in ms. 0 returns at once.
+ * @return The number of ready bits in the masks. 0 if timeout.
+ * @note @ref _SIR_ flags only the interrupts enabled in @ref _Sn_IMR_, so keep @ref SIK_ALL in it.\n
+ *       Pending @ref Sn_IR_CON, @ref Sn_IR_DISCON and @ref Sn_IR_TIMEOUT are kept until cleared by @ref CS_CLR_INTERRUPT of @ref ctlsocket().\n
+ *       To sleep on INTn, the SOCKETs should be started by @ref wiz_event_init().
+ */
+int8_t wiz_select(uint8_t* rd_mask, uint8_t* wr_mask, uint8_t* ex_mask, uint32_t timeout);
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Takes a free SOCKET from the SOCKET pool.
+ * @details The pool keeps the owner of each SOCKET on the host, so it takes a SOCKET without any register access.\n
+ *          The service class takes the highest free SOCKET, and the application class takes the lowest one. \n
+ *          A SOCKET left by @ref wiz_disconnect() in non-block io mode is taken only when no other SOCKET is free, \n
+ *          because @ref wiz_socket() closes it at once.
+ * @param kind The owner such as @ref SOCK_OWN_DNS. Refer to @ref sockown_kind.
+ * @return Success : SOCKET number \n
+ *         Fail    : @ref SOCKERR_SOCKNUM - No free SOCKET for <i>kind</i> \n
+ *                   @ref SOCKERR_ARG     - Invalid <i>kind</i>
+ * @note SOCK_POOL_SERVICE_RESERVED of the highest SOCKETs are taken only by the service class, \n
+ *       and SOCK_POOL_APP_RESERVED of the lowest SOCKETs only by the application class. Both are 0 when not defined.\n
+ *       The SOCKET is not opened. Open it with @ref wiz_socket().
+ */
+int8_t wiz_sock_alloc(uint8_t kind);
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Takes SOCKETn from the SOCKET pool, for the owners that use a fixed SOCKET number.
+ * @param sn SOCKET number. It should be <b>0 ~ @ref _WIZCHIP_SOCK_NUM_</b>.
+ * @param kind The owner. Refer to @ref sockown_kind.
+ * @return Success : <i>sn</i> \n
+ *         Fail    : @ref SOCKERR_SOCKNUM - Invalid SOCKET number, or SOCKETn is owned by another one \n
+ *                   @ref SOCKERR_ARG     - Invalid <i>kind</i>
+ * @note SOCK_POOL_SERVICE_RESERVED and SOCK_POOL_APP_RESERVED are not applied.
+ */
+int8_t wiz_sock_claim(uint8_t sn, uint8_t kind);
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Gives SOCKETn back to the SOCKET pool.
+ * @details SOCKETn is not closed. Close it with @ref wiz_close() before, or disconnect it with @ref wiz_disconnect() \n
+ *          in non-block io mode, and the pool keeps it for the last while it is closing.
+ * @param sn SOCKET number. It should be <b>0 ~ @ref _WIZCHIP_SOCK_NUM_</b>.
+ * @return Success : @ref SOCK_OK \n
+ *         Fail    : @ref SOCKERR_SOCKNUM - Invalid SOCKET number, or SOCKETn is not owned
+ */
+int8_t wiz_sock_free(uint8_t sn);
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Gets the owner of SOCKETn in the SOCKET pool.
+ * @param sn SOCKET number. It should be <b>0 ~ @ref _WIZCHIP_SOCK_NUM_</b>.
+ * @return The owner of @ref sockown_kind, or @ref SOCK_OWN_NONE.
+ */
+uint8_t wiz_sock_owner(uint8_t sn);
+
+/**
+ * @ingroup WIZnet_socket_APIs
+ * @brief Gets the statistics of an owner of the SOCKET pool.
+ * @param kind The owner. Refer to @ref sockown_kind.
+ * @param stat Pointer of @ref wiz_SockPoolStat to be filled.
+ * @return Success : @ref SOCK_OK \n
+ *         Fail    : @ref SOCKERR_ARG - Invalid <i>kind</i>
+ */
+int8_t wiz_sock_pool_stat(uint8_t kind, wiz_SockPoolStat* stat);
+
 #if __cplusplus
  }
 #endif
@@ -207,6 +207,48 @@ void wizchip_spi_write_buf(uint8_t* buf, datasize_t len)
 /// @endcond
 
 
+/* INTn simulated with the interrupt registers */
+static uint8_t wizchip_intn_asserted(void)
+{
+   uint8_t ir[3];
+   WIZCHIP_READ_BUF(_IR_, ir, 3);   // _IR_, _SIR_, _SLIR_
+   if((ir[0] | ir[1] | ir[2]) == 0) return 0;
+   if(!(getSYCR1() & SYCR1_IEN))    return 0;
+   if((ir[0] & getIMR()) | (ir[1] & getSIMR()) | (ir[2] & getSLIMR())) return 1;
+   return 0;
+}
+
+/**
+ * @brief Default function to wait INTn of @ref _WIZCHIP_.
+ * @details @ref wizchip_intn_wait() simulates the INTn pin with the interrupt registers of @ref _WIZCHIP_.\n
+ *          INTn is asserted when @ref SYCR1_IEN is set and any of @ref _IR_, @ref _SIR_ and @ref _SLIR_ is pending in its mask.\n
+ *          It polls them until INTn is asserted or <i>timeout</i> ms pass, counted by @ref _TCNTR_ of 100us.
+ * @param timeout time to wait in ms. 0 checks INTn once.
+ * @return 1 : INTn asserted, 0 : timeout.
+ * @note The wait is a busy loop of SPI reads, about 4 transfers per turn. \n
+ *       Register a function sleeping on the INTn pin by calling @ref reg_wizchip_intn_cbfunc() to free the host and the bus.
+ */
+uint8_t wizchip_intn_wait(uint32_t timeout)
+{
+   uint32_t waited = 0;   // ms
+   uint32_t ticks  = 0;   // 100us not counted in waited yet
+   uint16_t last, now;
+
+   if(wizchip_intn_asserted()) return 1;
+   if(timeout == 0) return 0;
+   last = getTCNTR();
+   while(waited < timeout)
+   {
+      if(wizchip_intn_asserted()) return 1;
+      now = getTCNTR();
+      ticks += (uint16_t)(now - last);
+      last = now;
+      waited += ticks / 10;
+      ticks  %= 10;
+   }
+   return 0;
+}
+
 /**
  * @brief @ref _WIZCHIP_T_ instance
  * @details It provides the call-back function set for accessing to @ref _WIZCHIP_
@@ -223,6 +265,9 @@ _WIZCHIP_T_  WIZCHIP =
       wizchip_cs_select,
       wizchip_cs_deselect
    },
+   {
+      wizchip_intn_wait
+   },
 #if (_WIZCHIP_IO_MODE_ & _WIZCHIP_IO_MODE_BUS_)   
    {
       .BUS =
@@ -269,6 +314,12 @@ void reg_wizchip_cs_cbfunc(void(*cs_sel)(void), void(*cs_desel)(void))
    else           WIZCHIP.CS._d_e_s_e_l_e_c_t_ = cs_desel;
 }
 
+void reg_wizchip_intn_cbfunc(uint8_t (*intn_wait)(uint32_t timeout))
+{
+   if(!intn_wait) WIZCHIP.INTN._wait_ = wizchip_intn_wait;
+   else           WIZCHIP.INTN._wait_ = intn_wait;
+}
+
 #if (_WIZCHIP_IO_MODE_ & _WIZCHIP_IO_MODE_BUS_)
 void reg_wizchip_bus_cbfunc( iodata_t(*bus_rd)(uint32_t addr), 
                              void (*bus_wd)(uint32_t addr, iodata_t wb),
@@ -311,6 +362,12 @@ void reg_wizchip_spi_cbfunc( uint8_t (*spi_rb)(void),
 
    WIZCHIP.IF.SPI._vdm_xfer = vdm_xfer;
 }
+
+void reg_wizchip_spi_async_cbfunc(void (*vdm_xfer_async) (uint8_t* addr, datasize_t alen, uint8_t* data, datasize_t dlen))
+{
+   while(!(WIZCHIP.if_mode & _WIZCHIP_IO_MODE_SPI_));
+   WIZCHIP.IF.SPI._vdm_xfer_async = vdm_xfer_async;
+}
 #endif
 
 int8_t ctlwizchip(ctlwizchip_type cwtype, void* arg)
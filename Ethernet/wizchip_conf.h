@@ -111,6 +111,30 @@ extern "C" {
  */
 #define _PHY_IO_MODE_                  _PHY_IO_MODE_PHYCR_ //_PHY_IO_MODE_MII_
 
+/**
+ * @brief Count the bus transactions to @ref _WIZCHIP_.
+ * @details When @ref _WIZCHIP_IO_COUNT_ is 1, the basic I/O functions count every transaction\n
+ *          and the count can be read with wizchip_getiocount(). 
+ * @note It is 0 as default, and then the counter is not compiled.
+ * @sa wizchip_getiocount(), wizchip_clriocount()
+ */
+#ifndef _WIZCHIP_IO_COUNT_
+#define _WIZCHIP_IO_COUNT_             0
+#endif
+
+/**
+ * @brief Trace the bus transactions to @ref _WIZCHIP_.
+ * @details When @ref _WIZCHIP_IO_TRACE_ is 1, the basic I/O functions account every transaction\n
+ *          with its address/control bytes, data bytes and time by register block and by the calling SOCKET API.\n
+ *          The statistics can be read with wizchip_trace_get() and printed with wizchip_trace_dump().
+ * @note It is 0 as default, and then the tracer is not compiled.\n
+ *       The calling SOCKET API is tracked with the cleanup attribute of GCC or Clang.
+ * @sa wizchip_trace_get(), wizchip_trace_clear(), wizchip_trace_dump(), reg_wizchip_trace_cbfunc()
+ */
+#ifndef _WIZCHIP_IO_TRACE_
+#define _WIZCHIP_IO_TRACE_             0
+#endif
+
 
 #if (_WIZCHIP_ == W6100)
    #define _WIZCHIP_ID_                "W6100\0"
@@ -168,7 +192,7 @@ extern "C" {
  *          in order to your HOST dependent functions can access to @ref _WIZCHIP_.
  * @note If it is not registered, the default function is called.
  * @sa WIZCHIP_READ(), WIZCHIP_WRITE(), WIZCHIP_READ_BUF(), WIZCHIP_WRITE_BUF()
- * @sa reg_wizchip_cris_cbfunc(), reg_wizchip_cs_cbfunc(), reg_wizchip_bus_cbfunc(), reg_wizchip_spi_cbfunc()
+ * @sa reg_wizchip_cris_cbfunc(), reg_wizchip_cs_cbfunc(), reg_wizchip_bus_cbfunc(), reg_wizchip_spi_cbfunc(), reg_wizchip_intn_cbfunc()
  */
 typedef struct __WIZCHIP_T__
 {
@@ -190,6 +214,12 @@ typedef struct __WIZCHIP_T__
       void (*_d_e_s_e_l_e_c_t_)(void);    ///< @ref _WIZCHIP_ deselected
    }CS;  
 
+   ///< The INTn pin callback function.
+   struct _INTN
+   {
+      uint8_t (*_wait_) (uint32_t timeout); ///< wait INTn asserted up to <i>timeout</i> ms. 1 : asserted, 0 : timeout
+   }INTN;
+
    ///< The set of interface IO callback function.
    union _IF
    {
@@ -211,6 +241,7 @@ typedef struct __WIZCHIP_T__
          void      (*_write_byte_buf) (uint8_t* pBuf, datasize_t len);  ///< Write byte data as many as <i>len</i> to @ref _WIZCHIP_ through SPI
 
          void      (*_vdm_xfer) (uint8_t* addr, datasize_t alen, uint8_t* data, datasize_t dlen); ///< Write with read and auto cs function.
+         void      (*_vdm_xfer_async) (uint8_t* addr, datasize_t alen, uint8_t* data, datasize_t dlen); ///< Start @ref _vdm_xfer and return. Call @ref wizchip_xfer_done() when completed.
       }SPI;
    }IF;    
 
@@ -590,6 +621,18 @@ void reg_wizchip_cris_cbfunc(void(*cris_en)(void), void(*cris_ex)(void));
  */
 void reg_wizchip_cs_cbfunc(void(*cs_sel)(void), void(*cs_desel)(void));
 
+/**
+ * @brief Registers call back function to wait the INTn pin.
+ * @details @ref reg_wizchip_intn_cbfunc() registers your function which sleeps until INTn of @ref _WIZCHIP_ is asserted, \n
+ *          such as waiting a semaphore given by the external interrupt handler of INTn.\n
+ *          It is used by @ref wiz_poll(), @ref wiz_wait_events() and the blocking SOCKET APIs on the SOCKETs of @ref wiz_event_init().
+ * @param intn_wait : callback function to wait INTn asserted up to <i>timeout</i> ms. It returns 1 if asserted, 0 if timeout.
+ * @todo Register your function if INTn is wired to HOST.
+ * @note If you do not register it, the default function @ref wizchip_intn_wait() is called.\n
+ *       It simulates INTn with the interrupt registers of @ref _WIZCHIP_ and polls them up to <i>timeout</i> ms by SPI.
+ */
+void reg_wizchip_intn_cbfunc(uint8_t (*intn_wait)(uint32_t timeout));
+
 /// @cond DOXY_APPLY_CODE
 #if (_WIZCHIP_IO_MODE_ & _WIZCHIP_IO_MODE_BUS_)
 /// @endcond
@@ -634,6 +677,17 @@ void reg_wizchip_spi_cbfunc(uint8_t (*spi_rb)(void),
                             void (*spi_rbuf)(uint8_t* buf, datasize_t len),
                             void (*spi_wbuf)(uint8_t* buf, datasize_t len),
 							void (*vdm_xfer) (uint8_t* addr, datasize_t alen, uint8_t* data, datasize_t dlen));
+
+/**
+ * @brief Registers call back function for asynchronous transfer through SPI interface.
+ * @details @ref reg_wizchip_spi_async_cbfunc() is for @ref wiz_send_data_async() and @ref wiz_recv_data_async().\n
+ *          <i>vdm_xfer_async</i> selects @ref _WIZCHIP_, starts to write <i>addr</i> and write or read <i>data</i> as @ref _vdm_xfer does, \n
+ *          and returns without waiting it completed. <i>addr</i> and <i>data</i> are kept until completed.\n
+ *          When the transfer is completed, deselect @ref _WIZCHIP_ and call @ref wizchip_xfer_done().
+ * @param vdm_xfer_async : callback function to start the transfer, such as SPI DMA. NULL for synchronous transfer.
+ * @note The direction is the bit of @ref _W6100_SPI_WRITE_ in <i>addr</i>[2].
+ */
+void reg_wizchip_spi_async_cbfunc(void (*vdm_xfer_async) (uint8_t* addr, datasize_t alen, uint8_t* data, datasize_t dlen));
 /// @cond DOXY_APPLY_CODE
 #endif
 /// @endcond
@@ -52,6 +52,7 @@
 
 #include "socket.h"
 #include "dhcpv4.h"
+#include <string.h>
 
 /* If you want to display debug & processing message, Define _DHCPV4_DEBUG_ in dhcp.h */
 
@@ -67,6 +68,9 @@
 #define STATE_DHCPV4_REREQUEST     4        ///< send REQUEST for maintaining leased IP
 #define STATE_DHCPV4_RELEASE       5        ///< No use
 #define STATE_DHCPV4_STOP          6        ///< Stop processing DHCP
+#define STATE_DHCPV4_REBIND        7        ///< broadcast REQUEST for maintaining leased IP after T2
+#define STATE_DHCPV4_INIT_REBOOT   8        ///< Initialize with the lease restored
+#define STATE_DHCPV4_REBOOTING     9        ///< broadcast REQUEST for the restored IP and wait ACK or NACK
 
 #define DHCPV4_FLAGSBROADCAST      0x8000   ///< The broadcast value of flags in @ref RIP_MSG
 #define DHCPV4_FLAGSUNICAST        0x0000   ///< The unicast   value of flags in @ref RIP_MSG
@@ -212,6 +216,19 @@ uint32_t dhcpv4_tick_next    			= DHCPV4_WAIT_TIME ;
 
 uint32_t DHCPV4_XID;      // Any number
 
+/* Deadlines of DHCPv4_poll(), absolute time of dhcpv4_now */
+static uint32_t dhcpv4_now          = 0;   // 1s tick, never reset
+static uint8_t  dhcpv4_timer_on     = 0;   // dhcpv4_deadline is valid
+static uint32_t dhcpv4_deadline     = 0;   // next retransmission, T1, T2 or lease expiry
+static uint32_t dhcpv4_rto          = DHCPV4_INIT_RTO;
+static uint32_t dhcpv4_req_sent     = 0;   // last REQUEST sent, the lease of its ACK starts from it
+static uint32_t dhcpv4_t1           = 0;   // renewal time from the server, 0 if not given
+static uint32_t dhcpv4_t2           = 0;   // rebinding time from the server, 0 if not given
+static uint32_t dhcpv4_t2_at        = 0;
+static uint32_t dhcpv4_expire_at    = 0;
+static uint32_t dhcpv4_seed         = 1;   // jitter of the retransmission
+static uint16_t dhcpv4_msg_peak     = 0;   // largest message in the buffer, up to its end option
+
 RIP_MSG* pDHCPv4MSG;      // Buffer pointer for DHCP processing
 
 uint8_t HOST_NAMEv4[] = DCHPV4_HOST_NAME;
@@ -222,14 +239,20 @@ uint8_t DHCPv4_CHADDR[6]; // DHCP Client MAC address.
 void default_ipv4_assign(void);
 void default_ipv4_update(void);
 void default_ipv4_conflict(void);
+void default_ipv4_expire(void);
 
 /* Callback handler */
 void (*dhcp_ipv4_assign)(void)   = default_ipv4_assign;     /* handler to be called when the IP address from DHCP server is first assigned */
 void (*dhcp_ipv4_update)(void)   = default_ipv4_update;     /* handler to be called when the IP address from DHCP server is updated */
 void (*dhcp_ipv4_conflict)(void) = default_ipv4_conflict;   /* handler to be called when the IP address from DHCP server is conflict */
+void (*dhcp_ipv4_expire)(void)   = default_ipv4_expire;     /* handler to be called when the lease of DHCPv4_poll() expires */
 
 void reg_dhcpv4_cbfunc(void(*ip_assign)(void), void(*ip_update)(void), void(*ip_conflict)(void));
 
+/* Lease persistence handler, none by default */
+void    (*dhcp_ipv4_lease_save)(const wiz_DHCPv4Lease* lease) = 0;
+uint8_t (*dhcp_ipv4_lease_load)(wiz_DHCPv4Lease* lease)       = 0;
+
 char NibbleToHex(uint8_t nibble);
 
 /* send DISCOVER message to DHCP server */
@@ -280,6 +303,13 @@ void default_ipv4_conflict(void)
 	setSHAR(DHCPv4_CHADDR);
 }
 
+/* The default handler of lease expired, takes the address off without reset */
+void default_ipv4_expire(void)
+{
+   uint8_t zero[4] = {0, };
+   setSIPR(zero);
+}
+
 /* register the call back func. */
 void reg_dhcpv4_cbfunc(void(*ip_assign)(void), void(*ip_update)(void), void(*ip_conflict)(void))
 {
@@ -291,6 +321,59 @@ void reg_dhcpv4_cbfunc(void(*ip_assign)(void), void(*ip_update)(void), void(*ip_
    if(ip_conflict) dhcp_ipv4_conflict = ip_conflict;
 }
 
+/* register the lease expiry func. */
+void reg_dhcpv4_expire_cbfunc(void(*ip_expire)(void))
+{
+   dhcp_ipv4_expire = ip_expire ? ip_expire : default_ipv4_expire;
+}
+
+/* register the lease persistence func. */
+void reg_dhcpv4_lease_cbfunc(void (*lease_save)(const wiz_DHCPv4Lease* lease), uint8_t (*lease_load)(wiz_DHCPv4Lease* lease))
+{
+   dhcp_ipv4_lease_save = lease_save;
+   dhcp_ipv4_lease_load = lease_load;
+}
+
+/* pass the lease acknowledged to the save handler */
+static void save_DHCPv4_lease(void)
+{
+   wiz_DHCPv4Lease lease;
+   uint8_t i;
+
+   if(!dhcp_ipv4_lease_save) return;
+   for(i = 0; i < 4; i++)
+   {
+      lease.ip[i]  = DHCPv4_allocated_ip[i];
+      lease.sn[i]  = DHCPv4_allocated_sn[i];
+      lease.gw[i]  = DHCPv4_allocated_gw[i];
+      lease.dns[i] = DHCPv4_allocated_dns[i];
+      lease.sip[i] = DHCPV4_SIP[i];
+   }
+   lease.lease_time = dhcpv4_lease_time;
+   dhcp_ipv4_lease_save(&lease);
+}
+
+/* get the lease from the load handler, and return 1 if restored */
+static uint8_t load_DHCPv4_lease(void)
+{
+   wiz_DHCPv4Lease lease;
+   uint8_t i;
+
+   if(!dhcp_ipv4_lease_load || !dhcp_ipv4_lease_load(&lease)) return 0;
+   if((lease.ip[0] | lease.ip[1] | lease.ip[2] | lease.ip[3]) == 0) return 0;
+   for(i = 0; i < 4; i++)
+   {
+      DHCPv4_allocated_ip[i]  = lease.ip[i];
+      DHCPv4_allocated_sn[i]  = lease.sn[i];
+      DHCPv4_allocated_gw[i]  = lease.gw[i];
+      DHCPv4_allocated_dns[i] = lease.dns[i];
+      DHCPV4_SIP[i]           = lease.sip[i];
+      DHCPV4_REAL_SIP[i]      = lease.sip[i];
+   }
+   dhcpv4_lease_time = lease.lease_time;
+   return 1;
+}
+
 /* make the common DHCP message */
 void makeDHCPV4MSG(void)
 {
@@ -409,6 +492,7 @@ void send_DHCPv4_DISCOVER(void)
 	pDHCPv4MSG->OPT[k++] = endOption;
 
 	for (i = k; i < OPT_SIZE; i++) pDHCPv4MSG->OPT[i] = 0;
+	if(236 + k > dhcpv4_msg_peak) dhcpv4_msg_peak = 236 + k;
 
 	// send broadcasting packet
 	ip[0] = 255;
@@ -445,6 +529,20 @@ void send_DHCPv4_REQUEST(void)
    	ip[2] = DHCPV4_SIP[2];
    	ip[3] = DHCPV4_SIP[3];
    }
+   else if(dhcpv4_state == STATE_DHCPV4_REBIND)
+   {
+   	// REBINDING : broadcast with ciaddr to any server, without requested IP and server identifier
+   	*((uint8_t*)(&pDHCPv4MSG->flags))   = ((DHCPV4_FLAGSUNICAST & 0xFF00)>> 8);
+   	*((uint8_t*)(&pDHCPv4MSG->flags)+1) = (DHCPV4_FLAGSUNICAST & 0x00FF);
+   	pDHCPv4MSG->ciaddr[0] = DHCPv4_allocated_ip[0];
+   	pDHCPv4MSG->ciaddr[1] = DHCPv4_allocated_ip[1];
+   	pDHCPv4MSG->ciaddr[2] = DHCPv4_allocated_ip[2];
+   	pDHCPv4MSG->ciaddr[3] = DHCPv4_allocated_ip[3];
+   	ip[0] = 255;
+   	ip[1] = 255;
+   	ip[2] = 255;
+   	ip[3] = 255;
+   }
    else
    {
    	ip[0] = 255;
@@ -470,7 +568,7 @@ void send_DHCPv4_REQUEST(void)
 	pDHCPv4MSG->OPT[k++] = DHCPv4_CHADDR[4];
 	pDHCPv4MSG->OPT[k++] = DHCPv4_CHADDR[5];
 
-   if(ip[3] == 255)  // if(dchp_state == STATE_DHCPV4_LEASED || dchp_state == DHCP_REREQUEST_STATE)
+   if((ip[3] == 255) && (dhcpv4_state != STATE_DHCPV4_REBIND))  // SELECTING or INIT-REBOOT, not RENEWING or REBINDING
    {
 		pDHCPv4MSG->OPT[k++] = dhcpRequestedIPaddr;
 		pDHCPv4MSG->OPT[k++] = 0x04;
@@ -478,7 +576,9 @@ void send_DHCPv4_REQUEST(void)
 		pDHCPv4MSG->OPT[k++] = DHCPv4_allocated_ip[1];
 		pDHCPv4MSG->OPT[k++] = DHCPv4_allocated_ip[2];
 		pDHCPv4MSG->OPT[k++] = DHCPv4_allocated_ip[3];
-
+	}
+   if((dhcpv4_state == STATE_DHCPV4_DISCOVER) || (dhcpv4_state == STATE_DHCPV4_REQUEST))  // SELECTING
+   {
 		pDHCPv4MSG->OPT[k++] = dhcpServerIdentifier;
 		pDHCPv4MSG->OPT[k++] = 0x04;
 		pDHCPv4MSG->OPT[k++] = DHCPV4_SIP[0];
@@ -513,6 +613,7 @@ void send_DHCPv4_REQUEST(void)
 	pDHCPv4MSG->OPT[k++] = endOption;
 
 	for (i = k; i < OPT_SIZE; i++) pDHCPv4MSG->OPT[i] = 0;
+	if(236 + k > dhcpv4_msg_peak) dhcpv4_msg_peak = 236 + k;
 
 #ifdef _DHCPV4_DEBUG_
 	printf("> Send DHCP_REQUEST\r\n");
@@ -568,6 +669,7 @@ void send_DHCPv4_DECLINE(void)
 	pDHCPv4MSG->OPT[k++] = endOption;
 
 	for (i = k; i < OPT_SIZE; i++) pDHCPv4MSG->OPT[i] = 0;
+	if(236 + k > dhcpv4_msg_peak) dhcpv4_msg_peak = 236 + k;
 
 	//send broadcasting packet
 	ip[0] = 0xFF;
@@ -582,6 +684,71 @@ void send_DHCPv4_DECLINE(void)
 	wiz_sendto(DHCPV4_SOCKET, (uint8_t *)pDHCPv4MSG, RIP_MSG_SIZE, ip, DHCPV4_SERVER_PORT, 4);
 }
 
+/* Options picked up by dhcpv4_scan(), slot of dhcpv4_opt_t array */
+enum
+{
+	DHCPV4_O_TYPE = 0,
+	DHCPV4_O_SN,
+	DHCPV4_O_GW,
+	DHCPV4_O_DNS,
+	DHCPV4_O_LEASE,
+	DHCPV4_O_T1,
+	DHCPV4_O_T2,
+	DHCPV4_O_SIP,
+	DHCPV4_O_NUM
+};
+
+/* Option found by dhcpv4_scan(), val is NULL if absent */
+typedef struct
+{
+	uint8_t* val;
+	uint8_t  len;
+} dhcpv4_opt_t;
+
+/* Slot + 1 of the option code, 0 for options not used by the client */
+#define DHCPV4_SCAN_CODES  64
+static const uint8_t dhcpv4_scan_slot[DHCPV4_SCAN_CODES] = {
+	[subnetMask]           = DHCPV4_O_SN + 1,
+	[routersOnSubnet]      = DHCPV4_O_GW + 1,
+	[dns]                  = DHCPV4_O_DNS + 1,
+	[dhcpIPaddrLeaseTime]  = DHCPV4_O_LEASE + 1,
+	[dhcpMessageType]      = DHCPV4_O_TYPE + 1,
+	[dhcpServerIdentifier] = DHCPV4_O_SIP + 1,
+	[dhcpT1value]          = DHCPV4_O_T1 + 1,
+	[dhcpT2value]          = DHCPV4_O_T2 + 1,
+};
+
+/* Walk the options of p ~ e once up to endOption, and keep the first one of each code in dhcpv4_scan_slot[].
+ * Return 0 on success, -1 if an option runs over the end. */
+static int8_t dhcpv4_scan(uint8_t* p, uint8_t* e, dhcpv4_opt_t* opts)
+{
+	uint8_t code, len, slot;
+
+	memset(opts, 0, sizeof(dhcpv4_opt_t) * DHCPV4_O_NUM);
+	while(p < e)
+	{
+		code = *p++;
+		if(code == endOption) break;
+		if(code == padOption) continue;
+		if(p >= e) return -1;
+		len = *p++;
+		if(len > (e - p)) return -1;
+		slot = (code < DHCPV4_SCAN_CODES) ? dhcpv4_scan_slot[code] : 0;
+		if(slot && (opts[slot - 1].val == 0))
+		{
+			opts[slot - 1].val = p;
+			opts[slot - 1].len = len;
+		}
+		p += len;
+	}
+	return 0;
+}
+
+static uint32_t dhcpv4_get32(const uint8_t* p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
 /* PARSE REPLY pDHCPv4MSG */
 int8_t parseDHCPv4MSG(void)
 {
@@ -590,14 +757,22 @@ int8_t parseDHCPv4MSG(void)
 	uint16_t len;
 
 	uint8_t * p;
-	uint8_t * e;
 	uint8_t type = 0;
-	uint8_t opt_len;
 	uint8_t addr_len;
+	datasize_t remain;
+	uint8_t drop[32];
+	dhcpv4_opt_t opt[DHCPV4_O_NUM];
 
    if((len = getSn_RX_RSR(DHCPV4_SOCKET)) > 0)
    {
+   	if(len > RIP_MSG_SIZE) len = RIP_MSG_SIZE;
    	len = wiz_recvfrom(DHCPV4_SOCKET, (uint8_t *)pDHCPv4MSG, len, svr_addr, &svr_port, &addr_len);
+   	if((len > 0) && ((uint16_t)len > dhcpv4_msg_peak)) dhcpv4_msg_peak = (uint16_t)len;
+   	// Drop the rest over the buffer
+   	while((getsockopt(DHCPV4_SOCKET, SO_REMAINSIZE, &remain) == SOCK_OK) && (remain > 0))
+   	{
+   		if(wiz_recvfrom(DHCPV4_SOCKET, drop, sizeof(drop), svr_addr, &svr_port, &addr_len) <= 0) break;
+   	}
    #ifdef _DHCPV4_DEBUG_
       printf("DHCP message : %d.%d.%d.%d(%d) %d received. \r\n",svr_addr[0],svr_addr[1],svr_addr[2], svr_addr[3],svr_port, len);
    #endif
@@ -605,7 +780,7 @@ int8_t parseDHCPv4MSG(void)
    else {
     return 0;
    }
-	if (svr_port == DHCPV4_SERVER_PORT) {
+	if ((svr_port == DHCPV4_SERVER_PORT) && (len > 240)) {
       // compare mac address
 		if ( (pDHCPv4MSG->chaddr[0] != DHCPv4_CHADDR[0]) || (pDHCPv4MSG->chaddr[1] != DHCPv4_CHADDR[1]) ||
 		     (pDHCPv4MSG->chaddr[2] != DHCPv4_CHADDR[2]) || (pDHCPv4MSG->chaddr[3] != DHCPv4_CHADDR[3]) ||
@@ -616,8 +791,19 @@ int8_t parseDHCPv4MSG(void)
 #endif
          return 0;
 		}
-        //compare DHCP server ip address
-        if((DHCPV4_SIP[0]!=0) || (DHCPV4_SIP[1]!=0) || (DHCPV4_SIP[2]!=0) || (DHCPV4_SIP[3]!=0)){
+		// compare transaction ID
+		p = (uint8_t *)(&pDHCPv4MSG->xid);
+		if ( (p[0] != (uint8_t)(DHCPV4_XID >> 24)) || (p[1] != (uint8_t)(DHCPV4_XID >> 16)) ||
+		     (p[2] != (uint8_t)(DHCPV4_XID >>  8)) || (p[3] != (uint8_t)(DHCPV4_XID >>  0))   )
+		{
+#ifdef _DHCPV4_DEBUG_
+            printf("Old transaction. This message is ignored.\r\n");
+#endif
+         return 0;
+		}
+        //compare DHCP server ip address, any server can answer REQUEST of REBINDING and INIT-REBOOT
+        if((dhcpv4_state != STATE_DHCPV4_REBIND) && (dhcpv4_state != STATE_DHCPV4_REBOOTING) &&
+           ((DHCPV4_SIP[0]!=0) || (DHCPV4_SIP[1]!=0) || (DHCPV4_SIP[2]!=0) || (DHCPV4_SIP[3]!=0))){
             if( ((svr_addr[0]!=DHCPV4_SIP[0])|| (svr_addr[1]!=DHCPV4_SIP[1])|| (svr_addr[2]!=DHCPV4_SIP[2])|| (svr_addr[3]!=DHCPV4_SIP[3])) &&
                 ((svr_addr[0]!=DHCPV4_REAL_SIP[0])|| (svr_addr[1]!=DHCPV4_REAL_SIP[1])|| (svr_addr[2]!=DHCPV4_REAL_SIP[2])|| (svr_addr[3]!=DHCPV4_REAL_SIP[3]))  )
             {
@@ -629,79 +815,34 @@ int8_t parseDHCPv4MSG(void)
         }
 		p = (uint8_t *)(&pDHCPv4MSG->op);
 		p = p + 240;      // 240 = sizeof(RIP_MSG) + MAGIC_COOKIE size in RIP_MSG.opt - sizeof(RIP_MSG.opt)
-		e = p + (len - 240);
-
-		while ( p < e ) {
-
-			switch ( *p ) {
-
-   			case endOption :
-   			   p = e;   // for break while(p < e)
-   				break;
-            case padOption :
-   				p++;
-   				break;
-   			case dhcpMessageType :
-   				p++;
-   				p++;
-   				type = *p++;
-   				break;
-   			case subnetMask :
-   				p++;
-   				p++;
-   				DHCPv4_allocated_sn[0] = *p++;
-   				DHCPv4_allocated_sn[1] = *p++;
-   				DHCPv4_allocated_sn[2] = *p++;
-   				DHCPv4_allocated_sn[3] = *p++;
-   				break;
-   			case routersOnSubnet :
-   				p++;
-   				opt_len = *p++;
-   				DHCPv4_allocated_gw[0] = *p++;
-   				DHCPv4_allocated_gw[1] = *p++;
-   				DHCPv4_allocated_gw[2] = *p++;
-   				DHCPv4_allocated_gw[3] = *p++;
-   				p = p + (opt_len - 4);
-   				break;
-   			case dns :
-   				p++;
-   				opt_len = *p++;
-   				DHCPv4_allocated_dns[0] = *p++;
-   				DHCPv4_allocated_dns[1] = *p++;
-   				DHCPv4_allocated_dns[2] = *p++;
-   				DHCPv4_allocated_dns[3] = *p++;
-   				p = p + (opt_len - 4);
-   				break;
-   			case dhcpIPaddrLeaseTime :
-   				p++;
-   				opt_len = *p++;
-   				dhcpv4_lease_time  = *p++;
-   				dhcpv4_lease_time  = (dhcpv4_lease_time << 8) + *p++;
-   				dhcpv4_lease_time  = (dhcpv4_lease_time << 8) + *p++;
-   				dhcpv4_lease_time  = (dhcpv4_lease_time << 8) + *p++;
-            #ifdef _DHCPV4_DEBUG_
-               dhcpv4_lease_time = 10;
- 				#endif
-   				break;
-   			case dhcpServerIdentifier :
-   				p++;
-   				opt_len = *p++;
-   				DHCPV4_SIP[0] = *p++;
-   				DHCPV4_SIP[1] = *p++;
-   				DHCPV4_SIP[2] = *p++;
-   				DHCPV4_SIP[3] = *p++;
-                DHCPV4_REAL_SIP[0]=svr_addr[0];
-                DHCPV4_REAL_SIP[1]=svr_addr[1];
-                DHCPV4_REAL_SIP[2]=svr_addr[2];
-                DHCPV4_REAL_SIP[3]=svr_addr[3];
-   				break;
-   			default :
-   				p++;
-   				opt_len = *p++;
-   				p += opt_len;
-   				break;
-			} // switch
-		} // while
+		if(dhcpv4_scan(p, p + (len - 240), opt) < 0)
+		{
+#ifdef _DHCPV4_DEBUG_
+			printf("Truncated option. This message is ignored.\r\n");
+#endif
+			return 0;
+		}
+		dhcpv4_t1 = 0;
+		dhcpv4_t2 = 0;
+
+		if(opt[DHCPV4_O_TYPE].len >= 1) type = opt[DHCPV4_O_TYPE].val[0];
+		if(opt[DHCPV4_O_SN].len >= 4)   memcpy(DHCPv4_allocated_sn, opt[DHCPV4_O_SN].val, 4);
+		if(opt[DHCPV4_O_GW].len >= 4)   memcpy(DHCPv4_allocated_gw, opt[DHCPV4_O_GW].val, 4);
+		if(opt[DHCPV4_O_DNS].len >= 4)  memcpy(DHCPv4_allocated_dns, opt[DHCPV4_O_DNS].val, 4);
+		if(opt[DHCPV4_O_LEASE].len >= 4)
+		{
+			dhcpv4_lease_time = dhcpv4_get32(opt[DHCPV4_O_LEASE].val);
+		#ifdef _DHCPV4_DEBUG_
+			dhcpv4_lease_time = 10;
+		#endif
+		}
+		if(opt[DHCPV4_O_T1].len >= 4)   dhcpv4_t1 = dhcpv4_get32(opt[DHCPV4_O_T1].val);
+		if(opt[DHCPV4_O_T2].len >= 4)   dhcpv4_t2 = dhcpv4_get32(opt[DHCPV4_O_T2].val);
+		if(opt[DHCPV4_O_SIP].len >= 4)
+		{
+			memcpy(DHCPV4_SIP, opt[DHCPV4_O_SIP].val, 4);
+			memcpy(DHCPV4_REAL_SIP, svr_addr, 4);
+		}
 	} // if
 	return	type;
 }
@@ -729,6 +870,11 @@ uint8_t DHCPv4_run(void)
    		send_DHCPv4_DISCOVER();
    		dhcpv4_state = STATE_DHCPV4_DISCOVER;
    		break;
+	   case STATE_DHCPV4_INIT_REBOOT :
+	      // Confirm the restored IP without DISCOVER
+   		dhcpv4_state = STATE_DHCPV4_REBOOTING;
+   		send_DHCPv4_REQUEST();
+   		break;
 		case STATE_DHCPV4_DISCOVER :
 			if (type == DHCPV4_OFFER){
 #ifdef _DHCPV4_DEBUG_
@@ -745,6 +891,7 @@ uint8_t DHCPv4_run(void)
          break;
 
 		case STATE_DHCPV4_REQUEST :
+		case STATE_DHCPV4_REBOOTING :
 			if (type == DHCPV4_ACK) {
 
 #ifdef _DHCPV4_DEBUG_
@@ -754,6 +901,7 @@ uint8_t DHCPv4_run(void)
 					// Network info assignment from DHCP
 					dhcp_ipv4_assign();
 					reset_DHCPv4_timeout();
+					save_DHCPv4_lease();
 
 					dhcpv4_state = STATE_DHCPV4_LEASED;
 				} else {
@@ -770,7 +918,9 @@ uint8_t DHCPv4_run(void)
 
 				reset_DHCPv4_timeout();
 
-				dhcpv4_state = STATE_DHCPV4_DISCOVER;
+				// The restored IP is not valid any more, so start from DISCOVER at once
+				if(dhcpv4_state == STATE_DHCPV4_REBOOTING) dhcpv4_state = STATE_DHCPV4_INIT;
+				else                                       dhcpv4_state = STATE_DHCPV4_DISCOVER;
 			} else ret = check_DHCPv4_timeout();
 		break;
 
@@ -818,6 +968,7 @@ uint8_t DHCPv4_run(void)
             else printf(">IP is continued.\r\n");
          #endif
 				reset_DHCPv4_timeout();
+				save_DHCPv4_lease();
 				dhcpv4_state = STATE_DHCPV4_LEASED;
 			} else if (type == DHCPV4_NAK) {
 
@@ -840,7 +991,9 @@ uint8_t DHCPv4_run(void)
 void    DHCPv4_stop(void)
 {
    wiz_close(DHCPV4_SOCKET);
+   if(wiz_sock_owner(DHCPV4_SOCKET) == SOCK_OWN_DHCPV4) wiz_sock_free(DHCPV4_SOCKET);
    dhcpv4_state = STATE_DHCPV4_STOP;
+   dhcpv4_timer_on = 0;
 }
 
 uint8_t check_DHCPv4_timeout(void)
@@ -857,6 +1010,7 @@ uint8_t check_DHCPv4_timeout(void)
 				break;
 
 				case STATE_DHCPV4_REQUEST :
+				case STATE_DHCPV4_REBOOTING :
 //					printf("<<timeout>> state : STATE_DHCPV4_REQUEST\r\n");
 
 					send_DHCPv4_REQUEST();
@@ -885,6 +1039,7 @@ uint8_t check_DHCPv4_timeout(void)
 				break;
 			case STATE_DHCPV4_REQUEST:
 			case STATE_DHCPV4_REREQUEST:
+			case STATE_DHCPV4_REBOOTING:
 				send_DHCPv4_DISCOVER();
 				dhcpv4_state = STATE_DHCPV4_DISCOVER;
 				break;
@@ -931,6 +1086,301 @@ int8_t check_DHCPv4_leasedIP(void)
 	}
 }
 
+/* Random number for the jitter of retransmission */
+static uint32_t dhcpv4_rand(void)
+{
+	dhcpv4_seed = dhcpv4_seed * 1103515245UL + 12345UL;
+	return dhcpv4_seed >> 16;
+}
+
+/* Set the deadline of DHCPv4_poll() after secs */
+static void dhcpv4_set_timer(uint32_t secs)
+{
+	dhcpv4_deadline = dhcpv4_now + secs;
+	dhcpv4_timer_on = 1;
+}
+
+/* Wait the retransmission timeout with -1 ~ +1s jitter, and double it for the next */
+static void dhcpv4_backoff(void)
+{
+	dhcpv4_set_timer(dhcpv4_rto - 1 + (dhcpv4_rand() % 3));
+	dhcpv4_rto <<= 1;
+	if(dhcpv4_rto > DHCPV4_MAX_RTO) dhcpv4_rto = DHCPV4_MAX_RTO;
+}
+
+/* Wait one-half of the time remaining until T2 or the lease expiry, down to DHCPV4_MIN_RENEW_RTO (cf. RFC2131 4.4.5) */
+static void dhcpv4_wait_until(uint32_t until)
+{
+	uint32_t left = until - dhcpv4_now;
+
+	if((int32_t)left <= 0)                  left = 0;
+	else if((left >> 1) > DHCPV4_MIN_RENEW_RTO) left >>= 1;
+	else if(left > DHCPV4_MIN_RENEW_RTO)     left = DHCPV4_MIN_RENEW_RTO;
+	dhcpv4_set_timer(left);
+}
+
+/* Start new exchange of DISCOVER or REQUEST */
+static void dhcpv4_start_exchange(uint8_t state)
+{
+	dhcpv4_state = state;
+	dhcpv4_retry_count = 0;
+	dhcpv4_rto = DHCPV4_INIT_RTO;
+}
+
+static void dhcpv4_send_request(void)
+{
+	dhcpv4_req_sent = dhcpv4_now;
+	send_DHCPv4_REQUEST();
+}
+
+/* Enter BOUND state, and set T1, T2 and the lease expiry from the last REQUEST sent */
+static void dhcpv4_bind(void)
+{
+	uint32_t t1 = dhcpv4_t1;
+	uint32_t t2 = dhcpv4_t2;
+
+	dhcpv4_state = STATE_DHCPV4_LEASED;
+	dhcpv4_retry_count = 0;
+	save_DHCPv4_lease();
+	if(dhcpv4_lease_time == INFINITE_LEASETIME)
+	{
+		dhcpv4_timer_on = 0;
+		return;
+	}
+	if((t2 == 0) || (t2 > dhcpv4_lease_time)) t2 = dhcpv4_lease_time - (dhcpv4_lease_time >> 3);
+	if((t1 == 0) || (t1 > t2))                 t1 = ((dhcpv4_lease_time >> 1) < t2) ? (dhcpv4_lease_time >> 1) : t2;
+	dhcpv4_t2_at     = dhcpv4_req_sent + t2;
+	dhcpv4_expire_at = dhcpv4_req_sent + dhcpv4_lease_time;
+	dhcpv4_deadline  = dhcpv4_req_sent + t1;
+	dhcpv4_timer_on  = 1;
+#ifdef _DHCPV4_DEBUG_
+	printf("> Lease %lus, T1 %lus, T2 %lus\r\n", (unsigned long)dhcpv4_lease_time, (unsigned long)t1, (unsigned long)t2);
+#endif
+}
+
+/* Process the message received in DHCPv4_poll() */
+static uint8_t dhcpv4_input(uint8_t type)
+{
+	uint8_t ret = DHCPV4_RUNNING;
+
+	switch(dhcpv4_state)
+	{
+		case STATE_DHCPV4_DISCOVER :
+			if(type != DHCPV4_OFFER) break;
+#ifdef _DHCPV4_DEBUG_
+			printf("> Receive DHCP_OFFER\r\n");
+#endif
+			DHCPv4_allocated_ip[0] = pDHCPv4MSG->yiaddr[0];
+			DHCPv4_allocated_ip[1] = pDHCPv4MSG->yiaddr[1];
+			DHCPv4_allocated_ip[2] = pDHCPv4MSG->yiaddr[2];
+			DHCPv4_allocated_ip[3] = pDHCPv4MSG->yiaddr[3];
+			dhcpv4_start_exchange(STATE_DHCPV4_REQUEST);
+			dhcpv4_send_request();
+			dhcpv4_backoff();
+			break;
+
+		case STATE_DHCPV4_REQUEST :
+		case STATE_DHCPV4_REBOOTING :
+			if(type == DHCPV4_ACK) {
+#ifdef _DHCPV4_DEBUG_
+				printf("> Receive DHCP_ACK\r\n");
+#endif
+				if(check_DHCPv4_leasedIP()) {
+					dhcp_ipv4_assign();
+					dhcpv4_bind();
+					ret = DHCP_IPV4_ASSIGN;
+				} else {
+					// IP address conflict occurred, wait 10s after DECLINE (cf. RFC2131 3.1.5)
+					dhcp_ipv4_conflict();
+					dhcpv4_state = STATE_DHCPV4_INIT;
+					dhcpv4_set_timer(DHCPV4_WAIT_TIME);
+				}
+			} else if(type == DHCPV4_NAK) {
+#ifdef _DHCPV4_DEBUG_
+				printf("> Receive DHCP_NACK\r\n");
+#endif
+				dhcpv4_state = STATE_DHCPV4_INIT;
+				dhcpv4_set_timer(0);
+			}
+			break;
+
+		case STATE_DHCPV4_REREQUEST :
+		case STATE_DHCPV4_REBIND :
+			ret = DHCP_IPV4_LEASED;
+			if(type == DHCPV4_ACK) {
+				DHCPv4_allocated_ip[0] = pDHCPv4MSG->yiaddr[0];
+				DHCPv4_allocated_ip[1] = pDHCPv4MSG->yiaddr[1];
+				DHCPv4_allocated_ip[2] = pDHCPv4MSG->yiaddr[2];
+				DHCPv4_allocated_ip[3] = pDHCPv4MSG->yiaddr[3];
+				if (OLD_allocated_ip[0] != DHCPv4_allocated_ip[0] ||
+				    OLD_allocated_ip[1] != DHCPv4_allocated_ip[1] ||
+				    OLD_allocated_ip[2] != DHCPv4_allocated_ip[2] ||
+				    OLD_allocated_ip[3] != DHCPv4_allocated_ip[3])
+				{
+					ret = DHCP_IPV4_CHANGED;
+					dhcp_ipv4_update();
+#ifdef _DHCPV4_DEBUG_
+					printf(">IP changed.\r\n");
+#endif
+				}
+				dhcpv4_bind();
+			} else if(type == DHCPV4_NAK) {
+#ifdef _DHCPV4_DEBUG_
+				printf("> Receive DHCP_NACK, Failed to maintain ip\r\n");
+#endif
+				ret = DHCPV4_RUNNING;
+				dhcpv4_state = STATE_DHCPV4_INIT;
+				dhcpv4_set_timer(0);
+			}
+			break;
+
+		default :
+			break;
+	}
+	return ret;
+}
+
+/* Process the deadline due in DHCPv4_poll() */
+static uint8_t dhcpv4_timeout(void)
+{
+	uint8_t ret = DHCPV4_RUNNING;
+
+	switch(dhcpv4_state)
+	{
+		case STATE_DHCPV4_INIT :
+			DHCPv4_allocated_ip[0] = 0;
+			DHCPv4_allocated_ip[1] = 0;
+			DHCPv4_allocated_ip[2] = 0;
+			DHCPv4_allocated_ip[3] = 0;
+			dhcpv4_start_exchange(STATE_DHCPV4_DISCOVER);
+			send_DHCPv4_DISCOVER();
+			dhcpv4_backoff();
+			break;
+
+		case STATE_DHCPV4_INIT_REBOOT :
+			// Confirm the restored IP without DISCOVER
+			dhcpv4_start_exchange(STATE_DHCPV4_REBOOTING);
+			dhcpv4_send_request();
+			dhcpv4_backoff();
+			break;
+
+		case STATE_DHCPV4_DISCOVER :
+		case STATE_DHCPV4_REQUEST :
+		case STATE_DHCPV4_REBOOTING :
+			if(dhcpv4_retry_count < MAX_DHCPV4_RETRY) {
+				dhcpv4_retry_count++;
+				if(dhcpv4_state == STATE_DHCPV4_DISCOVER) send_DHCPv4_DISCOVER();
+				else                                      dhcpv4_send_request();
+				dhcpv4_backoff();
+			} else if(dhcpv4_state == STATE_DHCPV4_DISCOVER) {
+				ret = DHCPV4_FAILED;
+				dhcpv4_state = STATE_DHCPV4_INIT;
+				dhcpv4_set_timer(DHCPV4_WAIT_TIME);
+			} else {
+				dhcpv4_state = STATE_DHCPV4_INIT;
+				dhcpv4_set_timer(0);
+			}
+			break;
+
+		case STATE_DHCPV4_LEASED :   // T1
+#ifdef _DHCPV4_DEBUG_
+			printf("> Maintains the IP address \r\n");
+#endif
+			ret = DHCP_IPV4_LEASED;
+			OLD_allocated_ip[0] = DHCPv4_allocated_ip[0];
+			OLD_allocated_ip[1] = DHCPv4_allocated_ip[1];
+			OLD_allocated_ip[2] = DHCPv4_allocated_ip[2];
+			OLD_allocated_ip[3] = DHCPv4_allocated_ip[3];
+			DHCPV4_XID++;
+			dhcpv4_state = STATE_DHCPV4_REREQUEST;
+			dhcpv4_send_request();
+			dhcpv4_wait_until(dhcpv4_t2_at);
+			break;
+
+		case STATE_DHCPV4_REREQUEST :
+			ret = DHCP_IPV4_LEASED;
+			if((int32_t)(dhcpv4_now - dhcpv4_t2_at) < 0) {
+				dhcpv4_send_request();
+				dhcpv4_wait_until(dhcpv4_t2_at);
+				break;
+			}
+#ifdef _DHCPV4_DEBUG_
+			printf("> T2, Rebinding the IP address \r\n");
+#endif
+			dhcpv4_state = STATE_DHCPV4_REBIND;
+			// fall through
+		case STATE_DHCPV4_REBIND :
+			if((int32_t)(dhcpv4_now - dhcpv4_expire_at) < 0) {
+				ret = DHCP_IPV4_LEASED;
+				dhcpv4_send_request();
+				dhcpv4_wait_until(dhcpv4_expire_at);
+			} else {
+#ifdef _DHCPV4_DEBUG_
+				printf("> Lease expired\r\n");
+#endif
+				// The address is no longer ours, so take it off WIZCHIP before DISCOVER
+				dhcp_ipv4_expire();
+				ret = DHCPV4_FAILED;
+				dhcpv4_state = STATE_DHCPV4_INIT;
+				dhcpv4_set_timer(0);
+			}
+			break;
+
+		default :
+			break;
+	}
+	return ret;
+}
+
+uint8_t DHCPv4_poll(uint8_t events)
+{
+	uint8_t type;
+	uint8_t ret;
+	int8_t  state;
+
+	if(dhcpv4_state == STATE_DHCPV4_STOP) return DHCPV4_STOPPED;
+
+	if((dhcpv4_state == STATE_DHCPV4_LEASED) || (dhcpv4_state == STATE_DHCPV4_REREQUEST) ||
+	   (dhcpv4_state == STATE_DHCPV4_REBIND))
+		ret = DHCP_IPV4_LEASED;
+	else
+		ret = DHCPV4_RUNNING;
+
+	if(events & SIK_RECEIVED)
+	{
+		while(getSn_RX_RSR(DHCPV4_SOCKET) > 0)
+		{
+			if((type = parseDHCPv4MSG()) == 0) continue;
+			// A message not handled in the state, such as the second ACK to a retransmitted REQUEST, keeps the result
+			state = dhcpv4_state;
+			type = dhcpv4_input(type);
+			if(dhcpv4_state != state) ret = type;
+		}
+	}
+
+	if(dhcpv4_timer_on && ((int32_t)(dhcpv4_now - dhcpv4_deadline) >= 0))
+	{
+		dhcpv4_timer_on = 0;
+		if(getSn_SR(DHCPV4_SOCKET) != SOCK_UDP)
+			wiz_socket(DHCPV4_SOCKET, Sn_MR_UDP, DHCPV4_CLIENT_PORT, 0x00);
+		type = dhcpv4_timeout();
+		if((type != DHCPV4_RUNNING) || (ret == DHCP_IPV4_LEASED)) ret = type;
+	}
+	return ret;
+}
+
+uint16_t DHCPv4_get_msg_peak(void)
+{
+	return dhcpv4_msg_peak;
+}
+
+uint32_t DHCPv4_next_deadline(void)
+{
+	if((dhcpv4_state == STATE_DHCPV4_STOP) || !dhcpv4_timer_on) return INFINITE_LEASETIME;
+	if((int32_t)(dhcpv4_deadline - dhcpv4_now) <= 0) return 0;
+	return dhcpv4_deadline - dhcpv4_now;
+}
+
 void DHCPv4_init(uint8_t s, uint8_t * buf)
 {
    uint8_t zeroip[4] = {0,0,0,0};
@@ -948,6 +1398,13 @@ void DHCPv4_init(uint8_t s, uint8_t * buf)
    }
 
 	DHCPV4_SOCKET = s; // SOCK_DHCP
+	// Keep s from wiz_sock_alloc() of the others, and stay stopped if it is owned by them
+	if(wiz_sock_claim(s, SOCK_OWN_DHCPV4) < 0)
+	{
+		dhcpv4_state = STATE_DHCPV4_STOP;
+		dhcpv4_timer_on = 0;
+		return;
+	}
 	pDHCPv4MSG = (RIP_MSG*)buf;
 	DHCPV4_XID = 0x12345678;
 
@@ -957,6 +1414,13 @@ void DHCPv4_init(uint8_t s, uint8_t * buf)
 
 	reset_DHCPv4_timeout();
 	dhcpv4_state = STATE_DHCPV4_INIT;
+	if(load_DHCPv4_lease()) dhcpv4_state = STATE_DHCPV4_INIT_REBOOT;
+
+	// DHCPv4_poll() starts at once, and the jitter differs by MAC address
+	dhcpv4_seed = DHCPV4_XID ^ ((uint32_t)DHCPv4_CHADDR[2] << 24) ^ ((uint32_t)DHCPv4_CHADDR[3] << 16) ^
+	              ((uint32_t)DHCPv4_CHADDR[4] << 8) ^ DHCPv4_CHADDR[5];
+	dhcpv4_msg_peak = 0;
+	dhcpv4_set_timer(0);
 }
 
 
@@ -971,6 +1435,7 @@ void reset_DHCPv4_timeout(void)
 void DHCPv4_time_handler(void)
 {
 	dhcpv4_tick_1s++;
+	dhcpv4_now++;
 }
 
 void getIPfromDHCPv4(uint8_t* ip)
@@ -62,6 +62,15 @@ extern "C" {
 #define	MAX_DHCPV4_RETRY          2        ///< Maximum retry count
 #define	DHCPV4_WAIT_TIME          10       ///< Wait Time 10s
 
+/* Retransmission of DHCPv4_poll(), doubled on each retry with +-1s jitter (cf. RFC2131 4.1) */
+#ifndef DHCPV4_INIT_RTO
+#define DHCPV4_INIT_RTO           4        ///< First retransmission timeout 4s
+#endif
+#ifndef DHCPV4_MAX_RTO
+#define DHCPV4_MAX_RTO            64       ///< Maximum retransmission timeout 64s
+#endif
+#define DHCPV4_MIN_RENEW_RTO      60       ///< Minimum retransmission timeout in RENEWING and REBINDING 60s
+
 
 /* UDP port numbers for DHCP */
 #define DHCPV4_SERVER_PORT      	67	      ///< DHCP server port number
@@ -85,8 +94,25 @@ enum
    DHCPV4_STOPPED      ///< Stop processing DHCP protocol
 };
 
+/*
+ * @brief Lease kept over reset by the handlers of reg_dhcpv4_lease_cbfunc()
+ */
+typedef struct wiz_DHCPv4Lease_t
+{
+   uint8_t  ip[4];        ///< Leased IP address
+   uint8_t  sn[4];        ///< Subnet mask
+   uint8_t  gw[4];        ///< Gateway address
+   uint8_t  dns[4];       ///< DNS address
+   uint8_t  sip[4];       ///< DHCP server identifier
+   uint32_t lease_time;   ///< Lease time in seconds
+} wiz_DHCPv4Lease;
+
 /*
  * @brief DHCP client initialization (outside of the main loop)
+ * @details If the lease is restored by the load handler of reg_dhcpv4_lease_cbfunc(), the client starts at INIT-REBOOT.
+ *          It broadcasts REQUEST for the restored IP without DISCOVER, and falls back to DISCOVER on NACK or timeout.
+ *          The socket is claimed in the SOCKET pool by wiz_sock_claim(), and given back by DHCPv4_stop().
+ *          If it is owned by another one, the client stays stopped.
  * @param s   - socket number
  * @param buf - buffer for processing DHCP message
  */
@@ -102,10 +128,25 @@ void DHCPv4_time_handler(void);
  * @brief Register call back function
  * @param ip_assign   - callback func when IP is assigned from DHCP server first
  * @param ip_update   - callback func when IP is changed
- * @param ip_conflict - callback func when the assigned IP is conflict with others.
+ * @param ip_conflict - callback func when the assigned IP is conflict with others
  */
 void reg_dhcpv4_cbfunc(void(*ip_assign)(void), void(*ip_update)(void), void(*ip_conflict)(void));
 
+/*
+ * @brief Register call back function of the lease expiry
+ * @param ip_expire - callback func when the lease of DHCPv4_poll() expires. NULL sets SIPR to 0.0.0.0.
+ * @note The default handler does not reset WIZCHIP, so the SOCKETs of other services are kept open.
+ */
+void reg_dhcpv4_expire_cbfunc(void(*ip_expire)(void));
+
+/*
+ * @brief Register lease persistence function for fast boot
+ * @param lease_save  - callback func to keep the lease in non-volatile memory, called whenever ACK is received
+ * @param lease_load  - callback func to restore the kept lease, called by DHCPv4_init(). Return 1 if restored, or 0.
+ * @note Register it before DHCPv4_init(). NULL disables each of them.
+ */
+void reg_dhcpv4_lease_cbfunc(void (*lease_save)(const wiz_DHCPv4Lease* lease), uint8_t (*lease_load)(wiz_DHCPv4Lease* lease));
+
 /*
  * @brief DHCP client in the main loop
  * @return    The value is as the follow \n
@@ -126,6 +167,38 @@ uint8_t DHCPv4_run(void);
  */
 void    DHCPv4_stop(void);
 
+/*
+ * @brief Event driven DHCP client
+ * @details The state machine is same as DHCPv4_run(), but it touches WIZCHIP only when woken by an event:
+ *          - the socket received a message, as SIK_RECEIVED from the handler of reg_wiz_event_cbfunc() or wiz_wait_events()
+ *          - a deadline of DISCOVER and REQUEST retransmission, T1(renew) or T2(rebind) or the lease expiry is due
+ *          Retransmission is backed off from DHCPV4_INIT_RTO to DHCPV4_MAX_RTO with +-1s jitter.
+ *          T1 and T2 are taken from the ACK, or 50% and 87.5% of the lease time, and counted from the REQUEST sent.
+ *          REQUEST is unicast to the server after T1, and broadcast to any server after T2.
+ *          When the lease expires, the address is taken off by the handler of reg_dhcpv4_expire_cbfunc(),
+ *          and it starts from DISCOVER again.
+ * @param events : OR of sockint_kind of the DHCP socket newly occurred. 0 when woken by the timer.
+ * @return  Same as DHCPv4_run(), and @ref DHCP_IPV4_ASSIGN when IP is first leased.
+ * @note Call it from your main task with the events, or whenever DHCPv4_next_deadline() returns 0.
+ *       The call without events and due deadline returns at once without SPI access,
+ *       so a leased device has no SPI traffic until T1.
+ *       Timeout is counted by DHCPv4_time_handler(). Do not mix it with DHCPv4_run().
+ */
+uint8_t DHCPv4_poll(uint8_t events);
+
+/*
+ * @brief Get the time to the next deadline of DHCPv4_poll()
+ * @return Seconds to the deadline, 0 if due. 0xFFFFFFFF if none, as stopped or infinite lease.
+ */
+uint32_t DHCPv4_next_deadline(void);
+
+/*
+ * @brief Get the largest message in the buffer of DHCPv4_init() since it
+ * @return Bytes of the largest message received, or built up to its end option.
+ *         The message is sent in 548 bytes, padded by zero after the end option.
+ */
+uint16_t DHCPv4_get_msg_peak(void);
+
 /* Get Network information assigned from DHCP server */
 /*
  * @brief Get IP address
@@ -45,8 +45,7 @@
 #include <stdio.h>
 #include <string.h>
 
-/* If you want to display debug & procssing message, Define _DHCP_DEBUG_ in dhcp.h */
-#define _DHCP6_DEBUG_
+/* If you want to display debug & procssing message, Define _DHCP6_DEBUG_ in dhcpv6.h */
 #ifdef _DHCP6_DEBUG_
 #include <stdio.h>
 #endif
@@ -59,6 +58,8 @@
 #define STATE_DHCP6_REREQUEST 4 ///< send REQUEST for maintaining leased IP
 #define STATE_DHCP6_RELEASE 5   ///< No use
 #define STATE_DHCP6_STOP 6      ///< Stop procssing DHCP
+#define STATE_DHCP6_RENEW 7     ///< send RENEW to the server at T1, DHCP_poll() only
+#define STATE_DHCP6_REBIND 8    ///< send REBIND to any server at T2, DHCP_poll() only
 
 /* DHCP6 message type */
 #define DHCP6_SOLICIT 1       ///< DISCOVER message in OPT of @ref RIP_MSG
@@ -174,6 +175,11 @@ uint16_t serverid_len;
 uint16_t clientid_len;
 uint8_t status_msg[] = "";
 
+static uint16_t dhcp6_msg_peak = 0; // largest message in the buffer of DHCP_init()
+static uint8_t dhcp6_rx_xid;   // xid of the last message of parseDHCPMSG() is DHCP_XID
+static uint8_t dhcp6_rx_rapid; // the last message of parseDHCPMSG() has Rapid Commit
+static uint8_t dhcp6_rx_bound; // the last message of parseDHCPMSG() has Success status and an IA Address
+
 unsigned size;
 unsigned num;
 unsigned num2 = 0;
@@ -287,8 +293,8 @@ void send_DHCP_SOLICIT(void)
 
     AppendDhcpOption(DHCP6_SOLICIT);
     AppendDhcpOption((uint8_t)((DHCP_XID & 0x00FF0000) >> 16));
-    AppendDhcpOption((uint8_t)((DHCP_XID & 0x00FF0000) >> 8));
-    AppendDhcpOption((uint8_t)((DHCP_XID & 0x00FF0000) >> 0));
+    AppendDhcpOption((uint8_t)((DHCP_XID & 0x0000FF00) >> 8));
+    AppendDhcpOption((uint8_t)((DHCP_XID & 0x000000FF) >> 0));
     DumpDhcpOption("Type&XID");
 
     // Elapsed time
@@ -332,6 +338,15 @@ void send_DHCP_SOLICIT(void)
     AppendDhcpOption(0x00);
     DumpDhcpOption("Option IANA");
 
+#if DHCP6_RAPID_COMMIT
+    // Rapid Commit
+    AppendDhcpOption(0x00);
+    AppendDhcpOption(OPT_RAPID_COMMIT);
+    AppendDhcpOption(0x00);
+    AppendDhcpOption(0x00); // length
+    DumpDhcpOption("Option Rapid Commit");
+#endif
+
     // Fully Qualified Domain Name
     //    AppendDhcpOption(0x00);AppendDhcpOption(39);
     //    AppendDhcpOption(0x00);AppendDhcpOption(0x06); // length
@@ -371,14 +386,16 @@ void send_DHCP_SOLICIT(void)
 
     rip_msg_size = size;
 
-#ifdef _DHCP_DEBUG_
+#ifdef _DHCP6_DEBUG_
     printf("> Send DHCP_DISCOVER\r\n");
 #endif
 
+    if (rip_msg_size > dhcp6_msg_peak)
+        dhcp6_msg_peak = rip_msg_size;
     wiz_sendto(DHCP_SOCKET, (uint8_t *)pDHCPMSG.OPT, rip_msg_size, ip, DHCP_SERVER_PORT, 16);
 
-#ifdef _DHCP_DEBUG_
-    printf("> %d, %d\r\n", ret, rip_msg_size);
+#ifdef _DHCP6_DEBUG_
+    printf("> %d\r\n", rip_msg_size);
 #endif
 
     //return ret
@@ -581,12 +598,14 @@ uint8_t send_DHCP_REQUEST(void)
 
     rip_msg_size = size;
 
-#ifdef _DHCP_DEBUG_
+#ifdef _DHCP6_DEBUG_
     printf("> Send DHCP_REQUEST\r\n");
 #endif
 
+    if (rip_msg_size > dhcp6_msg_peak)
+        dhcp6_msg_peak = rip_msg_size;
     wiz_sendto(DHCP_SOCKET, (uint8_t *)pDHCPMSG.OPT, rip_msg_size, ip, DHCP_SERVER_PORT, 16);
-#ifdef _DHCP_DEBUG_
+#ifdef _DHCP6_DEBUG_
     printf("> %d, %d\r\n", ret, rip_msg_size);
 #endif
 
@@ -669,19 +688,123 @@ uint8_t send_DHCP_INFOREQ(void)
 
     rip_msg_size = size;
 
-#ifdef _DHCP_DEBUG_
+#ifdef _DHCP6_DEBUG_
     printf("> Send DHCP_REQUEST\r\n");
 #endif
 
+    if (rip_msg_size > dhcp6_msg_peak)
+        dhcp6_msg_peak = rip_msg_size;
     wiz_sendto(DHCP_SOCKET, (uint8_t *)pDHCPMSG.OPT, rip_msg_size, ip, DHCP_SERVER_PORT, 16);
 
-#ifdef _DHCP_DEBUG_
+#ifdef _DHCP6_DEBUG_
     printf("> %d, %d\r\n", ret, rip_msg_size);
 #endif
 
     return ret;
 }
 
+/*
+ * @brief Options picked up by dhcp6_scan(), slot of @ref dhcp6_opt_t array
+ */
+enum
+{
+    DHCP6_O_CLIENTID = 0,
+    DHCP6_O_SERVERID,
+    DHCP6_O_IANA,
+    DHCP6_O_IAADDR,
+    DHCP6_O_PREFERENCE,
+    DHCP6_O_STATUS,
+    DHCP6_O_RAPID,
+    DHCP6_O_DNS,
+    DHCP6_O_NUM
+};
+
+/*
+ * @brief Option found by dhcp6_scan(), val is NULL if absent
+ */
+typedef struct
+{
+    uint8_t *val;
+    uint16_t len;
+} dhcp6_opt_t;
+
+/* Slot + 1 of the option code, 0 for options not used by the client */
+#define DHCP6_SCAN_CODES 32
+static const uint8_t dhcp6_scan_slot[DHCP6_SCAN_CODES] = {
+    [OPT_CLIENTID] = DHCP6_O_CLIENTID + 1,
+    [OPT_SERVERID] = DHCP6_O_SERVERID + 1,
+    [OPT_IANA] = DHCP6_O_IANA + 1,
+    [OPT_IAADDR] = DHCP6_O_IAADDR + 1,
+    [OPT_PREFERENCE] = DHCP6_O_PREFERENCE + 1,
+    [OPT_STATUS_CODE] = DHCP6_O_STATUS + 1,
+    [OPT_RAPID_COMMIT] = DHCP6_O_RAPID + 1,
+    [DNS_RecursiveNameServer] = DHCP6_O_DNS + 1,
+};
+
+static uint16_t dhcp6_get16(const uint8_t *p)
+{
+    return ((uint16_t)p[0] << 8) | p[1];
+}
+
+static uint32_t dhcp6_get32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/*
+ * @brief Walk the options of p ~ p+len once, and keep the first one of each code in dhcp6_scan_slot[]
+ * @return 0 on success, -1 if an option runs over the end
+ */
+static int8_t dhcp6_scan(uint8_t *p, uint16_t len, dhcp6_opt_t *opts)
+{
+    uint16_t code, olen;
+    uint8_t slot;
+
+    memset(opts, 0, sizeof(dhcp6_opt_t) * DHCP6_O_NUM);
+    while (len > 0)
+    {
+        if (len < 4)
+            return -1;
+        code = dhcp6_get16(p);
+        olen = dhcp6_get16(p + 2);
+        if (olen > len - 4)
+            return -1;
+        slot = (code < DHCP6_SCAN_CODES) ? dhcp6_scan_slot[code] : 0;
+        if (slot && (opts[slot - 1].val == 0))
+        {
+            opts[slot - 1].val = p + 4;
+            opts[slot - 1].len = olen;
+        }
+        p += 4 + olen;
+        len -= 4 + olen;
+    }
+    return 0;
+}
+
+/*
+ * @brief Find the option of code whose value begins with key, in the options of p ~ p+len passed by dhcp6_scan()
+ * @return Value of the option, or NULL if none. olen is its length.
+ */
+static uint8_t *dhcp6_find(uint8_t *p, uint16_t len, uint16_t code, const uint8_t *key, uint16_t klen, uint16_t *olen)
+{
+    uint16_t l;
+
+    while (len >= 4)
+    {
+        l = dhcp6_get16(p + 2);
+        if (l > len - 4)
+            break;
+        if ((dhcp6_get16(p) == code) && (l >= klen) && (memcmp(p + 4, key, klen) == 0))
+        {
+            *olen = l;
+            return p + 4;
+        }
+        p += 4 + l;
+        len -= 4 + l;
+    }
+    return 0;
+}
+
 /**
  * @brief 
  * 
@@ -692,340 +815,107 @@ int8_t parseDHCPMSG(void)
     uint8_t svr_addr[16];
     uint16_t svr_port;
     uint8_t addlen;
-    uint16_t len;
+    datasize_t len;
+    datasize_t remain;
+    uint8_t drop[32];
     uint8_t *p;
-    uint8_t *e;
-    uint8_t type, i;
-    uint16_t opt_len;
-    uint32_t end_point;
-
-    if ((len = getSn_RX_RSR(DHCP_SOCKET)) > 0)
+    dhcp6_opt_t opt[DHCP6_O_NUM];
+    dhcp6_opt_t sub[DHCP6_O_NUM];
+    uint16_t n;
+    uint8_t success;
+
+    dhcp6_rx_xid = 0;
+    dhcp6_rx_rapid = 0;
+    dhcp6_rx_bound = 0;
+    if (getSn_RX_RSR(DHCP_SOCKET) == 0)
+        return 0;
+    len = wiz_recvfrom(DHCP_SOCKET, (uint8_t *)pDHCPMSG.OPT, DHCP6_MAX_MSG_SIZE, svr_addr, (uint16_t *)&svr_port, &addlen);
+    if ((len > 0) && ((uint16_t)len > dhcp6_msg_peak))
+        dhcp6_msg_peak = (uint16_t)len;
+    // Drop the rest over the buffer
+    while ((getsockopt(DHCP_SOCKET, SO_REMAINSIZE, &remain) == SOCK_OK) && (remain > 0))
     {
-        len = wiz_recvfrom(DHCP_SOCKET, (uint8_t *)pDHCPMSG.OPT, len, svr_addr, (uint16_t *)&svr_port, &addlen);
+        if (wiz_recvfrom(DHCP_SOCKET, drop, sizeof(drop), svr_addr, &svr_port, &addlen) <= 0)
+            break;
+    }
 #ifdef _DHCP6_DEBUG_
-        printf("DHCP message : %.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x(%d) %d received. \r\n", svr_addr[0], svr_addr[1], svr_addr[2], svr_addr[3], svr_addr[4], svr_addr[5], svr_addr[6], svr_addr[7], svr_addr[8], svr_addr[9], svr_addr[10], svr_addr[11], svr_addr[12], svr_addr[13], svr_addr[14], svr_addr[15], svr_port, len);
+    printf("DHCP message : %.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x(%d) %d received. \r\n", svr_addr[0], svr_addr[1], svr_addr[2], svr_addr[3], svr_addr[4], svr_addr[5], svr_addr[6], svr_addr[7], svr_addr[8], svr_addr[9], svr_addr[10], svr_addr[11], svr_addr[12], svr_addr[13], svr_addr[14], svr_addr[15], svr_port, len);
 #endif
-    }
-    else
-    {
+    p = (uint8_t *)(pDHCPMSG.OPT);
+    if ((len < 4) || ((p[0] != DHCP6_ADVERTISE) && (p[0] != DHCP6_REPLY)))
         return 0;
-    }
+    if (dhcp6_scan(p + 4, (uint16_t)(len - 4), opt) < 0)
+        return 0; // truncated
+    dhcp6_rx_xid = (p[1] == (uint8_t)(DHCP_XID >> 16)) && (p[2] == (uint8_t)(DHCP_XID >> 8)) && (p[3] == (uint8_t)DHCP_XID);
+    dhcp6_rx_rapid = (opt[DHCP6_O_RAPID].val != 0);
+    // Status code 0 is Success, and no status code means Success too
+    success = !(opt[DHCP6_O_STATUS].val && (opt[DHCP6_O_STATUS].len >= 2) && dhcp6_get16(opt[DHCP6_O_STATUS].val));
 
-    type = 0;
-    p = (uint8_t *)(pDHCPMSG.OPT);
-    e = p + len;
-#ifdef _DHCP6_DEBUG_
-    printf("in server port %x\r\n", *p);
-#endif
-    i = 0;
-    /*
-        while(p<e){
-        	printf("%.2x ",*p);
-        	i8f(i%16 == 1){
-        		printf("\r\n");
-        	}
-        	p++;i++;
-        }
-        i=0;*/
+    if (opt[DHCP6_O_CLIENTID].val)
+        clientid_len = opt[DHCP6_O_CLIENTID].len;
 
-    switch (*p)
-    {
-    case DHCP6_ADVERTISE:
-    case DHCP6_REPLY:
+    if (opt[DHCP6_O_IANA].val && (opt[DHCP6_O_IANA].len >= 12))
     {
-#ifdef _DHCP6_DEBUG_
-        printf("in ADVER or REPLY(7) type : %x \r\n", *p);
-#endif
-        type = *p++; // type
-        p++;         // xid[0]
-        p++;         // xid[1]
-        p++;         // xid[2]
-        while (p < e)
+        p = opt[DHCP6_O_IANA].val;
+        iana_len = opt[DHCP6_O_IANA].len;
+        memcpy(IAID, p, 4);
+        memcpy(T1, p + 4, 4);
+        memcpy(T2, p + 8, 4);
+        // IA_NA-options
+        if (dhcp6_scan(p + 12, iana_len - 12, sub) < 0)
+            return 0;
+        if (sub[DHCP6_O_IAADDR].val && (sub[DHCP6_O_IAADDR].len >= 24))
         {
-            p++;
-            switch (*p)
-            {
-            case OPT_CLIENTID:
-            {
-#ifdef _DHCP6_DEBUG_
-                printf("in clientid \r\n");
-#endif
-                p++;
-
-                opt_len = (*p++ << 8);
-                clientid_len = opt_len + (*p++);
-#ifdef _DHCP6_DEBUG_
-                printf("opt_len : %.4x\r\n", clientid_len);
-#endif
-                end_point = (uint32_t)p + clientid_len;
-
-                while ((uint32_t)p != end_point)
-                {
-                    p++;
-                }
-                break;
-            }
-
-            case OPT_IANA:
-            {
-#ifdef _DHCP6_DEBUG_
-                printf("in iana \r\n");
-#endif
-                p++;
-                opt_len = (*p++ << 8);
-                iana_len = opt_len + (*p++);
-                end_point = (uint32_t)p + iana_len;
-
-                //IAID
-                IAID[0] = *p++;
-                IAID[1] = *p++;
-                IAID[2] = *p++;
-                IAID[3] = *p++;
-                //T1
-                T1[0] = *p++;
-                T1[1] = *p++;
-                T1[2] = *p++;
-                T1[3] = *p++;
-                //T2
-                T2[0] = *p++;
-                T2[1] = *p++;
-                T2[2] = *p++;
-                T2[3] = *p++;
-                //IA_NA-options
-                while ((uint32_t)p < end_point)
-                {
-                    p++;
-                    switch (*p)
-                    {
-                    case OPT_IAADDR:
-                    {
-#ifdef _DHCP6_DEBUG_
-                        printf("in IA addr \r\n");
-#endif
-                        p++;
-                        opt_len = (*p++ << 8);
-                        iaaddr_len = opt_len + (*p++);
-                        recv_IP[0] = *p++;
-                        recv_IP[1] = *p++;
-                        recv_IP[2] = *p++;
-                        recv_IP[3] = *p++;
-                        recv_IP[4] = *p++;
-                        recv_IP[5] = *p++;
-                        recv_IP[6] = *p++;
-                        recv_IP[7] = *p++;
-                        recv_IP[8] = *p++;
-                        recv_IP[9] = *p++;
-                        recv_IP[10] = *p++;
-                        recv_IP[11] = *p++;
-                        recv_IP[12] = *p++;
-                        recv_IP[13] = *p++;
-                        recv_IP[14] = *p++;
-                        recv_IP[15] = *p++;
-
-                        PreLifeTime = (*p++ << 24);
-                        PreLifeTime += (*p++ << 16);
-                        PreLifeTime += (*p++ << 8);
-                        PreLifeTime += (*p++);
-                        ValidLifeTime = (*p++ << 24);
-                        ValidLifeTime += (*p++ << 16);
-                        ValidLifeTime += (*p++ << 8);
-                        ValidLifeTime += (*p++);
-
-                        printf("IANA : %.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x \r\n", recv_IP[0], recv_IP[1], recv_IP[2], recv_IP[3], recv_IP[4], recv_IP[5], recv_IP[6], recv_IP[7], recv_IP[8], recv_IP[9], recv_IP[10], recv_IP[11], recv_IP[12], recv_IP[13], recv_IP[14], recv_IP[15]);
-                        break;
-                    }
-
-                    case OPT_STATUS_CODE:
-                    {
-#ifdef _DHCP6_DEBUG_
-                        printf("in status code \r\n");
-#endif
-                        p++;
-                        opt_len = (*p++ << 8);
-                        statuscode_len = opt_len + (*p++);
-                        Lstatuscode_len = statuscode_len;
-#ifdef _DHCP6_DEBUG_
-                        printf("status_len : %x\r\n", statuscode_len);
-                        printf("Lstatus_len : %x\r\n", Lstatuscode_len);
-#endif
-                        code = (*p++ << 8);
-                        code = code + (*p++);
-                        //printf("status_code : %x\r\n", code);
-                        //for(i=0; i<(statuscode_len-2); i++)
-                        //    status_msg[i] = *p++;
-                        //printf("status_msg : %s \r\n", status_msg);
-
-                        p += statuscode_len - 2;
-                        break;
-                    }
-
-                    default:
-                    {
-#ifdef _DHCP6_DEBUG_
-                        printf("in default \r\n");
-#endif
-                        p++;
-                        opt_len = (*p++ << 8);
-                        opt_len = opt_len + (*p++);
-                        p += opt_len;
-                        break;
-                    }
-                    }
-                }
-                break;
-            }
-
-            case OPT_IATA:
-            {
-#ifdef _DHCP6_DEBUG_
-                printf("in iata \r\n");
-#endif
-                p++;
-                opt_len = (*p++ << 8);
-                opt_len = opt_len + (*p++);
-                //IA_TA-options
-                p += opt_len;
-                break;
-            }
-
-            case OPT_SERVERID:
-            {
-#ifdef _DHCP6_DEBUG_
-                printf("in serverid \r\n");
-#endif
-
-                p++;
-                opt_len = (*p++ << 8);
-                serverid_len = opt_len + (*p++);
-#ifdef _DHCP6_DEBUG_
-                printf("opt_len : %.4x\r\n", serverid_len);
-#endif
-                end_point = (uint32_t)p + serverid_len;
-
-                DUID_type_s = (*p++ << 8);
-                DUID_type_s = DUID_type_s + (*p++);
-#ifdef _DHCP6_DEBUG_
-                printf("DUID_type : %.4x\r\n", DUID_type_s);
-#endif
-                if (DUID_type_s == 0x02)
-                {
-                    Enterprise_num_s = (*p++ << 24);
-                    Enterprise_num_s = Enterprise_num_s + (*p++ << 16);
-                    Enterprise_num_s = Enterprise_num_s + (*p++ << 8);
-                    Enterprise_num_s = Enterprise_num_s + (*p++);
-                }
-                else
-                {
-                    Hardware_type_s = (*p++ << 8);
-                    Hardware_type_s = Hardware_type_s + (*p++);
-#ifdef _DHCP6_DEBUG_
-                    printf("Hardware_type : %.4x\r\n", Hardware_type_s);
-#endif
-                }
-
-                if (DUID_type_s == 0x01)
-                {
-                    Time_s[0] = *p++;
-                    Time_s[1] = *p++;
-                    Time_s[2] = *p++;
-                    Time_s[3] = *p++;
-#ifdef _DHCP6_DEBUG_
-                    printf("Time : ");
-                    for (i = 0; i < 4; i++)
-                        printf("%.2x", Time_s[i]);
-                    printf("\r\n");
-#endif
-                }
-
-                Server_MAC[0] = *p++;
-                Server_MAC[1] = *p++;
-                Server_MAC[2] = *p++;
-                Server_MAC[3] = *p++;
-                Server_MAC[4] = *p++;
-                Server_MAC[5] = *p++;
-
-#ifdef _DHCP6_DEBUG_
-                printf("Server_MAC : ");
-                for (i = 0; i < 6; i++)
-                    printf("%.2x", Server_MAC[i]);
-                printf("\r\n");
-#endif
-                while ((uint32_t)p != end_point)
-                {
-                    p++;
-                }
-                break;
-            }
-
-            case DNS_RecursiveNameServer:
-            {
-#ifdef _DHCP6_DEBUG_
-                printf("in DNS Recursive Name Server \r\n");
-#endif
-                p++;
-                opt_len = (*p++ << 8);
-                opt_len = opt_len + (*p++);
-                end_point = (uint32_t)p + opt_len;
-
-                DNS6_Address[0] = *p++;
-                DNS6_Address[1] = *p++;
-                DNS6_Address[2] = *p++;
-                DNS6_Address[3] = *p++;
-                DNS6_Address[4] = *p++;
-                DNS6_Address[5] = *p++;
-                DNS6_Address[6] = *p++;
-                DNS6_Address[7] = *p++;
-                DNS6_Address[8] = *p++;
-                DNS6_Address[9] = *p++;
-                DNS6_Address[10] = *p++;
-                DNS6_Address[11] = *p++;
-                DNS6_Address[12] = *p++;
-                DNS6_Address[13] = *p++;
-                DNS6_Address[14] = *p++;
-                DNS6_Address[15] = *p++;
-
-                while ((uint32_t)p < end_point)
-                {
-                    p++;
-                }
-
-                break;
-            }
-
-            case Domain_Search_List:
-            {
-#ifdef _DHCP6_DEBUG_
-                printf("in Domain Search List \r\n");
-#endif
-                p++;
-                opt_len = (*p++ << 8);
-                opt_len = opt_len + (*p++);
-                end_point = (uint32_t)p + opt_len;
+            p = sub[DHCP6_O_IAADDR].val;
+            iaaddr_len = sub[DHCP6_O_IAADDR].len;
+            memcpy(recv_IP, p, 16);
+            PreLifeTime = dhcp6_get32(p + 16);
+            ValidLifeTime = dhcp6_get32(p + 20);
+        }
+        if (sub[DHCP6_O_STATUS].val && (sub[DHCP6_O_STATUS].len >= 2))
+        {
+            statuscode_len = sub[DHCP6_O_STATUS].len;
+            Lstatuscode_len = statuscode_len;
+            code = dhcp6_get16(sub[DHCP6_O_STATUS].val);
+            if (code)
+                success = 0;
+        }
+        dhcp6_rx_bound = success && sub[DHCP6_O_IAADDR].val && (sub[DHCP6_O_IAADDR].len >= 24);
+    }
 
-                while ((uint32_t)p < end_point)
-                {
-                    p++;
-                }
+    if (opt[DHCP6_O_SERVERID].val && (opt[DHCP6_O_SERVERID].len >= 4))
+    {
+        p = opt[DHCP6_O_SERVERID].val;
+        serverid_len = opt[DHCP6_O_SERVERID].len;
+        DUID_type_s = dhcp6_get16(p);
+        n = 2;
+        if (DUID_type_s == 0x02)
+        {
+            if (serverid_len >= 6)
+                Enterprise_num_s = dhcp6_get32(p + 2);
+            n += 4;
+        }
+        else
+        {
+            Hardware_type_s = dhcp6_get16(p + 2);
+            n += 2;
+        }
+        if ((DUID_type_s == 0x01) && (serverid_len >= n + 4))
+        {
+            memcpy(Time_s, p + n, 4);
+            n += 4;
+        }
+        if (serverid_len >= n + 6)
+            memcpy(Server_MAC, p + n, 6);
+    }
 
-                break;
-            }
+    if (opt[DHCP6_O_DNS].val && (opt[DHCP6_O_DNS].len >= 16))
+        memcpy(DNS6_Address, opt[DHCP6_O_DNS].val, 16);
 
-            default:
-            {
 #ifdef _DHCP6_DEBUG_
-                printf("in default \r\n");
+    printf("type %d, IANA : %.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x:%.2x%.2x \r\n", pDHCPMSG.OPT[0], recv_IP[0], recv_IP[1], recv_IP[2], recv_IP[3], recv_IP[4], recv_IP[5], recv_IP[6], recv_IP[7], recv_IP[8], recv_IP[9], recv_IP[10], recv_IP[11], recv_IP[12], recv_IP[13], recv_IP[14], recv_IP[15]);
 #endif
-                p++;
-                opt_len = (*p++ << 8);
-                opt_len = opt_len + (*p++);
-                p += opt_len;
-                break;
-            }
-            }
-        }
-    }
-    }
-    return type;
+    return pDHCPMSG.OPT[0];
 }
 
 /**
@@ -1142,6 +1032,17 @@ uint8_t DHCP_run(wiz_NetInfo *netinfo)
                 return 0;
             }
             dhcp_state = STATE_DHCP6_REQUEST;
+        }
+        else if ((type == DHCP6_REPLY) && dhcp6_rx_xid && dhcp6_rx_rapid && dhcp6_rx_bound)
+        {
+            // REPLY to SOLICIT with Rapid Commit, the address is committed already
+#ifdef _DHCP6_DEBUG_
+            printf("> Receive DHCP_REPLY with Rapid Commit\r\n");
+#endif
+            memcpy(DHCP_allocated_ip, recv_IP, 16);
+            memcpy(netinfo->gua, recv_IP, 16);
+            dhcp_state = STATE_DHCP6_REQUEST;
+            return DHCP_IP_LEASED;
         } //else ret = check_DHCP_timeout();
         break;
     case STATE_DHCP6_REQUEST:
@@ -1158,6 +1059,663 @@ uint8_t DHCP_run(wiz_NetInfo *netinfo)
     return ret;
 }
 
+/*
+ * DHCPv6 event driven client, DHCP_poll()
+ */
+
+/* Transmission parameters in ms (cf. RFC8415 7.6) */
+#define DHCP6_SOL_MAX_DELAY 1000    ///< Max delay of first SOLICIT
+#define DHCP6_SOL_TIMEOUT   1000    ///< Initial SOLICIT timeout
+#define DHCP6_SOL_MAX_RT    3600000 ///< Max SOLICIT timeout value
+#define DHCP6_REQ_TIMEOUT   1000    ///< Initial REQUEST timeout
+#define DHCP6_REQ_MAX_RT    30000   ///< Max REQUEST timeout value
+#define DHCP6_REQ_MAX_RC    10      ///< Max REQUEST retry attempts
+#define DHCP6_REN_TIMEOUT   10000   ///< Initial RENEW timeout
+#define DHCP6_REN_MAX_RT    600000  ///< Max RENEW timeout value
+#define DHCP6_REB_TIMEOUT   10000   ///< Initial REBIND timeout
+#define DHCP6_REB_MAX_RT    600000  ///< Max REBIND timeout value
+
+#define DHCP6_MAX_DUID      64         ///< Max length of server DUID kept
+#define DHCP6_INFINITY      0xffffffff ///< Infinite lifetime
+
+/* Status codes */
+#define DHCP6_STATUS_SUCCESS    0
+#define DHCP6_STATUS_NOBINDING  3
+#define DHCP6_STATUS_USEMULTI   5
+
+/* Message template. Options are laid out once by DHCP_init(), an exchange patches type, xid and the tail,
+ * and a retransmission patches only the elapsed time. */
+#define DHCP6_OFF_ELAPSED   4   ///< Elapsed Time, 6 bytes
+#define DHCP6_OFF_CLIENTID  10  ///< Client Identifier of DUID-LL, 14 bytes
+#define DHCP6_OFF_ORO       24  ///< Option Request for DNS servers, 6 bytes
+#define DHCP6_OFF_IANA      30  ///< IA_NA header, 16 bytes
+#define DHCP6_OFF_IAADDR    46  ///< IA Address in IA_NA, 28 bytes. Rapid Commit of SOLICIT, 4 bytes
+#define DHCP6_OFF_SERVERID  74  ///< Server Identifier, end of REBIND
+#define DHCP6_TMPL_SIZE     (DHCP6_OFF_SERVERID + 4 + DHCP6_MAX_DUID)
+
+/* Lease timers of DHCP_poll() */
+#define DHCP6_L_T1          0x01
+#define DHCP6_L_T2          0x02
+#define DHCP6_L_VALID       0x04
+
+/*
+ * @brief Reply and Advertise message parsed by dhcp6_parse()
+ */
+typedef struct
+{
+    uint8_t  type;        ///< DHCP6_ADVERTISE or DHCP6_REPLY
+    uint8_t  has_addr;    ///< IA_NA has IA Address
+    uint8_t  rapid;       ///< Rapid Commit option
+    uint8_t  pref;        ///< Preference option, 0 if none
+    uint16_t status;      ///< Status code of the message or IA_NA
+    uint32_t t1;          ///< T1 of IA_NA
+    uint32_t t2;          ///< T2 of IA_NA
+    uint32_t pref_life;   ///< Preferred lifetime of IA Address
+    uint32_t valid_life;  ///< Valid lifetime of IA Address
+    uint8_t  addr[16];    ///< IA Address
+    uint8_t* dns;         ///< First DNS server in the message, NULL if none
+    uint8_t* srvid;       ///< Server DUID in the message
+    uint16_t srvid_len;
+} dhcp6_reply_t;
+
+static uint8_t  dhcp6_tmpl[DHCP6_TMPL_SIZE];
+static uint16_t dhcp6_tmpl_len;             // length of the message of the exchange
+static uint8_t  dhcp6_srvid[DHCP6_MAX_DUID]; // DUID of the selected server
+static uint16_t dhcp6_srvid_len = 0;
+static uint8_t  dhcp6_offer_ip[16];         // address of the best ADVERTISE
+static int16_t  dhcp6_offer_pref = -1;      // preference of the best ADVERTISE, -1 if none
+
+static uint32_t dhcp6_now = 0;              // 1s tick, never reset
+static uint32_t (*dhcp6_clock_ms)(void) = 0;
+static uint32_t dhcp6_seed = 1;
+
+static uint8_t  dhcp6_rt_on = 0;            // retransmission timer is running
+static uint32_t dhcp6_rt_at;                // ms of the next retransmission
+static uint32_t dhcp6_rt;                   // current retransmission timeout in ms
+static uint32_t dhcp6_mrt;                  // max retransmission timeout in ms, 0 if none
+static uint8_t  dhcp6_mrc;                  // max retransmission count, 0 if none
+static uint8_t  dhcp6_rc;                   // retransmission count of the exchange
+static uint32_t dhcp6_start_ms;             // first transmission of the exchange
+
+static uint8_t  dhcp6_lease_on = 0;         // DHCP6_L_xx of the lease timers running
+static uint32_t dhcp6_t1_at;
+static uint32_t dhcp6_t2_at;
+static uint32_t dhcp6_expire_at;
+static uint32_t dhcp6_valid_life = 0;
+
+/* The default handler of ip assign and update, and of ip expired or withdrawn */
+void default_ipv6_assign(void);
+void default_ipv6_expire(void);
+
+void (*dhcp_ipv6_assign)(void) = default_ipv6_assign; /* handler to be called when the IP address from DHCP server is first assigned */
+void (*dhcp_ipv6_update)(void) = default_ipv6_assign; /* handler to be called when the IP address from DHCP server is updated */
+void (*dhcp_ipv6_expire)(void) = default_ipv6_expire; /* handler to be called when the IP address from DHCP server expired or is withdrawn */
+
+void default_ipv6_assign(void)
+{
+    setGUAR(DHCP_allocated_ip);
+}
+
+void default_ipv6_expire(void)
+{
+    uint8_t zero[16] = {0, };
+    setGUAR(zero);
+}
+
+void reg_dhcpv6_cbfunc(void (*ip_assign)(void), void (*ip_update)(void), void (*ip_expire)(void))
+{
+    dhcp_ipv6_assign = ip_assign ? ip_assign : default_ipv6_assign;
+    dhcp_ipv6_update = ip_update ? ip_update : default_ipv6_assign;
+    dhcp_ipv6_expire = ip_expire ? ip_expire : default_ipv6_expire;
+}
+
+void reg_dhcpv6_clock_cbfunc(uint32_t (*clock_ms)(void))
+{
+    dhcp6_clock_ms = clock_ms;
+}
+
+static uint32_t dhcp6_ms(void)
+{
+    return dhcp6_clock_ms ? dhcp6_clock_ms() : dhcp6_now * 1000;
+}
+
+static uint32_t dhcp6_rand(void)
+{
+    dhcp6_seed = dhcp6_seed * 1103515245UL + 12345UL;
+    return dhcp6_seed >> 16;
+}
+
+/* RAND * base, RAND is uniform in -0.1 ~ +0.1 */
+static int32_t dhcp6_rand_delta(uint32_t base)
+{
+    uint32_t r = base / 10;
+    return (int32_t)(dhcp6_rand() % (2 * r + 1)) - (int32_t)r;
+}
+
+static void dhcp6_put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+/* Lay out the options kept over all messages */
+static void dhcp6_make_template(void)
+{
+    uint8_t *p = dhcp6_tmpl;
+
+    memset(dhcp6_tmpl, 0, sizeof(dhcp6_tmpl));
+    // Elapsed Time
+    dhcp6_put16(p + DHCP6_OFF_ELAPSED, OPT_ELAPSED_TIME);
+    dhcp6_put16(p + DHCP6_OFF_ELAPSED + 2, 2);
+    // Client Identifier, DUID-LL of ethernet
+    p += DHCP6_OFF_CLIENTID;
+    dhcp6_put16(p, OPT_CLIENTID);
+    dhcp6_put16(p + 2, 10);
+    dhcp6_put16(p + 4, 0x0003);
+    dhcp6_put16(p + 6, 0x0001);
+    memcpy(p + 8, DHCP_CHADDR, 6);
+    // Option Request
+    p = dhcp6_tmpl + DHCP6_OFF_ORO;
+    dhcp6_put16(p, OPT_REQUEST);
+    dhcp6_put16(p + 2, 2);
+    dhcp6_put16(p + 4, DNS_RecursiveNameServer);
+    // IA_NA, IAID from MAC address. T1 and T2 are 0 as no preference
+    p = dhcp6_tmpl + DHCP6_OFF_IANA;
+    dhcp6_put16(p, OPT_IANA);
+    memcpy(p + 4, DHCP_CHADDR + 2, 4);
+}
+
+/* Send the message of the exchange with the elapsed time patched */
+static void dhcp6_send(void)
+{
+    uint8_t ip[16] = {0xff, 0x02, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x00, 0x02}; // All_DHCP_Relay_Agents_and_Servers
+    uint32_t elapsed = (dhcp6_rc == 0) ? 0 : (dhcp6_ms() - dhcp6_start_ms) / 10;
+
+    if (elapsed > 0xffff)
+        elapsed = 0xffff;
+    dhcp6_put16(dhcp6_tmpl + DHCP6_OFF_ELAPSED + 4, (uint16_t)elapsed);
+#ifdef _DHCP6_DEBUG_
+    printf("> Send DHCPv6 type %d, rc %d\r\n", dhcp6_tmpl[0], dhcp6_rc);
+#endif
+    wiz_sendto(DHCP_SOCKET, dhcp6_tmpl, dhcp6_tmpl_len, ip, DHCP_SERVER_PORT, 16);
+}
+
+static void dhcp6_set_rt(uint32_t rt)
+{
+    dhcp6_rt = rt;
+    dhcp6_rt_at = dhcp6_ms() + rt;
+    dhcp6_rt_on = 1;
+}
+
+/* Start new exchange of the message type on the template, and send the first one (cf. RFC8415 15) */
+static void dhcp6_start_exchange(uint8_t state, uint8_t type, uint32_t irt, uint32_t mrt, uint8_t mrc)
+{
+    uint8_t *p;
+
+    dhcp_state = state;
+    DHCP_XID = (DHCP_XID + 1 + dhcp6_rand()) & 0x00ffffff;
+    dhcp6_tmpl[0] = type;
+    dhcp6_tmpl[1] = (uint8_t)(DHCP_XID >> 16);
+    dhcp6_tmpl[2] = (uint8_t)(DHCP_XID >> 8);
+    dhcp6_tmpl[3] = (uint8_t)DHCP_XID;
+
+    p = dhcp6_tmpl + DHCP6_OFF_IANA;
+    if (type == DHCP6_SOLICIT)
+    {
+        dhcp6_put16(p + 2, 12);
+        dhcp6_tmpl_len = DHCP6_OFF_IAADDR;
+#if DHCP6_RAPID_COMMIT
+        p = dhcp6_tmpl + DHCP6_OFF_IAADDR;
+        dhcp6_put16(p, OPT_RAPID_COMMIT);
+        dhcp6_put16(p + 2, 0);
+        dhcp6_tmpl_len += 4;
+#endif
+    }
+    else
+    {
+        // IA Address of the lease or the selected ADVERTISE, lifetimes are 0 as no preference
+        dhcp6_put16(p + 2, 12 + 28);
+        p = dhcp6_tmpl + DHCP6_OFF_IAADDR;
+        dhcp6_put16(p, OPT_IAADDR);
+        dhcp6_put16(p + 2, 24);
+        memcpy(p + 4, DHCP_allocated_ip, 16);
+        memset(p + 20, 0, 8);
+        dhcp6_tmpl_len = DHCP6_OFF_SERVERID;
+        if (type != DHCP6_REBIND)
+        {
+            p = dhcp6_tmpl + DHCP6_OFF_SERVERID;
+            dhcp6_put16(p, OPT_SERVERID);
+            dhcp6_put16(p + 2, dhcp6_srvid_len);
+            memcpy(p + 4, dhcp6_srvid, dhcp6_srvid_len);
+            dhcp6_tmpl_len += 4 + dhcp6_srvid_len;
+        }
+    }
+
+    dhcp6_mrt = mrt;
+    dhcp6_mrc = mrc;
+    dhcp6_rc = 0;
+    dhcp6_start_ms = dhcp6_ms();
+    dhcp6_send();
+    // The first RT of SOLICIT is greater than IRT
+    if (type == DHCP6_SOLICIT)
+        dhcp6_set_rt(irt + 1 + dhcp6_rand() % (irt / 10));
+    else
+        dhcp6_set_rt(irt + dhcp6_rand_delta(irt));
+}
+
+/* Retransmit the message of the exchange, and back off the timeout */
+static void dhcp6_retransmit(void)
+{
+    uint32_t rt = 2 * dhcp6_rt + dhcp6_rand_delta(dhcp6_rt);
+
+    if (dhcp6_mrt && (rt > dhcp6_mrt))
+        rt = dhcp6_mrt + dhcp6_rand_delta(dhcp6_mrt);
+    dhcp6_rc++;
+    dhcp6_send();
+    dhcp6_set_rt(rt);
+}
+
+/* Parse ADVERTISE or REPLY for the exchange, and return its type or 0 if it is not */
+static uint8_t dhcp6_parse(uint8_t *msg, uint16_t len, dhcp6_reply_t *r)
+{
+    dhcp6_opt_t opt[DHCP6_O_NUM];
+    dhcp6_opt_t sub[DHCP6_O_NUM];
+    uint16_t ilen;
+    uint8_t *p;
+
+    memset(r, 0, sizeof(dhcp6_reply_t));
+    if (len < 4)
+        return 0;
+    if ((msg[0] != DHCP6_ADVERTISE) && (msg[0] != DHCP6_REPLY))
+        return 0;
+    if (memcmp(msg + 1, dhcp6_tmpl + 1, 3) != 0)
+        return 0; // transaction ID
+    if (dhcp6_scan(msg + 4, len - 4, opt) < 0)
+        return 0;
+
+    p = opt[DHCP6_O_CLIENTID].val;
+    if ((p == 0) || (opt[DHCP6_O_CLIENTID].len != 10) || (memcmp(p, dhcp6_tmpl + DHCP6_OFF_CLIENTID + 4, 10) != 0))
+        return 0;
+    r->srvid = opt[DHCP6_O_SERVERID].val;
+    r->srvid_len = opt[DHCP6_O_SERVERID].len;
+    if ((r->srvid == 0) || (r->srvid_len > DHCP6_MAX_DUID))
+        return 0;
+    if (opt[DHCP6_O_PREFERENCE].len >= 1)
+        r->pref = opt[DHCP6_O_PREFERENCE].val[0];
+    r->rapid = (opt[DHCP6_O_RAPID].val != 0);
+    if (opt[DHCP6_O_STATUS].len >= 2)
+        r->status = dhcp6_get16(opt[DHCP6_O_STATUS].val);
+    if (opt[DHCP6_O_DNS].len >= 16)
+        r->dns = opt[DHCP6_O_DNS].val;
+
+    // IA_NA of my IAID. dhcp6_scan() keeps the first IA_NA, and a server may send one for each IAID
+    p = opt[DHCP6_O_IANA].val;
+    ilen = opt[DHCP6_O_IANA].len;
+    if (p && ((ilen < 4) || (memcmp(p, dhcp6_tmpl + DHCP6_OFF_IANA + 4, 4) != 0)))
+        p = dhcp6_find(msg + 4, len - 4, OPT_IANA, dhcp6_tmpl + DHCP6_OFF_IANA + 4, 4, &ilen);
+    if (p && (ilen >= 12))
+    {
+        r->t1 = dhcp6_get32(p + 4);
+        r->t2 = dhcp6_get32(p + 8);
+        // T1 greater than T2 is invalid, so the IA_NA and the message are discarded (cf. RFC8415 21.4)
+        if ((r->t1 != 0) && (r->t2 != 0) && (r->t1 > r->t2))
+            return 0;
+        if (dhcp6_scan(p + 12, ilen - 12, sub) < 0)
+            return 0;
+        if (sub[DHCP6_O_IAADDR].len >= 24)
+        {
+            p = sub[DHCP6_O_IAADDR].val;
+            memcpy(r->addr, p, 16);
+            r->pref_life = dhcp6_get32(p + 16);
+            r->valid_life = dhcp6_get32(p + 20);
+            r->has_addr = 1;
+        }
+        if (sub[DHCP6_O_STATUS].len >= 2)
+            r->status = dhcp6_get16(sub[DHCP6_O_STATUS].val);
+    }
+    r->type = msg[0];
+    return r->type;
+}
+
+/* Take the lease of REPLY, and set T1, T2 and the valid lifetime from now (cf. RFC8415 21.4) */
+static uint8_t dhcp6_bind(dhcp6_reply_t *r)
+{
+    uint8_t ret = DHCP_IP_LEASED;
+    uint32_t t1 = r->t1;
+    uint32_t t2 = r->t2;
+
+    if (dhcp6_valid_life == 0)
+        ret = DHCP_IP_ASSIGN; // no address held
+    else if (memcmp(DHCP_allocated_ip, r->addr, 16) != 0)
+        ret = DHCP_IP_CHANGED;
+
+    memcpy(DHCP_allocated_ip, r->addr, 16);
+    memcpy(dhcp6_srvid, r->srvid, r->srvid_len);
+    dhcp6_srvid_len = r->srvid_len;
+    if (r->dns)
+        memcpy(DNS6_Address, r->dns, 16);
+
+    // The client chooses T1 and T2 from the preferred lifetime when the server leaves them
+    if ((t1 == 0) || (t2 == 0))
+    {
+        if (r->pref_life == DHCP6_INFINITY)
+            t1 = t2 = DHCP6_INFINITY;
+        else
+        {
+            t1 = r->pref_life / 2;
+            t2 = r->pref_life - r->pref_life / 5;
+        }
+    }
+    dhcp6_valid_life = r->valid_life;
+    dhcp6_lease_on = 0;
+    if (t1 != DHCP6_INFINITY)
+    {
+        dhcp6_t1_at = dhcp6_now + t1;
+        dhcp6_lease_on |= DHCP6_L_T1;
+    }
+    if (t2 != DHCP6_INFINITY)
+    {
+        dhcp6_t2_at = dhcp6_now + t2;
+        dhcp6_lease_on |= DHCP6_L_T2;
+    }
+    if (r->valid_life != DHCP6_INFINITY)
+    {
+        dhcp6_expire_at = dhcp6_now + r->valid_life;
+        dhcp6_lease_on |= DHCP6_L_VALID;
+    }
+    dhcp6_rt_on = 0;
+    dhcp_state = STATE_DHCP6_LEASED;
+#ifdef _DHCP6_DEBUG_
+    printf("> DHCPv6 leased, T1 %lu, T2 %lu, valid %lu\r\n", (unsigned long)t1, (unsigned long)t2, (unsigned long)r->valid_life);
+#endif
+
+    if (ret == DHCP_IP_ASSIGN)
+        dhcp_ipv6_assign();
+    else if (ret == DHCP_IP_CHANGED)
+        dhcp_ipv6_update();
+    return ret;
+}
+
+/* Select the server of ADVERTISE, and start REQUEST */
+static void dhcp6_request_offer(void)
+{
+    memcpy(DHCP_allocated_ip, dhcp6_offer_ip, 16);
+    dhcp6_offer_pref = -1;
+    dhcp6_start_exchange(STATE_DHCP6_REQUEST, DHCP6_REQUEST, DHCP6_REQ_TIMEOUT, DHCP6_REQ_MAX_RT, DHCP6_REQ_MAX_RC);
+}
+
+/* Restart from SOLICIT at once */
+static void dhcp6_restart(void)
+{
+    dhcp6_lease_on = 0;
+    dhcp6_valid_life = 0;
+    dhcp6_offer_pref = -1;
+    dhcp_state = STATE_DHCP6_INIT;
+    dhcp6_set_rt(0);
+}
+
+/* Process the message received in DHCP_poll() */
+static uint8_t dhcp6_input(dhcp6_reply_t *r)
+{
+    uint8_t ret = DHCP_RUNNING;
+    uint8_t ok = r->has_addr && (r->valid_life != 0) && (r->status == DHCP6_STATUS_SUCCESS);
+
+    switch (dhcp_state)
+    {
+    case STATE_DHCP6_SOLICIT:
+        // The server committed the address to Rapid Commit, two messages in place of four (cf. RFC8415 18.2.1)
+        if ((r->type == DHCP6_REPLY) && r->rapid && ok)
+        {
+            ret = dhcp6_bind(r);
+            break;
+        }
+        if ((r->type != DHCP6_ADVERTISE) || !ok)
+            break;
+        // Keep the most preferred server
+        if ((int16_t)r->pref > dhcp6_offer_pref)
+        {
+            memcpy(dhcp6_offer_ip, r->addr, 16);
+            memcpy(dhcp6_srvid, r->srvid, r->srvid_len);
+            dhcp6_srvid_len = r->srvid_len;
+            dhcp6_offer_pref = r->pref;
+        }
+        // Collect ADVERTISE for the first RT, unless the server has the highest preference
+        if ((r->pref == 255) || (dhcp6_rc > 0))
+            dhcp6_request_offer();
+        break;
+
+    case STATE_DHCP6_REQUEST:
+    case STATE_DHCP6_RENEW:
+    case STATE_DHCP6_REBIND:
+        if (r->type != DHCP6_REPLY)
+            break;
+        if (ok)
+            ret = dhcp6_bind(r);
+        else if (r->status == DHCP6_STATUS_USEMULTI)
+            break; // sent to multicast already, keep retransmission
+        else if (dhcp_state == STATE_DHCP6_REQUEST)
+            dhcp6_restart(); // NoAddrsAvail or NotOnLink
+        else if (r->status == DHCP6_STATUS_NOBINDING)
+        {
+            // The server lost the binding, so request it again
+            memcpy(dhcp6_srvid, r->srvid, r->srvid_len);
+            dhcp6_srvid_len = r->srvid_len;
+            dhcp6_start_exchange(STATE_DHCP6_REQUEST, DHCP6_REQUEST, DHCP6_REQ_TIMEOUT, DHCP6_REQ_MAX_RT, DHCP6_REQ_MAX_RC);
+        }
+        else if (r->has_addr && (r->valid_life == 0))
+        {
+            ret = DHCP_FAILED; // the address is withdrawn
+            dhcp_ipv6_expire();
+            dhcp6_restart();
+        }
+        if ((ret == DHCP_RUNNING) && (dhcp_state != STATE_DHCP6_REQUEST) && (dhcp_state != STATE_DHCP6_INIT))
+            ret = DHCP_IP_LEASED;
+        break;
+
+    default:
+        break;
+    }
+    return ret;
+}
+
+/* Process the retransmission timer due in DHCP_poll() */
+static uint8_t dhcp6_timeout(void)
+{
+    uint8_t ret = DHCP_RUNNING;
+
+    switch (dhcp_state)
+    {
+    case STATE_DHCP6_INIT:
+        memset(DHCP_allocated_ip, 0, 16);
+        dhcp6_offer_pref = -1;
+        dhcp6_start_exchange(STATE_DHCP6_SOLICIT, DHCP6_SOLICIT, DHCP6_SOL_TIMEOUT, DHCP6_SOL_MAX_RT, 0);
+        break;
+    case STATE_DHCP6_SOLICIT:
+        if (dhcp6_offer_pref >= 0)
+            dhcp6_request_offer();
+        else
+            dhcp6_retransmit();
+        break;
+    case STATE_DHCP6_REQUEST:
+        if (dhcp6_rc >= dhcp6_mrc)
+        {
+            ret = DHCP_FAILED;
+            dhcp6_restart();
+        }
+        else
+            dhcp6_retransmit();
+        break;
+    case STATE_DHCP6_RENEW:
+    case STATE_DHCP6_REBIND:
+        ret = DHCP_IP_LEASED;
+        dhcp6_retransmit(); // until T2 or the valid lifetime
+        break;
+    default:
+        break;
+    }
+    return ret;
+}
+
+/* Check the lease timers in seconds, and return DHCP_FAILED when the address expired */
+static uint8_t dhcp6_lease_timer(void)
+{
+    if ((dhcp6_lease_on & DHCP6_L_VALID) && ((int32_t)(dhcp6_now - dhcp6_expire_at) >= 0))
+    {
+#ifdef _DHCP6_DEBUG_
+        printf("> DHCPv6 lease expired\r\n");
+#endif
+        dhcp_ipv6_expire();
+        dhcp6_restart();
+        return DHCP_FAILED;
+    }
+    if ((dhcp_state == STATE_DHCP6_LEASED) && (dhcp6_lease_on & DHCP6_L_T1) && ((int32_t)(dhcp6_now - dhcp6_t1_at) >= 0))
+        dhcp6_start_exchange(STATE_DHCP6_RENEW, DHCP6_RENEW, DHCP6_REN_TIMEOUT, DHCP6_REN_MAX_RT, 0);
+    if (((dhcp_state == STATE_DHCP6_LEASED) || (dhcp_state == STATE_DHCP6_RENEW)) &&
+        (dhcp6_lease_on & DHCP6_L_T2) && ((int32_t)(dhcp6_now - dhcp6_t2_at) >= 0))
+        dhcp6_start_exchange(STATE_DHCP6_REBIND, DHCP6_REBIND, DHCP6_REB_TIMEOUT, DHCP6_REB_MAX_RT, 0);
+    return DHCP_RUNNING;
+}
+
+/* Seconds to the lease timer of the state, DHCP6_INFINITY if none */
+static uint32_t dhcp6_lease_left(void)
+{
+    uint32_t left = DHCP6_INFINITY;
+    uint32_t at;
+
+    if ((dhcp_state != STATE_DHCP6_LEASED) && (dhcp_state != STATE_DHCP6_RENEW) && (dhcp_state != STATE_DHCP6_REBIND))
+        return left;
+    if (dhcp6_lease_on & DHCP6_L_VALID)
+        left = ((int32_t)(dhcp6_expire_at - dhcp6_now) > 0) ? dhcp6_expire_at - dhcp6_now : 0;
+    if ((dhcp_state == STATE_DHCP6_LEASED) && (dhcp6_lease_on & DHCP6_L_T1))
+    {
+        at = ((int32_t)(dhcp6_t1_at - dhcp6_now) > 0) ? dhcp6_t1_at - dhcp6_now : 0;
+        if (at < left)
+            left = at;
+    }
+    if ((dhcp_state != STATE_DHCP6_REBIND) && (dhcp6_lease_on & DHCP6_L_T2))
+    {
+        at = ((int32_t)(dhcp6_t2_at - dhcp6_now) > 0) ? dhcp6_t2_at - dhcp6_now : 0;
+        if (at < left)
+            left = at;
+    }
+    return left;
+}
+
+uint8_t DHCP_poll(uint8_t events)
+{
+    dhcp6_reply_t r;
+    datasize_t len;
+    datasize_t remain;
+    uint8_t svr_addr[16];
+    uint16_t svr_port;
+    uint8_t addlen;
+    uint8_t drop[32];
+    uint8_t ret, tmp;
+
+    if (dhcp_state == STATE_DHCP6_STOP)
+        return DHCP_STOPPED;
+
+    if ((dhcp_state == STATE_DHCP6_LEASED) || (dhcp_state == STATE_DHCP6_RENEW) || (dhcp_state == STATE_DHCP6_REBIND))
+        ret = DHCP_IP_LEASED;
+    else
+        ret = DHCP_RUNNING;
+
+    if (events & SIK_RECEIVED)
+    {
+        while (getSn_RX_RSR(DHCP_SOCKET) > 0)
+        {
+            len = wiz_recvfrom(DHCP_SOCKET, pDHCPMSG.OPT, DHCP6_MAX_MSG_SIZE, svr_addr, &svr_port, &addlen);
+            if (len <= 0)
+                break;
+            if ((uint16_t)len > dhcp6_msg_peak)
+                dhcp6_msg_peak = (uint16_t)len;
+            // Drop the rest over the buffer
+            while ((getsockopt(DHCP_SOCKET, SO_REMAINSIZE, &remain) == SOCK_OK) && (remain > 0))
+            {
+                if (wiz_recvfrom(DHCP_SOCKET, drop, sizeof(drop), svr_addr, &svr_port, &addlen) <= 0)
+                    break;
+            }
+            if ((svr_port == DHCP_SERVER_PORT) && dhcp6_parse(pDHCPMSG.OPT, (uint16_t)len, &r))
+                ret = dhcp6_input(&r);
+        }
+    }
+
+    if (dhcp6_lease_on)
+    {
+        tmp = dhcp6_lease_timer();
+        if (tmp == DHCP_FAILED)
+            ret = tmp;
+    }
+
+    if (dhcp6_rt_on && ((int32_t)(dhcp6_ms() - dhcp6_rt_at) >= 0))
+    {
+        dhcp6_rt_on = 0;
+        if (getSn_SR(DHCP_SOCKET) != SOCK_UDP)
+        {
+            WIZCHIP_WRITE(_Sn_TTLR_(DHCP_SOCKET), 0x01); // hop limit 1
+            wiz_socket(DHCP_SOCKET, (Sn_MR_UDP6), DHCP_CLIENT_PORT, 0x00);
+        }
+        tmp = dhcp6_timeout();
+        if ((tmp != DHCP_RUNNING) || (ret == DHCP_IP_LEASED))
+            ret = tmp;
+    }
+    return ret;
+}
+
+uint16_t DHCP_get_msg_peak(void)
+{
+    return dhcp6_msg_peak;
+}
+
+uint16_t DHCP_get_tmpl_size(void)
+{
+    return (uint16_t)sizeof(dhcp6_tmpl);
+}
+
+uint32_t DHCP_next_deadline(void)
+{
+    uint32_t next = DHCP6_INFINITY;
+    uint32_t now, left;
+
+    if (dhcp_state == STATE_DHCP6_STOP)
+        return next;
+    if (dhcp6_rt_on)
+    {
+        now = dhcp6_ms();
+        next = ((int32_t)(dhcp6_rt_at - now) > 0) ? dhcp6_rt_at - now : 0;
+    }
+    left = dhcp6_lease_left();
+    if (left != DHCP6_INFINITY)
+    {
+        left = (left < (DHCP6_INFINITY / 1000)) ? left * 1000 : DHCP6_INFINITY - 1;
+        if (left < next)
+            next = left;
+    }
+    return next;
+}
+
+void getIPfromDHCPv6(uint8_t *ip)
+{
+    memcpy(ip, DHCP_allocated_ip, 16);
+}
+
+uint32_t getDHCPv6Leasetime(void)
+{
+    return dhcp6_valid_life;
+}
+
+/* Prepare DHCP_poll() in DHCP_init(), the first SOLICIT is delayed by random (cf. RFC8415 18.2.1) */
+static void dhcp6_poll_init(void)
+{
+    dhcp6_seed ^= DHCP_XID ^ ((uint32_t)DHCP_CHADDR[3] << 16) ^ ((uint32_t)DHCP_CHADDR[4] << 8) ^ DHCP_CHADDR[5];
+    dhcp6_make_template();
+    dhcp6_offer_pref = -1;
+    dhcp6_srvid_len = 0;
+    dhcp6_lease_on = 0;
+    dhcp6_valid_life = 0;
+    dhcp6_set_rt(dhcp6_rand() % DHCP6_SOL_MAX_DELAY);
+}
+
 /**
  * @brief 
  * 
@@ -1165,6 +1723,10 @@ uint8_t DHCP_run(wiz_NetInfo *netinfo)
 void DHCP_stop(void)
 {
     wiz_close(DHCP_SOCKET);
+    if (wiz_sock_owner(DHCP_SOCKET) == SOCK_OWN_DHCPV6)
+        wiz_sock_free(DHCP_SOCKET);
+    dhcp6_rt_on = 0;
+    dhcp6_lease_on = 0;
     dhcp_state = STATE_DHCP6_STOP;
 }
 
@@ -1245,13 +1807,23 @@ void DHCP_init(uint8_t s, uint8_t *buf)
     }
 
     DHCP_SOCKET = s; // SOCK_DHCP
+    // Keep s from wiz_sock_alloc() of the others, and stay stopped if it is owned by them
+    if (wiz_sock_claim(s, SOCK_OWN_DHCPV6) < 0)
+    {
+        dhcp6_rt_on = 0;
+        dhcp6_lease_on = 0;
+        dhcp_state = STATE_DHCP6_STOP;
+        return;
+    }
 
     *buf = 0;        // Just to clear the buffer
     pDHCPMSG.OPT = buf;
     DHCP_XID = 0x515789;
+    dhcp6_msg_peak = 0;
 
     reset_DHCP_timeout();
     dhcp_state = STATE_DHCP6_INIT;
+    dhcp6_poll_init();
 }
 
 /**
@@ -1272,4 +1844,5 @@ void reset_DHCP_timeout(void)
 void DHCP_time_handler(void)
 {
     dhcp_tick_1s++;
+    dhcp6_now++;
 }
@@ -46,10 +46,10 @@
 #include "socket.h"
 /*
  * @brief 
- * @details If you want to display debug & procssing message, Define _DHCP_DEBUG_ 
+ * @details If you want to display debug & procssing message, Define _DHCP6_DEBUG_ 
  * @note    If defined, it dependens on <stdio.h>
  */
-//#define _DHCP_DEBUG_
+//#define _DHCP6_DEBUG_
 
 /* Retry to processing DHCP */
 #define MAX_DHCP_RETRY 2  ///< Maxium retry count
@@ -61,6 +61,22 @@
 
 #define DCHP_HOST_NAME "WIZnet\0"
 
+/*
+ * @brief Send Rapid Commit option in SOLICIT, and take REPLY to it in place of ADVERTISE.
+ *        The client goes on with REQUEST when the server answers ADVERTISE. Define 0 not to send it.
+ */
+#ifndef DHCP6_RAPID_COMMIT
+#define DHCP6_RAPID_COMMIT 1
+#endif
+
+/*
+ * @brief Size of the buffer given to DHCP_init(). DHCP_poll() receives a message up to this size
+ *        and drops the rest of it.
+ */
+#ifndef DHCP6_MAX_MSG_SIZE
+#define DHCP6_MAX_MSG_SIZE 512
+#endif
+
 #if __cplusplus
 extern "C" {
 #endif
@@ -104,6 +120,8 @@ void DumpDhcpOption(char *sMark);
 void DHCP_Option_Select(uint8_t Option);
 /*
  * @brief DHCP client initialization (outside of the main loop)
+ * @details The socket is claimed in the SOCKET pool by wiz_sock_claim(), and given back by DHCP_stop().
+ *          If it is owned by another one, the client stays stopped.
  * @param s   - socket number
  * @param buf - buffer for procssing DHCP message
  */
@@ -130,6 +148,69 @@ uint8_t DHCP_run(wiz_NetInfo *netinfo);
  */
 uint8_t DHCP_run2(void);
 
+/*
+ * @brief Register the handlers called when the address is assigned, changed or lost by @ref DHCP_poll()
+ * @param ip_assign - handler of @ref DHCP_IP_ASSIGN. NULL sets the leased address to GUAR.
+ * @param ip_update - handler of @ref DHCP_IP_CHANGED. NULL sets the leased address to GUAR.
+ * @param ip_expire - handler called before @ref DHCP_FAILED when the valid lifetime ends or the server withdraws
+ *                    the address with valid lifetime 0. NULL clears GUAR.
+ */
+void reg_dhcpv6_cbfunc(void (*ip_assign)(void), void (*ip_update)(void), void (*ip_expire)(void));
+
+/*
+ * @brief Register ms clock for the retransmission timers of @ref DHCP_poll()
+ * @param clock_ms - free running ms counter. NULL uses the tick of @ref DHCP_time_handler() instead.
+ */
+void reg_dhcpv6_clock_cbfunc(uint32_t (*clock_ms)(void));
+
+/*
+ * @brief Event driven DHCPv6 client (cf. RFC8415), instead of polling @ref DHCP_run()
+ * @details Call it with the events of the DHCP socket from @ref wiz_poll() or @ref wiz_wait_events(),
+ *          or with 0 when @ref DHCP_next_deadline() has expired. The address is requested in IA_NA,
+ *          and renewed at T1 from the server and at T2 from any server.
+ *          SOLICIT, REQUEST, RENEW and REBIND are retransmitted with the randomized exponential backoff.\n
+ *          Messages are built once in @ref DHCP_init(), and a retransmission updates only the elapsed time.
+ *          The socket is opened at the first transmission.
+ *          When the valid lifetime ends or the address is withdrawn, it is taken off by the ip_expire handler
+ *          of @ref reg_dhcpv6_cbfunc(), and the client starts from SOLICIT again.
+ * @param events - SIK_xx of the DHCP socket. Only @ref SIK_RECEIVED is used.
+ * @return @ref DHCP_RUNNING while acquiring the address, @ref DHCP_IP_ASSIGN, @ref DHCP_IP_CHANGED or
+ *         @ref DHCP_IP_LEASED while the address is valid, @ref DHCP_FAILED when REQUEST failed or the lease expired,
+ *         and @ref DHCP_STOPPED after @ref DHCP_stop().
+ */
+uint8_t DHCP_poll(uint8_t events);
+
+/*
+ * @brief Time to the next timer of @ref DHCP_poll()
+ * @return ms to the next retransmission, T1, T2 or the end of the valid lifetime. 0 if expired already,
+ *         0xFFFFFFFF if no timer is running.
+ * @note Without @ref reg_dhcpv6_clock_cbfunc(), the retransmission timers have 1s resolution.
+ */
+uint32_t DHCP_next_deadline(void);
+
+/*
+ * @brief Get the largest message in the buffer of @ref DHCP_init() since it
+ * @return Bytes of the largest message received, or sent by @ref DHCP_run().
+ * @note @ref DHCP_poll() sends from its own template, see @ref DHCP_get_tmpl_size().
+ */
+uint16_t DHCP_get_msg_peak(void);
+
+/*
+ * @brief Get size of the static message template of @ref DHCP_poll(), kept besides the buffer of @ref DHCP_init()
+ */
+uint16_t DHCP_get_tmpl_size(void);
+
+/*
+ * @brief Get the address leased by @ref DHCP_poll()
+ * @param ip - 16 bytes to copy the address into
+ */
+void getIPfromDHCPv6(uint8_t *ip);
+
+/*
+ * @brief Get the valid lifetime of the leased address in seconds. 0xFFFFFFFF is infinity.
+ */
+uint32_t getDHCPv6Leasetime(void);
+
 /*
  * @brief Stop DHCP procssing
  * @note If you want to restart. call DHCP_init() and DHCP_run()
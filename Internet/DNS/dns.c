@@ -60,9 +60,7 @@
 #endif
 
 #define	INITRTT		2000L	/* Initial smoothed response time */
-#define	MAXCNAME	   (MAX_DOMAIN_NAME + (MAX_DOMAIN_NAME>>1))	   /* Maximum amount of cname recursion */
 
-#define	TYPE_A		1	   /* Host address */
 #define	TYPE_NS		2	   /* Name server */
 #define	TYPE_MD		3	   /* Mail destination (obsolete) */
 #define	TYPE_MF		4	   /* Mail forwarder (obsolete) */
@@ -78,11 +76,17 @@
 #define	TYPE_MINFO	14	   /* Mailbox information (experimental)*/
 #define	TYPE_MX		15	   /* Mail exchanger */
 #define	TYPE_TXT	   16	   /* Text strings */
-#define TYPE_AAAA 	28
+#define TYPE_OPT 	41    /* EDNS0 option */
 #define	TYPE_ANY	   255	/* Matches any type */
 
 #define	CLASS_IN	   1	   /* The ARPA Internet */
 
+#if DNS_EDNS0_SIZE > 0
+#define DNS_OPT_LEN    11    /* Size of EDNS0 OPT record without option */
+#else
+#define DNS_OPT_LEN    0
+#endif
+
 /* Round trip timing parameters */
 #define	AGAIN	      8     /* Average RTT gain = 1/8 */
 #define	LAGAIN      3     /* Log2(AGAIN) */
@@ -123,6 +127,98 @@ uint16_t DNS_MSGID;     // DNS message ID
 uint32_t dns_1s_tick;   // for timout of DNS processing
 static uint8_t retry_count;
 
+/* State of DNS_query() */
+#define DNS_Q_FREE      0
+#define DNS_Q_SENT      1     /* Query message is sent for it */
+#define DNS_Q_JOINED    2     /* Waits the answer of other query with the same name and type */
+#define DNS_Q_DONE      3     /* Its callback is running */
+
+#define DNS_F_LIST      0x01  /* Sent to the servers of DNS_add_server() */
+#define DNS_F_RESOLVE   0x02  /* A or AAAA half of DNS_resolve() */
+#define DNS_F_REPORTED  0x04  /* The other half reported the result of DNS_resolve() */
+#define DNS_F_LAST      0x08  /* The other half failed already */
+
+#define DNS_NO_PAIR     0xFF  /* pair of a completed DNS_F_RESOLVE half */
+
+typedef struct
+{
+	uint8_t  state;
+	uint8_t  flags;
+	uint8_t  retry;
+	uint8_t  srv;         /* Index of the server for DNS_F_LIST */
+	uint8_t  tried;       /* Servers tried for DNS_F_LIST. Bit n is server n */
+	uint8_t  pair;        /* Index of the other half for DNS_F_RESOLVE */
+	uint16_t id;
+	uint16_t type;
+	uint32_t sent;
+	uint32_t sent_ms;
+	uint8_t  server[16];
+	uint8_t  addrlen;
+	uint8_t* name;        /* Name of the caller, not copied */
+	uint8_t* ip;
+	void (*cb)(int8_t ret, uint8_t * name, uint8_t * ip_from_dns);
+	void (*rcb)(int8_t ret, uint8_t * name, uint8_t * ip_from_dns, uint8_t iplen);
+} dns_query_t;
+
+typedef struct
+{
+	uint16_t type;
+	uint32_t expire;
+	uint8_t  name[DNS_CACHE_NAME];
+	uint8_t  ip[16];
+} dns_cache_t;
+
+static dns_query_t dns_query[DNS_MAX_QUERY];
+#if DNS_CACHE_SIZE > 0
+static dns_cache_t dns_cache[DNS_CACHE_SIZE];
+#endif
+static uint8_t  dns_async_init = 0;
+static uint32_t dns_now = 0;  // 1s tick for the queries and the cache, never reset
+
+static uint8_t  dns_srv[DNS_MAX_SERVER][16];
+static uint8_t  dns_srv_len[DNS_MAX_SERVER];
+static uint32_t dns_srv_rtt[DNS_MAX_SERVER];  // smoothed response time of the server. unit 1ms.
+static uint8_t  dns_nsrv = 0;
+static uint32_t (*dns_clock_ms)(void) = 0;
+static uint32_t (*dns_random)(void) = 0;
+static uint32_t dns_seed = DNS_MSG_ID;
+static uint16_t dns_msg_peak = 0;  // largest message in pDNSMSG
+
+static uint32_t dns_ms(void)
+{
+	return dns_clock_ms ? dns_clock_ms() : dns_now * 1000;
+}
+
+static void dns_note_msg(int16_t len)
+{
+	if((len > 0) && ((uint16_t)len > dns_msg_peak)) dns_msg_peak = (uint16_t)len;
+}
+
+/* Unpredictable message ID. Without reg_dns_random_cbfunc(), xorshift seeded by MAC and mixed with the clock on each call. */
+static uint16_t dns_rand_id(void)
+{
+	if(dns_random) return (uint16_t)dns_random();
+	dns_seed ^= dns_ms();
+	if(dns_seed == 0) dns_seed = DNS_MSG_ID;
+	dns_seed ^= dns_seed << 13;
+	dns_seed ^= dns_seed >> 17;
+	dns_seed ^= dns_seed << 5;
+	return (uint16_t)(dns_seed ^ (dns_seed >> 16));
+}
+
+/* Message ID of a new query, not used by the other queries in progress. */
+static uint16_t dns_new_id(void)
+{
+	uint16_t id;
+	uint8_t i;
+	do {
+		id = dns_rand_id();
+		for(i = 0; i < DNS_MAX_QUERY; i++)
+			if((dns_query[i].state == DNS_Q_SENT) && (dns_query[i].id == id)) break;
+	} while(i < DNS_MAX_QUERY);
+	return id;
+}
+
 /* converts uint16_t from network buffer to a host byte order integer. */
 uint16_t get16(uint8_t * s)
 {
@@ -142,85 +238,158 @@ uint8_t * put16(uint8_t * s, uint16_t i)
 
 
 /*
- *              CONVERT A DOMAIN NAME TO THE HUMAN-READABLE FORM
+ *              SKIP A DOMAIN NAME
  *
- * Description : This function converts a compressed domain name to the human-readable form
- * Arguments   : msg        - is a pointer to the reply message
- *               compressed - is a pointer to the domain name in reply message.
- *               buf        - is a pointer to the buffer for the human-readable form name.
- *               len        - is the MAX. size of buffer.
- * Returns     : the length of compressed message
+ * Description : This function gets the length of a compressed domain name without following the pointer.
+ * Arguments   : cp  - is a pointer to the domain name in message.
+ *               end - is the end of message.
+ * Returns     : the length of the name in the message, -1 if it exceeds the message.
  */
-int parse_name(uint8_t * msg, uint8_t * compressed, char * buf, int16_t len)
+static int16_t dns_skipname(uint8_t * cp, uint8_t * end)
 {
-	uint16_t slen;		/* Length of current segment */
-	uint8_t * cp;
-	int clen = 0;		/* Total length of compressed name */
-	int indirect = 0;	/* Set if indirection encountered */
-	int nseg = 0;		/* Total number of segments in name */
-
-	cp = compressed;
-
-	for (;;)
+	uint8_t * p = cp;
+	while(p < end)
 	{
-		slen = *cp++;	/* Length of this segment */
+		if((*p & 0xc0) == 0xc0) return (p + 2 <= end) ? (int16_t)(p + 2 - cp) : -1;
+		if(*p & 0xc0) return -1;
+		if(*p == 0) return (int16_t)(p + 1 - cp);
+		p += *p + 1;
+	}
+	return -1;
+}
 
-		if (!indirect) clen++;
+/* Labels of a name, 255 bytes of name has 127 labels at most. It bounds a name with looping pointers. */
+#define DNS_MAX_LABELS     128
 
-		if ((slen & 0xc0) == 0xc0)
+/*
+ *              GET NEXT LABEL OF A DOMAIN NAME
+ *
+ * Description : This function walks a compressed domain name in place, one label at a time.
+ *               A compression pointer should point before itself, so a chain of pointers ends,
+ *               but pointers between labels can still loop. The caller bounds the labels by DNS_MAX_LABELS.
+ * Arguments   : msg - is a pointer to the message.
+ *               end - is the end of message.
+ *               cp  - is a pointer to the current label, and it is moved to the next label.
+ * Returns     : a pointer to the length byte of the label, 0 at the end of name or on error.
+ *               *cp is set to 0 on error.
+ */
+static uint8_t * dns_nextlabel(uint8_t * msg, uint8_t * end, uint8_t ** cp)
+{
+	uint8_t * p = *cp;
+	uint16_t off;
+	while(p && (p < end))
+	{
+		if((*p & 0xc0) == 0xc0)
 		{
-			if (!indirect)
-				clen++;
-			indirect = 1;
-			/* Follow indirection */
-			cp = &msg[((slen & 0x3f)<<8) + *cp];
-			slen = *cp++;
+			if(p + 2 > end) break;
+			off = ((p[0] & 0x3f) << 8) | p[1];
+			if(msg + off >= p) break;      /* Forward or self pointer may loop */
+			p = msg + off;
+			continue;
 		}
-
-		if (slen == 0)	/* zero length == all done */
-			break;
-
-		len -= slen + 1;
-
-		if (len < 0) return -1;
-
-		if (!indirect) clen += slen;
-
-		while (slen-- != 0) *buf++ = (char)*cp++;
-		*buf++ = '.';
-		nseg++;
+		if(*p & 0xc0) break;
+		if(*p == 0)
+		{
+			*cp = p;
+			return 0;
+		}
+		if(p + 1 + *p > end) break;
+		*cp = p + 1 + *p;
+		return p;
 	}
+	*cp = 0;
+	return 0;
+}
 
-	if (nseg == 0)
+/*
+ *              CONVERT A DOMAIN NAME TO THE HUMAN-READABLE FORM
+ *
+ * Description : This function decodes a compressed domain name into the buffer with bound.
+ * Arguments   : msg  - is a pointer to the message.
+ *               end  - is the end of message.
+ *               cp   - is a pointer to the domain name in message.
+ *               buf  - is a pointer to the buffer for the human-readable form name.
+ *               size - is the MAX. size of buffer.
+ * Returns     : the length of the human-readable form name, -1 on error or if the buffer is too small.
+ */
+static int16_t dns_getname(uint8_t * msg, uint8_t * end, uint8_t * cp, char * buf, uint16_t size)
+{
+	uint8_t * label;
+	uint16_t n = 0;
+	uint8_t labels = 0;
+	while((label = dns_nextlabel(msg, end, &cp)) != 0)
 	{
-		/* Root name; represent as single dot */
-		*buf++ = '.';
-		len--;
+		if(++labels > DNS_MAX_LABELS) return -1;
+		if(n + (n ? 1 : 0) + *label + 1 > size) return -1;
+		if(n) buf[n++] = '.';
+		memcpy(&buf[n], label + 1, *label);
+		n += *label;
 	}
+	if(!cp || (size == 0)) return -1;
+	buf[n] = '\0';
+	return (int16_t)n;
+}
 
-	*buf++ = '\0';
-	len--;
+/*
+ *              COMPARE A DOMAIN NAME
+ *
+ * Description : This function compares a compressed domain name in place with the human-readable form,
+ *               in case-insensitive.
+ * Returns     : 1 if same, 0 if not or on error.
+ */
+static int8_t dns_name_equal(uint8_t * msg, uint8_t * end, uint8_t * cp, const char * name)
+{
+	uint8_t * label;
+	uint8_t i, a, b;
+	uint8_t labels = 0;
+	while((label = dns_nextlabel(msg, end, &cp)) != 0)
+	{
+		if(++labels > DNS_MAX_LABELS) return 0;
+		for(i = 1; i <= *label; i++)
+		{
+			a = label[i];
+			b = (uint8_t)*name++;
+			if(b == '\0') return 0;
+			if((a >= 'A') && (a <= 'Z')) a += 'a' - 'A';
+			if((b >= 'A') && (b <= 'Z')) b += 'a' - 'A';
+			if(a != b) return 0;
+		}
+		if(*name == '.') name++;
+		else if(*name) return 0;
+	}
+	return (cp && (*name == '\0')) ? 1 : 0;
+}
 
-	return clen;	/* Length of compressed message */
+/*
+ *              CONVERT A DOMAIN NAME TO THE HUMAN-READABLE FORM
+ *
+ * Description : This function converts a compressed domain name to the human-readable form
+ * Arguments   : msg        - is a pointer to the reply message.
+ *               msglen     - is the received length of reply message.
+ *               compressed - is a pointer to the domain name in reply message.
+ *               buf        - is a pointer to the buffer for the human-readable form name.
+ *               len        - is the MAX. size of buffer.
+ * Returns     : the length of compressed message
+ */
+int parse_name(uint8_t * msg, uint16_t msglen, uint8_t * compressed, char * buf, int16_t len)
+{
+	if((len <= 0) || (dns_getname(msg, msg + msglen, compressed, buf, (uint16_t)len) < 0)) return -1;
+	return dns_skipname(compressed, msg + msglen);
 }
 
 /*
  *              PARSE QUESTION SECTION
  *
  * Description : This function parses the qeustion record of the reply message.
- * Arguments   : msg - is a pointer to the reply message
- *               cp  - is a pointer to the qeustion record.
+ * Arguments   : cp  - is a pointer to the qeustion record.
+ *               end - is the end of reply message.
  * Returns     : a pointer the to next record.
  */
-uint8_t * dns_question(uint8_t * msg, uint8_t * cp)
+uint8_t * dns_question(uint8_t * cp, uint8_t * end)
 {
-	int len;
-	char name[MAXCNAME];
+	int16_t len = dns_skipname(cp, end);
 
-	len = parse_name(msg, cp, name, MAXCNAME);
-
-
-	if (len == -1) return 0;
+	if ((len < 0) || (cp + len + 4 > end)) return 0;
 
 	cp += len;
 	cp += 2;		/* type */
@@ -234,110 +403,31 @@ uint8_t * dns_question(uint8_t * msg, uint8_t * cp)
  *              PARSE ANSER SECTION
  *
  * Description : This function parses the answer record of the reply message.
- * Arguments   : msg - is a pointer to the reply message
- *               cp  - is a pointer to the answer record.
+ * Arguments   : cp  - is a pointer to the answer record.
+ *               end - is the end of reply message.
  * Returns     : a pointer the to next record.
  */
-uint8_t * dns_answer(uint8_t * msg, uint8_t * cp, uint8_t * ip_from_dns)
+uint8_t * dns_answer(uint8_t * cp, uint8_t * end, uint8_t * ip_from_dns)
 {
-	int len, type;
-	char name[MAXCNAME];
-
-	len = parse_name(msg, cp, name, MAXCNAME);
+	int16_t len = dns_skipname(cp, end);
+	uint16_t type, rdlen;
 
-	if (len == -1) return 0;
+	if ((len < 0) || (cp + len + 10 > end)) return 0;
 
 	cp += len;
 	type = get16(cp);
 	cp += 2;		/* type */
 	cp += 2;		/* class */
 	cp += 4;		/* ttl */
+	rdlen = get16(cp);
 	cp += 2;		/* len */
+	if (cp + rdlen > end) return 0;
 
+	/* Just read the address directly, and skip the other types by len */
+	if ((type == DNS_TYPE_A) && (rdlen == 4)) memcpy(ip_from_dns, cp, 4);
+	else if ((type == DNS_TYPE_AAAA) && (rdlen == 16)) memcpy(ip_from_dns, cp, 16);
 
-	switch (type)
-	{
-	case TYPE_A:
-		/* Just read the address directly into the structure */
-		ip_from_dns[0] = *cp++;
-		ip_from_dns[1] = *cp++;
-		ip_from_dns[2] = *cp++;
-		ip_from_dns[3] = *cp++;
-		break;
-	case TYPE_AAAA:
-		ip_from_dns[0] = *cp++;
-		ip_from_dns[1] = *cp++;
-		ip_from_dns[2] = *cp++;
-		ip_from_dns[3] = *cp++;
-		ip_from_dns[4] = *cp++;
-		ip_from_dns[5] = *cp++;
-		ip_from_dns[6] = *cp++;
-		ip_from_dns[7] = *cp++;
-		ip_from_dns[8] = *cp++;
-		ip_from_dns[9] = *cp++;
-		ip_from_dns[10] = *cp++;
-		ip_from_dns[11] = *cp++;
-		ip_from_dns[12] = *cp++;
-		ip_from_dns[13] = *cp++;
-		ip_from_dns[14] = *cp++;
-		ip_from_dns[15] = *cp++;
-		break;
-	case TYPE_CNAME:
-	case TYPE_MB:
-	case TYPE_MG:
-	case TYPE_MR:
-	case TYPE_NS:
-	case TYPE_PTR:
-		/* These types all consist of a single domain name */
-		/* convert it to ascii format */
-		len = parse_name(msg, cp, name, MAXCNAME);
-		if (len == -1) return 0;
-
-		cp += len;
-		break;
-	case TYPE_HINFO:
-		len = *cp++;
-		cp += len;
-
-		len = *cp++;
-		cp += len;
-		break;
-	case TYPE_MX:
-		cp += 2;
-		/* Get domain name of exchanger */
-		len = parse_name(msg, cp, name, MAXCNAME);
-		if (len == -1) return 0;
-
-		cp += len;
-		break;
-	case TYPE_SOA:
-		/* Get domain name of name server */
-		len = parse_name(msg, cp, name, MAXCNAME);
-		if (len == -1) return 0;
-
-		cp += len;
-
-		/* Get domain name of responsible person */
-		len = parse_name(msg, cp, name, MAXCNAME);
-		if (len == -1) return 0;
-
-		cp += len;
-
-		cp += 4;
-		cp += 4;
-		cp += 4;
-		cp += 4;
-		cp += 4;
-		break;
-	case TYPE_TXT:
-		/* Just stash */
-		break;
-	default:
-		/* Ignore */
-		break;
-	}
-
-	return cp;
+	return cp + rdlen;
 }
 
 /*
@@ -347,20 +437,23 @@ uint8_t * dns_answer(uint8_t * msg, uint8_t * cp, uint8_t * ip_from_dns)
  * Arguments   : dhdr - is a pointer to the header for DNS message
  *               buf  - is a pointer to the reply message.
  *               len  - is the size of reply message.
- * Returns     : -1 - Domain name lenght is too big
+ * Returns     : -1 - Broken message
  *                0 - Fail (Timout or parse error)
  *                1 - Success,
  */
 extern uint8_t IP_TYPE;
-int8_t parseDNSMSG(struct dhdr * pdhdr, uint8_t * pbuf, uint8_t * ip_from_dns)
+int8_t parseDNSMSG(struct dhdr * pdhdr, uint8_t * pbuf, uint16_t len, uint8_t * ip_from_dns)
 {
 	uint16_t tmp;
 	uint16_t i;
 	uint8_t * msg;
 	uint8_t * cp;
+	uint8_t * end;
 
 	msg = pbuf;
+	end = pbuf + len;
 	memset(pdhdr, 0, sizeof(*pdhdr));
+	if (len < 12) return -1;
 
 	pdhdr->id = get16(&msg[0]);
 	tmp = get16(&msg[2]);
@@ -386,20 +479,14 @@ int8_t parseDNSMSG(struct dhdr * pdhdr, uint8_t * pbuf, uint8_t * ip_from_dns)
 	/* Question section */
 	for (i = 0; i < pdhdr->qdcount; i++)
 	{
-		cp = dns_question(msg, cp);
-   #ifdef _DNS_DEUBG_
-      printf("MAX_DOMAIN_NAME is too small, it should be redfine in dns.h");
-   #endif
+		cp = dns_question(cp, end);
 		if(!cp) return -1;
 	}
 
 	/* Answer section */
 	for (i = 0; i < pdhdr->ancount; i++)
 	{
-		cp = dns_answer(msg, cp, ip_from_dns);
-   #ifdef _DNS_DEUBG_
-      printf("MAX_DOMAIN_NAME is too small, it should be redfine in dns.h");
-   #endif
+		cp = dns_answer(cp, end, ip_from_dns);
 		if(!cp) return -1;
 	}
 
@@ -421,69 +508,83 @@ int8_t parseDNSMSG(struct dhdr * pdhdr, uint8_t * pbuf, uint8_t * ip_from_dns)
 
 
 /*
- *              MAKE DNS QUERY MESSAGE
+ *              PUT DNS QUERY MESSAGE
  *
- * Description : This function makes DNS query message.
+ * Description : This function puts DNS query message with the message ID.
  * Arguments   : op   - Recursion desired
+ *               id   - is the message ID.
  *               name - is a pointer to the domain name.
  *               buf  - is a pointer to the buffer for DNS message.
  *               len  - is the MAX. size of buffer.
- * Returns     : the pointer to the DNS message.
+ *               type - is the query type.
+ * Returns     : the length of DNS message, -1 if name is invalid or too long for the buffer.
  */
-int16_t dns_makequery(uint16_t op, char * name, uint8_t * buf, uint16_t len,uint8_t type)
+static int16_t dns_putquery(uint16_t op, uint16_t id, char * name, uint8_t * buf, uint16_t len, uint16_t type)
 {
-	uint8_t *cp;
+	uint8_t *cp = buf;
+	uint8_t *end = buf + len;
+	char *dname = name;
 	char *cp1;
-	char sname[MAXCNAME];
-	char *dname;
-	uint16_t p;
-	uint16_t dlen;
+	uint16_t n;
 
-	cp = buf;
-
-	DNS_MSGID++;
-	cp = put16(cp, DNS_MSGID);
-	p = (op << 11) | 0x0100;			/* Recursion desired */
-	cp = put16(cp, p);
+	if(len < 12 + 1 + 4 + DNS_OPT_LEN) return -1;
+	cp = put16(cp, id);
+	cp = put16(cp, (op << 11) | 0x0100);	/* Recursion desired */
 	cp = put16(cp, 1);
 	cp = put16(cp, 0);
 	cp = put16(cp, 0);
-	cp = put16(cp, 0);
+	cp = put16(cp, DNS_OPT_LEN ? 1 : 0);	/* EDNS0 OPT in additional section */
 
-	strcpy(sname, name);
-	dname = sname;
-	dlen = strlen(dname);
-	for (;;)
+	while(*dname)
 	{
 		/* Look for next dot */
 		cp1 = strchr(dname, '.');
+		n = cp1 ? (uint16_t)(cp1 - dname) : (uint16_t)strlen(dname);
+		if((n == 0) || (n > 63) || (cp + 1 + n + 1 + 4 + DNS_OPT_LEN > end)) return -1;
+
+		/* Write length of component and copy component up to (but not including) dot */
+		*cp++ = (uint8_t)n;
+		memcpy(cp, dname, n);
+		cp += n;
+		if(cp1 == NULL) break;
+		dname = cp1 + 1;
+	}
+	*cp++ = 0;					/* Root; write null and finish */
 
-		if (cp1 != NULL) len = cp1 - dname;	/* More to come */
-		else len = dlen;			/* Last component */
+	cp = put16(cp, type);				/* type */
+	cp = put16(cp, 0x0001);				/* class */
 
-		*cp++ = len;				/* Write length of component */
-		if (len == 0) break;
+#if DNS_EDNS0_SIZE > 0
+	/* Tell the server the size of UDP payload over 512 we can receive */
+	*cp++ = 0;					/* root */
+	cp = put16(cp, TYPE_OPT);
+	cp = put16(cp, DNS_EDNS0_SIZE);			/* UDP payload size */
+	cp = put16(cp, 0);				/* extended RCODE and version */
+	cp = put16(cp, 0);				/* flags */
+	cp = put16(cp, 0);				/* rdlen */
+#endif
 
-		/* Copy component up to (but not including) dot */
-		strncpy((char *)cp, dname, len);
-		cp += len;
-		if (cp1 == NULL)
-		{
-			*cp++ = 0;			/* Last one; write null and finish */
-			break;
-		}
-		dname += len+1;
-		dlen -= len+1;
-	}
+	return (int16_t)(cp - buf);
+}
+
+/*
+ *              MAKE DNS QUERY MESSAGE
+ *
+ * Description : This function makes DNS query message.
+ * Arguments   : op   - Recursion desired
+ *               name - is a pointer to the domain name.
+ *               buf  - is a pointer to the buffer for DNS message.
+ *               len  - is the MAX. size of buffer.
+ * Returns     : the length of DNS message.
+ */
+int16_t dns_makequery(uint16_t op, char * name, uint8_t * buf, uint16_t len,uint8_t type)
+{
+	DNS_MSGID = dns_rand_id();
 #if 1
-	cp = put16(cp,IP_TYPE);				/* type */
+	return dns_putquery(op, DNS_MSGID, name, buf, len, IP_TYPE);
 #else
-	cp = put16(cp, type);				/* type */
+	return dns_putquery(op, DNS_MSGID, name, buf, len, type);
 #endif
-	cp = put16(cp, 0x0001);				/* class */
-
-
-	return ((int16_t)((uint32_t)(cp) - (uint32_t)(buf)));
 }
 
 /*
@@ -519,7 +620,12 @@ void DNS_init( uint8_t * buf)
 {
 	//DNS_SOCKET = s; // SOCK_DNS
 	pDNSMSG = buf; // User's shared buffer
-	DNS_MSGID = DNS_MSG_ID;
+	uint8_t mac[6];
+	getSHAR(mac);
+	dns_seed ^= ((uint32_t)mac[2] << 24) ^ ((uint32_t)mac[3] << 16) ^ ((uint32_t)mac[4] << 8) ^ mac[5] ^ dns_ms();
+	if(dns_seed == 0) dns_seed = DNS_MSG_ID;
+	DNS_MSGID = dns_rand_id();
+	dns_msg_peak = 0;
 }
 
 /* DNS CLIENT RUN */
@@ -531,10 +637,14 @@ int8_t DNS_run(uint8_t s,uint8_t * dns_ip, uint8_t * name, uint8_t * ip_from_dns
 	uint8_t addr_len;
 	uint16_t len, port;
 	int8_t ret_check_timeout;
+	uint8_t claimed = (wiz_sock_owner(s) == SOCK_OWN_NONE);
 
 	retry_count = 0;
 	dns_1s_tick = 0;
 
+	// Keep s from wiz_sock_alloc() of the others while it is used
+	if(wiz_sock_claim(s, SOCK_OWN_DNS) < 0) return -1;
+
    // Socket open
 
  	if(mode == AS_IPV4 ){
@@ -551,7 +661,13 @@ int8_t DNS_run(uint8_t s,uint8_t * dns_ip, uint8_t * name, uint8_t * ip_from_dns
 
 #endif
 
-	len = dns_makequery(0, (char *)name, pDNSMSG, MAX_DNS_BUF_SIZE,mode);
+	if ((int16_t)(len = dns_makequery(0, (char *)name, pDNSMSG, MAX_DNS_BUF_SIZE,mode)) < 0)
+	{
+		wiz_close(s);
+		if(claimed) wiz_sock_free(s);
+		return -1;
+	}
+	dns_note_msg((int16_t)len);
 	wiz_sendto(s, pDNSMSG, len, dns_ip, IPPORT_DOMAIN,addr_len);
 
 	while (1)
@@ -560,10 +676,11 @@ int8_t DNS_run(uint8_t s,uint8_t * dns_ip, uint8_t * name, uint8_t * ip_from_dns
 		{
 			if (len > MAX_DNS_BUF_SIZE) len = MAX_DNS_BUF_SIZE;
 			len = wiz_recvfrom(s, pDNSMSG, len, ip, &port,&addr_len);
+			dns_note_msg((int16_t)len);
       #ifdef _DNS_DEBUG_
 	      printf("> Receive DNS message from %d.%d.%d.%d(%d). len = %d\r\n", ip[0], ip[1], ip[2], ip[3],port,len);
       #endif
-         ret = parseDNSMSG(&dhp, pDNSMSG, ip_from_dns);
+         ret = parseDNSMSG(&dhp, pDNSMSG, len, ip_from_dns);
 			break;
 		}
 		// Check Timeout
@@ -573,6 +690,7 @@ int8_t DNS_run(uint8_t s,uint8_t * dns_ip, uint8_t * name, uint8_t * ip_from_dns
 #ifdef _DNS_DEBUG_
 			printf("> DNS Server is not responding : %d.%d.%d.%d\r\n", dns_ip[0], dns_ip[1], dns_ip[2], dns_ip[3]);
 #endif
+			if(claimed) wiz_sock_free(s);
 			return 0; // timeout occurred
 		}
 		else if (ret_check_timeout == 0) {
@@ -584,14 +702,503 @@ int8_t DNS_run(uint8_t s,uint8_t * dns_ip, uint8_t * name, uint8_t * ip_from_dns
 		}
 	}
 	wiz_close(s);
+	if(claimed) wiz_sock_free(s);
 	// Return value
 	// 0 > :  failed / 1 - success
 	return ret;
 }
 
 
+/*
+ *              PARSE THE ANSWER OF A QUERY
+ *
+ * Description : This function finds the first answer of type in the reply message.
+ *               The names are checked in place without copy.
+ * Arguments   : msg  - is a pointer to the reply message.
+ *               len  - is the size of reply message.
+ *               name - is the queried name, which should be in the question section.
+ *               type - is the query type, DNS_TYPE_A or DNS_TYPE_AAAA.
+ *               ip   - is a pointer to the address found.
+ *               ttl  - is the lowest TTL of the answer records up to the found one, such as CNAME.
+ * Returns     : 1 - Success, 0 - Fail (error response or no answer)
+ */
+static int8_t dns_parseanswer(uint8_t * msg, uint16_t len, uint8_t * name, uint16_t type, uint8_t * ip, uint32_t * ttl)
+{
+	uint8_t * cp = &msg[12];
+	uint8_t * end = msg + len;
+	uint16_t i, rtype, rdlen;
+	uint32_t rttl;
+	int16_t n;
+
+	if(len < 12) return 0;
+	if(!(msg[2] & 0x80) || (msg[3] & 0x0f)) return 0;	/* Not a response, or error response */
+
+	if(get16(&msg[4]) != 1) return 0;
+	if(!dns_name_equal(msg, end, cp, (char *)name) || ((n = dns_skipname(cp, end)) < 0)) return 0;
+	cp += n + 4;
+	*ttl = DNS_CACHE_MAX_TTL;
+	for(i = get16(&msg[6]); i > 0; i--)
+	{
+		if(((n = dns_skipname(cp, end)) < 0) || (cp + n + 10 > end)) return 0;
+		cp += n;
+		rtype = get16(cp);
+		rttl = ((uint32_t)get16(cp + 4) << 16) | get16(cp + 6);
+		rdlen = get16(cp + 8);
+		cp += 10;
+		if(cp + rdlen > end) return 0;
+		if(rttl < *ttl) *ttl = rttl;
+		if((rtype == type) && (rdlen == ((type == DNS_TYPE_AAAA) ? 16 : 4)))
+		{
+			memcpy(ip, cp, rdlen);
+			return 1;
+		}
+		cp += rdlen;
+	}
+	return 0;
+}
+
+#if DNS_CACHE_SIZE > 0
+static dns_cache_t * dns_cache_find(uint8_t * name, uint16_t type)
+{
+	uint8_t i;
+	for(i = 0; i < DNS_CACHE_SIZE; i++)
+	{
+		if((dns_cache[i].type == type) && ((int32_t)(dns_cache[i].expire - dns_now) > 0) &&
+		   (strcmp((char *)dns_cache[i].name, (char *)name) == 0))
+			return &dns_cache[i];
+	}
+	return 0;
+}
+
+static void dns_cache_add(uint8_t * name, uint16_t type, uint8_t * ip, uint32_t ttl)
+{
+	dns_cache_t * c;
+	uint8_t i;
+	if((ttl == 0) || (strlen((char *)name) >= DNS_CACHE_NAME)) return;
+	if(ttl > DNS_CACHE_MAX_TTL) ttl = DNS_CACHE_MAX_TTL;
+	/* Replace the same name, or the one expiring first */
+	if((c = dns_cache_find(name, type)) == 0)
+	{
+		c = &dns_cache[0];
+		for(i = 1; i < DNS_CACHE_SIZE; i++)
+		{
+			if((int32_t)(dns_cache[i].expire - c->expire) < 0) c = &dns_cache[i];
+		}
+	}
+	c->type = type;
+	c->expire = dns_now + ttl;
+	strcpy((char *)c->name, (char *)name);
+	memcpy(c->ip, ip, (type == DNS_TYPE_AAAA) ? 16 : 4);
+}
+#endif
+
+void DNS_cache_flush(void)
+{
+#if DNS_CACHE_SIZE > 0
+	memset(dns_cache, 0, sizeof(dns_cache));
+#endif
+}
+
+/* Find the server of the list. */
+static int8_t dns_find_server(uint8_t * ip, uint8_t addrlen)
+{
+	uint8_t i;
+	for(i = 0; i < dns_nsrv; i++)
+	{
+		if((dns_srv_len[i] == addrlen) && (memcmp(dns_srv[i], ip, addrlen) == 0)) return (int8_t)i;
+	}
+	return -1;
+}
+
+/* Select the fastest server not tried yet by the query. */
+static void dns_pick_server(dns_query_t * q)
+{
+	uint8_t i, best = 0xFF;
+	if(dns_nsrv == 0) return;  /* Keep the last server when the list is cleared */
+	if((q->tried & ((1 << dns_nsrv) - 1)) == ((1 << dns_nsrv) - 1)) q->tried = 0;
+	for(i = 0; i < dns_nsrv; i++)
+	{
+		if(q->tried & (1 << i)) continue;
+		if((best == 0xFF) || (dns_srv_rtt[i] < dns_srv_rtt[best])) best = i;
+	}
+	q->srv = best;
+	q->tried |= (1 << best);
+	q->addrlen = dns_srv_len[best];
+	memcpy(q->server, dns_srv[best], q->addrlen);
+}
+
+/* The other half of the DNS_resolve() query q, or NULL if it is completed already. */
+static dns_query_t * dns_pair(dns_query_t * q)
+{
+	dns_query_t * p;
+	if(q->pair >= DNS_MAX_QUERY) return 0;
+	p = &dns_query[q->pair];
+	/* The slot of the completed half can be reused by another query */
+	if((p->state == DNS_Q_FREE) || !(p->flags & DNS_F_RESOLVE) || (p->pair != (uint8_t)(q - dns_query))) return 0;
+	return p;
+}
+
+/* Report the result of the query to its owner. */
+static void dns_finish(dns_query_t * q, int8_t ret, uint8_t * ip)
+{
+	uint8_t len = (q->type == DNS_TYPE_AAAA) ? 16 : 4;
+	dns_query_t * p;
+	if(!(q->flags & DNS_F_RESOLVE))
+	{
+		if(ret == 1) memcpy(q->ip, ip, len);
+		if(q->cb) q->cb(ret, q->name, q->ip);
+		return;
+	}
+	/* The first answer of A and AAAA is reported. The failure is reported when both failed. */
+	p = dns_pair(q);
+	q->pair = DNS_NO_PAIR;
+	if(q->flags & DNS_F_REPORTED) return;
+	if(ret == 1)
+	{
+		if(p) p->flags |= DNS_F_REPORTED;
+		memcpy(q->ip, ip, len);
+		if(q->rcb) q->rcb(1, q->name, q->ip, len);
+	}
+	else if((q->flags & DNS_F_LAST) || !p)
+	{
+		if(q->rcb) q->rcb(ret, q->name, q->ip, 0);
+	}
+	else
+	{
+		p->flags |= DNS_F_LAST;
+	}
+}
+
+/* Complete the query of id and the ones joined to it. */
+static void dns_complete(uint16_t id, int8_t ret, uint8_t * ip)
+{
+	uint8_t i;
+	dns_query_t * q;
+	for(i = 0; i < DNS_MAX_QUERY; i++)
+	{
+		q = &dns_query[i];
+		if((q->state == DNS_Q_SENT || q->state == DNS_Q_JOINED) && (q->id == id)) q->state = DNS_Q_DONE;
+	}
+	for(i = 0; i < DNS_MAX_QUERY; i++)
+	{
+		q = &dns_query[i];
+		if((q->state != DNS_Q_DONE) || (q->id != id)) continue;
+		dns_finish(q, ret, ip);
+		q->state = DNS_Q_FREE;
+	}
+}
+
+static void dns_sendquery(dns_query_t * q)
+{
+	int16_t len = dns_putquery(0, q->id, (char *)q->name, pDNSMSG, MAX_DNS_BUF_SIZE, q->type);
+	dns_note_msg(len);
+	if(len > 0) wiz_sendto(DNS_SOCKET, pDNSMSG, len, q->server, IPPORT_DOMAIN, q->addrlen);
+	q->sent = dns_now;
+	q->sent_ms = dns_ms();
+}
+
+/* Join the query for the same name and type in progress, or send a new one. */
+static void dns_start(dns_query_t * q, uint8_t * dns_ip, uint8_t addrlen, uint8_t * name, uint16_t type)
+{
+	uint8_t i;
+	q->name = name;
+	q->type = type;
+	q->retry = 0;
+	q->tried = 0;
+	for(i = 0; i < DNS_MAX_QUERY; i++)
+	{
+		if((dns_query[i].state == DNS_Q_SENT) && (dns_query[i].type == type) &&
+		   (strcmp((char *)dns_query[i].name, (char *)name) == 0))
+		{
+			q->id = dns_query[i].id;
+			q->state = DNS_Q_JOINED;
+			return;
+		}
+	}
+	if(dns_ip)
+	{
+		memcpy(q->server, dns_ip, addrlen);
+		q->addrlen = addrlen;
+	}
+	else
+	{
+		q->flags |= DNS_F_LIST;
+		dns_pick_server(q);
+	}
+	q->id = dns_new_id();
+	q->state = DNS_Q_SENT;
+#ifdef _DNS_DEBUG_
+	printf("> DNS Query %s type %d id 0x%04x\r\n", name, type, q->id);
+#endif
+	dns_sendquery(q);
+}
+
+static dns_query_t * dns_alloc(void)
+{
+	uint8_t i;
+	for(i = 0; i < DNS_MAX_QUERY; i++)
+	{
+		if(dns_query[i].state == DNS_Q_FREE)
+		{
+			memset(&dns_query[i], 0, sizeof(dns_query_t));
+			return &dns_query[i];
+		}
+	}
+	return 0;
+}
+
+/* Check the name, and the server for dns_ip of NULL. */
+static int8_t dns_check(uint8_t * dns_ip, uint8_t * name)
+{
+	if(!dns_async_init || (!dns_ip && (dns_nsrv == 0))) return -1;
+	if(strlen((char *)name) >= MAX_DOMAIN_NAME) return -1;
+	if(dns_putquery(0, 0, (char *)name, pDNSMSG, MAX_DNS_BUF_SIZE, DNS_TYPE_A) < 0) return -1;
+	return 0;
+}
+
+void DNS_async_stop(void)
+{
+	if(!dns_async_init) return;
+	memset(dns_query, 0, sizeof(dns_query));
+	// The socket can be given to another already, such as by netsvc_init()
+	if(wiz_sock_owner(DNS_SOCKET) == SOCK_OWN_DNS)
+	{
+		wiz_close(DNS_SOCKET);
+		wiz_sock_free(DNS_SOCKET);
+	}
+	dns_async_init = 0;
+}
+
+void DNS_async_init(uint8_t s, uint8_t * buf)
+{
+	DNS_async_stop();
+	DNS_init(buf);
+	if(wiz_sock_claim(s, SOCK_OWN_DNS) < 0) return;
+	DNS_SOCKET = s;
+	wiz_socket(s, Sn_MR_UDPD, 0, 0);
+	dns_async_init = 1;
+}
+
+
+void reg_dns_clock_cbfunc(uint32_t (*clock_ms)(void))
+{
+	dns_clock_ms = clock_ms;
+}
+
+void reg_dns_random_cbfunc(uint32_t (*random)(void))
+{
+	dns_random = random;
+}
+
+uint16_t DNS_get_msg_peak(void)
+{
+	return dns_msg_peak;
+}
+
+uint16_t DNS_get_cache_size(void)
+{
+#if DNS_CACHE_SIZE > 0
+	return (uint16_t)sizeof(dns_cache);
+#else
+	return 0;
+#endif
+}
+
+int8_t DNS_add_server(uint8_t * dns_ip, uint8_t addrlen)
+{
+	uint8_t i;
+	int8_t idx;
+	if((addrlen != 4) && (addrlen != 16)) return -1;
+	for(i = 0; (i < addrlen) && (dns_ip[i] == 0); i++);
+	if(i == addrlen) return -1;
+	if((idx = dns_find_server(dns_ip, addrlen)) >= 0) return idx;
+	if(dns_nsrv >= DNS_MAX_SERVER) return -1;
+	memcpy(dns_srv[dns_nsrv], dns_ip, addrlen);
+	dns_srv_len[dns_nsrv] = addrlen;
+	dns_srv_rtt[dns_nsrv] = INITRTT;
+	return (int8_t)dns_nsrv++;
+}
+
+void DNS_add_netinfo_server(void)
+{
+	wiz_NetInfo netinfo;
+	ctlnetwork(CN_GET_NETINFO, (void *)&netinfo);
+	DNS_add_server(netinfo.dns6, 16);
+	DNS_add_server(netinfo.dns, 4);
+}
+
+void DNS_clear_server(void)
+{
+	dns_nsrv = 0;
+}
+
+uint32_t DNS_get_server_rtt(uint8_t idx)
+{
+	return (idx < dns_nsrv) ? dns_srv_rtt[idx] : 0;
+}
+
+int8_t DNS_query(uint8_t * dns_ip, uint8_t addrlen, uint8_t * name, uint16_t type, uint8_t * ip_from_dns,
+                 void (*cb)(int8_t ret, uint8_t * name, uint8_t * ip_from_dns))
+{
+	dns_query_t * q;
+
+	if(dns_check(dns_ip, name) < 0) return -1;
+#if DNS_CACHE_SIZE > 0
+	{
+		dns_cache_t * c = dns_cache_find(name, type);
+		if(c)
+		{
+			memcpy(ip_from_dns, c->ip, (type == DNS_TYPE_AAAA) ? 16 : 4);
+			return 1;
+		}
+	}
+#endif
+	if((q = dns_alloc()) == 0) return -1;
+	q->ip = ip_from_dns;
+	q->cb = cb;
+	dns_start(q, dns_ip, addrlen, name, type);
+	return 0;
+}
+
+int8_t DNS_resolve(uint8_t * name, uint8_t * ip_from_dns, uint8_t * iplen,
+                   void (*cb)(int8_t ret, uint8_t * name, uint8_t * ip_from_dns, uint8_t iplen))
+{
+	dns_query_t * qa;
+	dns_query_t * q6;
+
+	if(dns_check(0, name) < 0) return -1;
+#if DNS_CACHE_SIZE > 0
+	{
+		dns_cache_t * c = dns_cache_find(name, DNS_TYPE_AAAA);
+		if(c || ((c = dns_cache_find(name, DNS_TYPE_A)) != 0))
+		{
+			*iplen = (c->type == DNS_TYPE_AAAA) ? 16 : 4;
+			memcpy(ip_from_dns, c->ip, *iplen);
+			return 1;
+		}
+	}
+#endif
+	if((qa = dns_alloc()) == 0) return -1;
+	qa->state = DNS_Q_DONE;  /* Keep it from the next dns_alloc() */
+	if((q6 = dns_alloc()) == 0)
+	{
+		qa->state = DNS_Q_FREE;
+		return -1;
+	}
+	qa->flags = q6->flags = DNS_F_RESOLVE;
+	qa->pair = (uint8_t)(q6 - dns_query);
+	q6->pair = (uint8_t)(qa - dns_query);
+	qa->ip = q6->ip = ip_from_dns;
+	qa->rcb = q6->rcb = cb;
+	dns_start(q6, 0, 0, name, DNS_TYPE_AAAA);
+	dns_start(qa, 0, 0, name, DNS_TYPE_A);
+	return 0;
+}
+
+uint8_t DNS_poll(void)
+{
+	uint8_t ip[16], ans[16];
+	uint8_t addrlen, i, pending = 0;
+	uint16_t port, id;
+	datasize_t len, remain;
+	uint32_t ttl, rtt;
+	int8_t ret, srv;
+	dns_query_t * q;
+
+	if(!dns_async_init) return 0;
+
+	while(getSn_RX_RSR(DNS_SOCKET) > 0)
+	{
+		len = wiz_recvfrom(DNS_SOCKET, pDNSMSG, MAX_DNS_BUF_SIZE, ip, &port, &addrlen);
+		if(len <= 0) break;
+		dns_note_msg((int16_t)len);
+		id = get16(pDNSMSG);
+		srv = dns_find_server(ip, addrlen);
+		for(i = 0, q = 0; i < DNS_MAX_QUERY; i++)
+		{
+			/* The answer should come from the server of the query, or any server of the list for DNS_F_LIST */
+			if((dns_query[i].state == DNS_Q_SENT) && (dns_query[i].id == id) && (port == IPPORT_DOMAIN) &&
+			   ((dns_query[i].flags & DNS_F_LIST) ? (srv >= 0) :
+			    ((addrlen == dns_query[i].addrlen) && (memcmp(ip, dns_query[i].server, addrlen) == 0))))
+			{
+				q = &dns_query[i];
+				break;
+			}
+		}
+		ret = q ? dns_parseanswer(pDNSMSG, len, q->name, q->type, ans, &ttl) : 0;
+		/* Drop the rest over the buffer */
+		while((getsockopt(DNS_SOCKET, SO_REMAINSIZE, &remain) == SOCK_OK) && (remain > 0))
+		{
+			if(wiz_recvfrom(DNS_SOCKET, pDNSMSG, MAX_DNS_BUF_SIZE, ip, &port, &addrlen) <= 0) break;
+		}
+		if(!q) continue;
+#ifdef _DNS_DEBUG_
+		printf("> DNS Answer %s id 0x%04x : %d\r\n", q->name, id, ret);
+#endif
+		/* Sample the response time only of the query not resent (Karn's algorithm) */
+		if((q->flags & DNS_F_LIST) && (q->retry == 0) && (srv == (int8_t)q->srv))
+		{
+			rtt = dns_ms() - q->sent_ms;
+			dns_srv_rtt[srv] = dns_srv_rtt[srv] - (dns_srv_rtt[srv] >> LAGAIN) + (rtt >> LAGAIN);
+		}
+#if DNS_CACHE_SIZE > 0
+		if(ret == 1) dns_cache_add(q->name, q->type, ans, ttl);
+#endif
+		dns_complete(id, ret, ans);
+	}
+
+	for(i = 0; i < DNS_MAX_QUERY; i++)
+	{
+		q = &dns_query[i];
+		if(q->state != DNS_Q_SENT) continue;
+		if((dns_now - q->sent) >= DNS_WAIT_TIME)
+		{
+			if(q->flags & DNS_F_LIST)
+			{
+				/* No answer doubles the response time, so the next query prefers the other server */
+				if(dns_srv_rtt[q->srv] < (DNS_WAIT_TIME * 1000L * MAX_DNS_RETRY)) dns_srv_rtt[q->srv] <<= 1;
+			}
+			if(q->retry >= (((q->flags & DNS_F_LIST) && (dns_nsrv > MAX_DNS_RETRY + 1)) ? dns_nsrv - 1 : MAX_DNS_RETRY))
+			{
+#ifdef _DNS_DEBUG_
+				printf("> DNS Timeout %s id 0x%04x\r\n", q->name, q->id);
+#endif
+				dns_complete(q->id, 0, ans);
+				continue;
+			}
+			q->retry++;
+			/* Fail over to the next server of the list */
+			if(q->flags & DNS_F_LIST) dns_pick_server(q);
+			dns_sendquery(q);
+		}
+	}
+
+	for(i = 0; i < DNS_MAX_QUERY; i++)
+	{
+		if(dns_query[i].state != DNS_Q_FREE) pending++;
+	}
+	return pending;
+}
+
+uint32_t DNS_next_deadline(void)
+{
+	uint32_t next = 0xFFFFFFFF;
+	uint32_t left;
+	uint8_t i;
+
+	for(i = 0; i < DNS_MAX_QUERY; i++)
+	{
+		if(dns_query[i].state != DNS_Q_SENT) continue;
+		left = dns_now - dns_query[i].sent;
+		left = (left >= DNS_WAIT_TIME) ? 0 : (DNS_WAIT_TIME - left) * 1000;
+		if(left < next) next = left;
+	}
+	return next;
+}
+
 /* DNS TIMER HANDLER */
 void DNS_time_handler(void)
 {
 	dns_1s_tick++;
+	dns_now++;
 }
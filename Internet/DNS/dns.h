@@ -62,20 +62,77 @@ extern "C" {
  */
 //#define _DNS_DEBUG_
 
-#define	MAX_DNS_BUF_SIZE	256		///< maximum size of DNS buffer. */
 /*
- * @brief Maxium length of your queried Domain name
- * @todo SHOULD BE defined it equal as or greater than your Domain name lenght + null character(1)
- * @note SHOULD BE careful to stack overflow because it is allocated 1.5 times as MAX_DOMAIN_NAME in stack.
+ * @brief Size of DNS buffer of DNS_init() and DNS_async_init()
+ * @note  It should be at least 512 for the full name and the standard UDP response.
  */
-#define  MAX_DOMAIN_NAME   16       // for example "www.google.com"
+#ifndef MAX_DNS_BUF_SIZE
+#define	MAX_DNS_BUF_SIZE	512
+#endif
+
+/*
+ * @brief Maxium length of your queried Domain name + null character(1)
+ * @note  Only the cache of DNS_query() keeps a copy of the name. The messages are built and parsed in place.
+ */
+#ifndef MAX_DOMAIN_NAME
+#define  MAX_DOMAIN_NAME   254
+#endif
+
+/*
+ * @brief UDP payload size told to the server by EDNS0 in the query.
+ * @note  Defaults to MAX_DNS_BUF_SIZE over 512. 0 sends no EDNS0 OPT record.
+ */
+#ifndef DNS_EDNS0_SIZE
+#if MAX_DNS_BUF_SIZE > 512
+#define DNS_EDNS0_SIZE     MAX_DNS_BUF_SIZE
+#else
+#define DNS_EDNS0_SIZE     0
+#endif
+#endif
 
 #define	MAX_DNS_RETRY     2        ///< Requery Count
 #define	DNS_WAIT_TIME     3        ///< Wait response time. unit 1s.
 
 #define	IPPORT_DOMAIN     53       ///< DNS server port number
 
-#define DNS_MSG_ID         0x1122   ///< ID for DNS message. You can be modifyed it any number
+#define DNS_MSG_ID         0x1122   ///< Seed of the random DNS message ID. You can be modifyed it any number
+
+#define DNS_TYPE_A         1        ///< IPv4 host address query
+#define DNS_TYPE_AAAA      28       ///< IPv6 host address query
+
+/*
+ * @brief Maximum number of DNS_query() in progress, including the ones joined to the same name.
+ */
+#ifndef DNS_MAX_QUERY
+#define DNS_MAX_QUERY      4
+#endif
+
+/*
+ * @brief Number of answers kept by DNS_query() until their TTL expires. 0 disables the cache.
+ */
+#ifndef DNS_CACHE_SIZE
+#define DNS_CACHE_SIZE     4
+#endif
+
+/*
+ * @brief Size of the name kept by each answer of the cache, including null character.
+ * @note  Each entry of the cache takes about DNS_CACHE_NAME + 24 bytes of RAM. A longer name is not cached.
+ *        Up to MAX_DOMAIN_NAME caches every name, 4 entries of 254 bytes take about 1.1KB.
+ */
+#ifndef DNS_CACHE_NAME
+#define DNS_CACHE_NAME     64
+#endif
+
+/*
+ * @brief Maximum number of DNS servers of DNS_add_server(), up to 8
+ */
+#ifndef DNS_MAX_SERVER
+#define DNS_MAX_SERVER     4
+#endif
+
+#ifndef DNS_CACHE_MAX_TTL
+#define DNS_CACHE_MAX_TTL  86400    ///< Upper limit of cached TTL. unit 1s.
+#endif
 
 /*
  * @brief DNS process initialize
@@ -90,13 +147,132 @@ void DNS_init(uint8_t * buf);
  * @param dns_ip        : DNS server ip
  * @param name          : Domain name to be queryed
  * @param ip_from_dns   : IP address from DNS server
- * @return  -1 : failed. @ref MAX_DOMIN_NAME is too small \n
+ * @return  -1 : failed. Name is invalid or too long for @ref MAX_DNS_BUF_SIZE, or broken response \n
  *           0 : failed  (Timeout or Parse error)\n
  *           1 : success
- * @note This funtion blocks until success or fail. max time = @ref MAX_DNS_RETRY * @ref DNS_WAIT_TIME
+ * @note This funtion blocks until success or fail. max time = @ref MAX_DNS_RETRY * @ref DNS_WAIT_TIME \n
+ *       s is claimed in the SOCKET pool while it runs, and -1 is returned if it is owned by another one.
  */
 int8_t DNS_run(uint8_t s,uint8_t * dns_ip, uint8_t * name, uint8_t * ip_from_dns,uint8_t mode);
 
+/*
+ * @brief Non-blocking DNS process initialize
+ * @details Opens socket s as UDP dual stack for DNS_query(). All queries share it and are told apart by message ID.
+ *          s is claimed in the SOCKET pool by wiz_sock_claim(). If it is owned by another one, DNS_query() fails.
+ * @param s   : Socket number for DNS
+ * @param buf : Buffer for DNS message, MAX_DNS_BUF_SIZE bytes
+ */
+void DNS_async_init(uint8_t s, uint8_t * buf);
+
+/*
+ * @brief Stop the non-blocking DNS process
+ * @details Drops the queries in progress without callback, closes the socket of DNS_async_init()
+ *          and gives it back to the SOCKET pool.
+ */
+void DNS_async_stop(void);
+
+/*
+ * @brief Register 1ms clock to measure the response time of DNS servers
+ * @note If not registered, it is measured by DNS_time_handler() in 1s.
+ */
+void reg_dns_clock_cbfunc(uint32_t (*clock_ms)(void));
+
+/*
+ * @brief Register random number generator for the message ID of each query, such as a hardware RNG
+ * @note If not registered, the ID is a xorshift of MAC address and the clock, so it is hard but not impossible to guess.
+ */
+void reg_dns_random_cbfunc(uint32_t (*random)(void));
+
+/*
+ * @brief Add DNS server to the list used by DNS_resolve() and DNS_query() with dns_ip of NULL
+ * @details Zero address and the same server are ignored.
+ *          The DNS servers from DHCPv4 and DHCPv6 can be added as getDNSfromDHCPv4() and DNS6_Address.
+ * @param dns_ip        : DNS server ip
+ * @param addrlen       : 4 for IPv4 or 16 for IPv6 DNS server
+ * @return  Index of the server, -1 if the list is full or the address is invalid
+ */
+int8_t DNS_add_server(uint8_t * dns_ip, uint8_t addrlen);
+
+/*
+ * @brief Add the DNS servers of wiz_NetInfo, IPv6 and IPv4, set by ctlnetwork()
+ */
+void DNS_add_netinfo_server(void);
+
+/*
+ * @brief Remove all DNS servers of the list
+ */
+void DNS_clear_server(void);
+
+/*
+ * @brief Get smoothed response time of the server in the list
+ * @param idx           : Index of the server
+ * @return  Response time in ms. The server without answer gets twice of it on each timeout.
+ */
+uint32_t DNS_get_server_rtt(uint8_t idx);
+
+/*
+ * @brief Start non-blocking DNS query
+ * @details The answer in the cache is returned at once. A query for the name and type in progress is joined,
+ *          so only one message is sent for them. Otherwise a query is sent with a new random message ID.
+ * @param dns_ip        : DNS server ip. NULL sends it to the fastest server of the list, \n
+ *                        and each resend fails over to the next one.
+ * @param addrlen       : 4 for IPv4 or 16 for IPv6 DNS server
+ * @param name          : Domain name to be queryed. It should be kept until cb is called.
+ * @param type          : DNS_TYPE_A or DNS_TYPE_AAAA
+ * @param ip_from_dns   : IP address from DNS server. It should be kept until cb is called.
+ * @param cb            : Called by DNS_poll() with the result as DNS_run(), name and ip_from_dns.
+ * @return  -1 : failed. Name is too long, or no free query\n
+ *           0 : in progress. cb will be called\n
+ *           1 : success from the cache. cb is not called
+ */
+int8_t DNS_query(uint8_t * dns_ip, uint8_t addrlen, uint8_t * name, uint16_t type, uint8_t * ip_from_dns,
+                 void (*cb)(int8_t ret, uint8_t * name, uint8_t * ip_from_dns));
+
+/*
+ * @brief Start non-blocking A and AAAA queries together to the list of DNS servers
+ * @details Both are sent on the socket of DNS_async_init() to the fastest server of the list,
+ *          and each resend fails over to the next one. The first valid answer is reported.
+ * @param name          : Domain name to be queryed. It should be kept until cb is called.
+ * @param ip_from_dns   : IP address from DNS server, 16 bytes. It should be kept until cb is called.
+ * @param iplen         : Length of the address from the cache, 4 or 16
+ * @param cb            : Called by DNS_poll() with the result as DNS_run(), name, ip_from_dns and its length. \n
+ *                        The failure is reported when both failed.
+ * @return  -1 : failed. Name is too long, no server, or no free query \n
+ *           0 : in progress. cb will be called\n
+ *           1 : success from the cache. cb is not called
+ */
+int8_t DNS_resolve(uint8_t * name, uint8_t * ip_from_dns, uint8_t * iplen,
+                   void (*cb)(int8_t ret, uint8_t * name, uint8_t * ip_from_dns, uint8_t iplen));
+
+/*
+ * @brief Non-blocking DNS process
+ * @details Receives DNS responses, resends and times out the queries in progress.
+ * @return  The number of queries in progress
+ * @note This funtion is always called by you main task. Timeout is counted by DNS_time_handler().
+ */
+uint8_t DNS_poll(void);
+
+/*
+ * @brief Time to the next resend or timeout of the queries in progress
+ * @return  ms to it with 1s resolution, 0 if DNS_poll() is due, or 0xFFFFFFFF if no query is in progress
+ */
+uint32_t DNS_next_deadline(void);
+
+/*
+ * @brief Get the largest message sent or received in the buffer of DNS_init() since it
+ */
+uint16_t DNS_get_msg_peak(void);
+
+/*
+ * @brief Get bytes of the answer cache of DNS_query(), kept besides the buffer of DNS_init()
+ */
+uint16_t DNS_get_cache_size(void);
+
+/*
+ * @brief Drop all answers in the cache of DNS_query()
+ */
+void DNS_cache_flush(void);
+
 /*
  * @brief DNS 1s Tick Timer handler
  * @note SHOULD BE register to your system 1s Tick timer handler
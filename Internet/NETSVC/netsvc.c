@@ -0,0 +1,216 @@
+//*****************************************************************************
+//
+//! \file netsvc.c
+//! \brief Network service runtime APIs Implement file.
+//! \details Runs DNS, DHCPv4 and DHCPv6 clients on one shared message buffer. \n
+//!          It depends on string.h in ansi-c library
+//
+//*****************************************************************************
+
+#include <string.h>
+
+#include "socket.h"
+#include "netsvc.h"
+
+#define NETSVC_NUM         3        /* DHCPv4, DHCPv6 and DNS, in order of NETSVC_xx bits */
+#define NETSVC_NO_SOCK     0xFF
+
+/* Word aligned, as DHCPv4 lays its RIP_MSG on it */
+static uint32_t netsvc_arena_words[(NETSVC_ARENA_SIZE + 3) / 4];
+#define netsvc_arena ((uint8_t*)netsvc_arena_words)
+static uint8_t  netsvc_services = 0;
+static uint8_t  netsvc_sn[NETSVC_NUM] = {NETSVC_NO_SOCK, NETSVC_NO_SOCK, NETSVC_NO_SOCK};
+static uint8_t  netsvc_result[NETSVC_NUM];
+static uint8_t  netsvc_sn_mask = 0;
+
+static uint8_t netsvc_index(uint8_t service)
+{
+	switch(service)
+	{
+	case NETSVC_DHCPV4: return 0;
+	case NETSVC_DHCPV6: return 1;
+	case NETSVC_DNS:    return 2;
+	default:            return NETSVC_NUM;
+	}
+}
+
+static const uint8_t netsvc_owner[NETSVC_NUM] = {SOCK_OWN_DHCPV4, SOCK_OWN_DHCPV6, SOCK_OWN_DNS};
+
+/* Give the SOCKETs of the services back to the SOCKET pool, unless the service did it by its stop function */
+static void netsvc_release(void)
+{
+	uint8_t i;
+
+	for(i = 0; i < NETSVC_NUM; i++)
+	{
+		if((netsvc_sn[i] != NETSVC_NO_SOCK) && (wiz_sock_owner(netsvc_sn[i]) == netsvc_owner[i]))
+			wiz_sock_free(netsvc_sn[i]);
+		netsvc_sn[i] = NETSVC_NO_SOCK;
+	}
+	netsvc_services = 0;
+	netsvc_sn_mask = 0;
+}
+
+int8_t netsvc_init(uint8_t services)
+{
+	uint8_t i;
+	int8_t sn;
+
+	services &= NETSVC_ALL;
+	netsvc_release();
+	for(i = 0; i < NETSVC_NUM; i++)
+	{
+		if(!(services & (1 << i))) continue;
+		sn = wiz_sock_alloc(netsvc_owner[i]);
+		if(sn < 0)
+		{
+			netsvc_release();
+			return -1;
+		}
+		netsvc_sn[i] = (uint8_t)sn;
+		netsvc_sn_mask |= (1 << sn);
+	}
+
+	/* The services borrow the same arena, as none of them keeps a message in it between calls */
+	if(services & NETSVC_DHCPV4)
+	{
+		DHCPv4_init(netsvc_sn[0], netsvc_arena);
+		netsvc_result[0] = DHCPV4_RUNNING;
+	}
+	if(services & NETSVC_DHCPV6)
+	{
+		DHCP_init(netsvc_sn[1], netsvc_arena);
+		netsvc_result[1] = DHCP_RUNNING;
+	}
+	if(services & NETSVC_DNS)
+	{
+		DNS_async_init(netsvc_sn[2], netsvc_arena);
+		netsvc_result[2] = 0;
+	}
+	netsvc_services = services;
+	wiz_event_init(netsvc_sn_mask, 0);
+	return 0;
+}
+
+uint32_t netsvc_next_deadline(void)
+{
+	uint32_t next = 0xFFFFFFFF;
+	uint32_t t;
+
+	if(netsvc_services & NETSVC_DHCPV4)
+	{
+		t = DHCPv4_next_deadline();
+		if(t != 0xFFFFFFFF) t = (t < 0xFFFFFFFF / 1000) ? t * 1000 : 0xFFFFFFFE;
+		if(t < next) next = t;
+	}
+	if(netsvc_services & NETSVC_DHCPV6)
+	{
+		t = DHCP_next_deadline();
+		if(t < next) next = t;
+	}
+	if(netsvc_services & NETSVC_DNS)
+	{
+		t = DNS_next_deadline();
+		if(t < next) next = t;
+	}
+	return next;
+}
+
+/* Get and clear the events of the SOCKET of the service, if it is flagged in ready */
+static uint8_t netsvc_events(uint8_t i, uint8_t ready)
+{
+	uint8_t ev = 0;
+
+	if(!(ready & (1 << netsvc_sn[i]))) return 0;
+	ctlsocket(netsvc_sn[i], CS_GET_INTERRUPT, &ev);
+	if(ev) ctlsocket(netsvc_sn[i], CS_CLR_INTERRUPT, &ev);
+	return ev;
+}
+
+uint8_t netsvc_poll(uint32_t timeout)
+{
+	uint8_t ready, ev;
+	uint8_t polled = 0;
+	uint32_t next;
+
+	if(!netsvc_services) return 0;
+	next = netsvc_next_deadline();
+	if(next < timeout) timeout = next;
+	ready = wiz_wait_events(netsvc_sn_mask, timeout);
+
+	if(netsvc_services & NETSVC_DHCPV4)
+	{
+		ev = netsvc_events(0, ready);
+		if(ev || (DHCPv4_next_deadline() == 0))
+		{
+			netsvc_result[0] = DHCPv4_poll(ev);
+			polled |= NETSVC_DHCPV4;
+		}
+	}
+	if(netsvc_services & NETSVC_DHCPV6)
+	{
+		ev = netsvc_events(1, ready);
+		if(ev || (DHCP_next_deadline() == 0))
+		{
+			netsvc_result[1] = DHCP_poll(ev);
+			polled |= NETSVC_DHCPV6;
+		}
+	}
+	if(netsvc_services & NETSVC_DNS)
+	{
+		ev = netsvc_events(2, ready);
+		if(ev || (DNS_next_deadline() == 0))
+		{
+			netsvc_result[2] = DNS_poll();
+			polled |= NETSVC_DNS;
+		}
+	}
+	return polled;
+}
+
+uint8_t netsvc_get_result(uint8_t service)
+{
+	uint8_t i = netsvc_index(service);
+	return (i < NETSVC_NUM) ? netsvc_result[i] : 0;
+}
+
+uint8_t netsvc_get_socket(uint8_t service)
+{
+	uint8_t i = netsvc_index(service);
+	return (i < NETSVC_NUM) ? netsvc_sn[i] : NETSVC_NO_SOCK;
+}
+
+void netsvc_get_footprint(wiz_NetSvcMem* mem)
+{
+	uint16_t peak = 0;
+
+	mem->separate = 0;
+	mem->statics = 0;
+	if(netsvc_services & NETSVC_DHCPV4)
+	{
+		mem->separate += NETSVC_DHCPV4_MSG_SIZE;
+		if(DHCPv4_get_msg_peak() > peak) peak = DHCPv4_get_msg_peak();
+	}
+	if(netsvc_services & NETSVC_DHCPV6)
+	{
+		mem->separate += DHCP6_MAX_MSG_SIZE;
+		mem->statics += DHCP_get_tmpl_size();
+		if(DHCP_get_msg_peak() > peak) peak = DHCP_get_msg_peak();
+	}
+	if(netsvc_services & NETSVC_DNS)
+	{
+		mem->separate += MAX_DNS_BUF_SIZE;
+		mem->statics += DNS_get_cache_size();
+		if(DNS_get_msg_peak() > peak) peak = DNS_get_msg_peak();
+	}
+	mem->arena_size = NETSVC_ARENA_SIZE;
+	mem->arena_peak = peak;
+	mem->sn_mask = netsvc_sn_mask;
+}
+
+void netsvc_time_handler(void)
+{
+	if(netsvc_services & NETSVC_DHCPV4) DHCPv4_time_handler();
+	if(netsvc_services & NETSVC_DHCPV6) DHCP_time_handler();
+	if(netsvc_services & NETSVC_DNS)    DNS_time_handler();
+}
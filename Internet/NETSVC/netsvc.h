@@ -0,0 +1,120 @@
+//*****************************************************************************
+//
+//! \file netsvc.h
+//! \brief Network service runtime APIs Header file.
+//! \details Runs DNS, DHCPv4 and DHCPv6 clients on one shared message buffer. \n
+//!          Each service builds, sends, receives and parses its message within one call,
+//!          and keeps nothing in the buffer between calls, so the runtime lends the same
+//!          arena to them in turn from one task.
+//
+//*****************************************************************************
+
+#ifndef _NETSVC_H_
+#define _NETSVC_H_
+
+#include <stdint.h>
+#include "dns.h"
+#include "dhcpv4.h"
+#include "dhcpv6.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Services of netsvc_init() */
+#define NETSVC_DHCPV4      0x01     ///< DHCPv4 client of DHCPv4_poll()
+#define NETSVC_DHCPV6      0x02     ///< DHCPv6 client of DHCP_poll()
+#define NETSVC_DNS         0x04     ///< DNS client of DNS_query() and DNS_resolve()
+#define NETSVC_ALL         0x07
+
+/*
+ * @brief Size of a DHCPv4 message, the buffer of DHCPv4_init()
+ */
+#define NETSVC_DHCPV4_MSG_SIZE  548
+
+/*
+ * @brief Size of the shared message arena. It should hold the largest message of the services.
+ */
+#ifndef NETSVC_ARENA_SIZE
+#if (MAX_DNS_BUF_SIZE > NETSVC_DHCPV4_MSG_SIZE) && (MAX_DNS_BUF_SIZE >= DHCP6_MAX_MSG_SIZE)
+#define NETSVC_ARENA_SIZE  MAX_DNS_BUF_SIZE
+#elif DHCP6_MAX_MSG_SIZE > NETSVC_DHCPV4_MSG_SIZE
+#define NETSVC_ARENA_SIZE  DHCP6_MAX_MSG_SIZE
+#else
+#define NETSVC_ARENA_SIZE  NETSVC_DHCPV4_MSG_SIZE
+#endif
+#endif
+
+/*
+ * @brief Memory footprint of the services, reported by netsvc_get_footprint()
+ */
+typedef struct wiz_NetSvcMem_t
+{
+   uint16_t arena_size;   ///< Size of the shared arena
+   uint16_t arena_peak;   ///< Length of the largest message of the services so far
+   uint16_t separate;     ///< Bytes of the separate buffers the services would need without the arena
+   uint16_t statics;      ///< Bytes the services keep besides the arena, the DHCPv6 template and the DNS cache
+   uint8_t  sn_mask;      ///< SOCKETs of the services. Bit n is SOCKETn
+} wiz_NetSvcMem;
+
+/*
+ * @brief Start the services on the shared arena
+ * @details It takes a SOCKET of each service from the SOCKET pool by wiz_sock_alloc(), gives the services
+ *          their SOCKETs and the arena, and starts the event engine on their SOCKETs by wiz_event_init().
+ *          The SOCKETs of the previous call are given back first.
+ *          If your application uses the events of other SOCKETs, call wiz_event_init()
+ *          again with them and netsvc_get_footprint()'s sn_mask.
+ * @param services : OR of NETSVC_xx
+ * @return  0 : success \n
+ *         -1 : no free SOCKET in the pool. No service is started.
+ */
+int8_t netsvc_init(uint8_t services);
+
+/*
+ * @brief Wait and dispatch the events and timers of the services
+ * @details It waits INTn up to timeout or the next timer of the services, and calls the poll function
+ *          of each service which has a SOCKET event or a timer due.
+ * @param timeout : max time to wait in ms. 0 returns at once.
+ * @return  The services polled. OR of NETSVC_xx. Their results are got by netsvc_get_result().
+ */
+uint8_t netsvc_poll(uint32_t timeout);
+
+/*
+ * @brief Get the last result of the service polled by netsvc_poll()
+ * @param service : one of NETSVC_xx
+ * @return  Return of DHCPv4_poll(), DHCP_poll(), or the number of queries in progress from DNS_poll()
+ */
+uint8_t netsvc_get_result(uint8_t service);
+
+/*
+ * @brief Time to the next timer of the services
+ * @return  ms to it, 0 if due, or 0xFFFFFFFF if no timer is running
+ */
+uint32_t netsvc_next_deadline(void);
+
+/*
+ * @brief Get SOCKET of the service
+ * @param service : one of NETSVC_xx
+ * @return  SOCKET number, or 0xFF if the service is not started
+ */
+uint8_t netsvc_get_socket(uint8_t service);
+
+/*
+ * @brief Get memory footprint of the services
+ * @note  arena_peak is the largest of DHCPv4_get_msg_peak(), DHCP_get_msg_peak() and DNS_get_msg_peak().
+ *        A DHCPv4 message is counted up to its end option, though it is sent in 548 bytes.
+ */
+void netsvc_get_footprint(wiz_NetSvcMem* mem);
+
+/*
+ * @brief 1s Tick Timer handler of the services
+ * @note  It calls DHCPv4_time_handler(), DHCP_time_handler() and DNS_time_handler() of the services started.
+ *        SHOULD BE register to your system 1s Tick timer handler instead of them.
+ */
+void netsvc_time_handler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _NETSVC_H_ */